@@ -0,0 +1,684 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/bvh.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace schnapps
+{
+
+namespace
+{
+
+const uint32 NB_BINS = 16u;
+const uint32 MAX_LEAF_SIZE = 8u;
+const uint32 MAX_DEPTH = 64u;
+// ranges binned in parallel
+const uint32 PARALLEL_SPLIT_SIZE = 1u << 16;
+// cost of the traversal of a node relative to the intersection of a triangle
+const SCALAR TRAVERSAL_COST = SCALAR(1);
+
+struct Box
+{
+	Box() :
+		min_(VEC3::Constant(std::numeric_limits<SCALAR>::max())),
+		max_(VEC3::Constant(std::numeric_limits<SCALAR>::lowest()))
+	{}
+
+	inline void extend(const VEC3& p) { min_ = min_.cwiseMin(p); max_ = max_.cwiseMax(p); }
+	inline void extend(const VEC3& min, const VEC3& max) { min_ = min_.cwiseMin(min); max_ = max_.cwiseMax(max); }
+	inline void extend(const Box& b) { extend(b.min_, b.max_); }
+
+	inline SCALAR area() const
+	{
+		if (min_[0] > max_[0])
+			return SCALAR(0);
+		const VEC3 d = max_ - min_;
+		return SCALAR(2) * (d[0] * d[1] + d[1] * d[2] + d[2] * d[0]);
+	}
+
+	VEC3 min_;
+	VEC3 max_;
+};
+
+struct RangeBounds
+{
+	Box bounds_;
+	Box centroids_;
+};
+
+struct Bins
+{
+	Bins()
+	{
+		std::fill(&counts_[0][0], &counts_[0][0] + 3u * NB_BINS, 0u);
+	}
+
+	void merge(const Bins& b)
+	{
+		for (uint32 axis = 0u; axis < 3u; ++axis)
+		{
+			for (uint32 i = 0u; i < NB_BINS; ++i)
+			{
+				boxes_[axis][i].extend(b.boxes_[axis][i]);
+				counts_[axis][i] += b.counts_[axis][i];
+			}
+		}
+	}
+
+	Box boxes_[3][NB_BINS];
+	uint32 counts_[3][NB_BINS];
+};
+
+struct BuildRange
+{
+	uint32 node_;
+	uint32 first_;
+	uint32 count_;
+	uint32 depth_;
+};
+
+struct Split
+{
+	Box bounds_;
+	// number of triangles of the left child (0 for a leaf)
+	uint32 nb_left_;
+};
+
+/**
+ * @brief top-down binned SAH split of the ranges of the triangle order
+ */
+class Builder
+{
+public:
+
+	Builder(const std::vector<Box>& boxes, const std::vector<VEC3>& centroids, std::vector<uint32>& order) :
+		boxes_(boxes),
+		centroids_(centroids),
+		order_(order)
+	{}
+
+	// partitions the range of the order (the ranges of a level are disjoint: they can be split in parallel)
+	Split split(const BuildRange& range, bool parallel)
+	{
+		ThreadPool& pool = ThreadPool::instance();
+		const std::size_t begin = range.first_;
+		const std::size_t end = range.first_ + range.count_;
+
+		auto bound = [&] (std::size_t first, std::size_t last) -> RangeBounds
+		{
+			RangeBounds rb;
+			for (std::size_t i = first; i < last; ++i)
+			{
+				rb.bounds_.extend(boxes_[order_[i]]);
+				rb.centroids_.extend(centroids_[order_[i]]);
+			}
+			return rb;
+		};
+		const RangeBounds rb = parallel ?
+			pool.parallel_reduce(begin, end, RangeBounds(), bound, [] (RangeBounds a, const RangeBounds& b) { a.bounds_.extend(b.bounds_); a.centroids_.extend(b.centroids_); return a; }) :
+			bound(begin, end);
+
+		Split s;
+		s.bounds_ = rb.bounds_;
+		s.nb_left_ = 0u;
+		if (range.count_ <= 1u || range.depth_ >= MAX_DEPTH)
+			return s;
+
+		const VEC3 cmin = rb.centroids_.min_;
+		const VEC3 extent = rb.centroids_.max_ - cmin;
+		VEC3 scale;
+		for (uint32 axis = 0u; axis < 3u; ++axis)
+			scale[axis] = extent[axis] > 0 ? SCALAR(NB_BINS) / extent[axis] : SCALAR(0);
+		auto bin_of = [&] (uint32 t, uint32 axis) -> uint32
+		{
+			return std::min(NB_BINS - 1u, uint32((centroids_[t][axis] - cmin[axis]) * scale[axis]));
+		};
+
+		auto bin = [&] (std::size_t first, std::size_t last) -> Bins
+		{
+			Bins bins;
+			for (std::size_t i = first; i < last; ++i)
+			{
+				const uint32 t = order_[i];
+				for (uint32 axis = 0u; axis < 3u; ++axis)
+				{
+					const uint32 b = bin_of(t, axis);
+					bins.boxes_[axis][b].extend(boxes_[t]);
+					++bins.counts_[axis][b];
+				}
+			}
+			return bins;
+		};
+		const Bins bins = parallel ?
+			pool.parallel_reduce(begin, end, Bins(), bin, [] (Bins a, const Bins& b) { a.merge(b); return a; }) :
+			bin(begin, end);
+
+		// sweep the bins of each axis: cost of splitting after the bin i
+		const SCALAR area = rb.bounds_.area();
+		SCALAR best_cost = std::numeric_limits<SCALAR>::max();
+		uint32 best_axis = 0u;
+		uint32 best_bin = NB_BINS;
+		for (uint32 axis = 0u; axis < 3u; ++axis)
+		{
+			if (!(extent[axis] > 0))
+				continue;
+
+			SCALAR right_area[NB_BINS];
+			uint32 right_count[NB_BINS];
+			Box right;
+			uint32 count = 0u;
+			for (uint32 i = NB_BINS - 1u; i > 0u; --i)
+			{
+				right.extend(bins.boxes_[axis][i]);
+				count += bins.counts_[axis][i];
+				right_area[i] = right.area();
+				right_count[i] = count;
+			}
+
+			Box left;
+			count = 0u;
+			for (uint32 i = 0u; i < NB_BINS - 1u; ++i)
+			{
+				left.extend(bins.boxes_[axis][i]);
+				count += bins.counts_[axis][i];
+				if (count == 0u || right_count[i + 1u] == 0u)
+					continue;
+				const SCALAR cost = left.area() * count + right_area[i + 1u] * right_count[i + 1u];
+				if (cost < best_cost)
+				{
+					best_cost = cost;
+					best_axis = axis;
+					best_bin = i;
+				}
+			}
+		}
+
+		auto first = order_.begin() + range.first_;
+		auto last = first + range.count_;
+		if (best_bin < NB_BINS)
+		{
+			const SCALAR split_cost = TRAVERSAL_COST + (area > 0 ? best_cost / area : SCALAR(range.count_));
+			if (split_cost < SCALAR(range.count_) || range.count_ > MAX_LEAF_SIZE)
+			{
+				auto middle = std::partition(first, last, [&] (uint32 t) { return bin_of(t, best_axis) <= best_bin; });
+				s.nb_left_ = uint32(middle - first);
+			}
+		}
+		else if (range.count_ > MAX_LEAF_SIZE)
+			s.nb_left_ = range.count_ / 2u; // all the centroids are equal: any halves
+		return s;
+	}
+
+private:
+
+	const std::vector<Box>& boxes_;
+	const std::vector<VEC3>& centroids_;
+	std::vector<uint32>& order_;
+};
+
+inline bool ray_box(const BVH::Node& node, const VEC3& origin, const VEC3& inv_direction, SCALAR t_max, SCALAR& t_enter)
+{
+	const VEC3 t0 = (node.min_ - origin).cwiseProduct(inv_direction);
+	const VEC3 t1 = (node.max_ - origin).cwiseProduct(inv_direction);
+	const SCALAR t_near = std::max(t0.cwiseMin(t1).maxCoeff(), SCALAR(0));
+	const SCALAR t_far = t0.cwiseMax(t1).minCoeff();
+	t_enter = t_near;
+	return t_near <= t_far && t_near <= t_max;
+}
+
+// Moller-Trumbore
+inline bool ray_triangle(const VEC3& origin, const VEC3& direction, const VEC3& a, const VEC3& b, const VEC3& c, SCALAR t_max, SCALAR& t, SCALAR& u, SCALAR& v)
+{
+	const VEC3 e1 = b - a;
+	const VEC3 e2 = c - a;
+	const VEC3 p = direction.cross(e2);
+	const SCALAR det = e1.dot(p);
+	if (det == SCALAR(0))
+		return false;
+	const SCALAR inv_det = SCALAR(1) / det;
+	const VEC3 s = origin - a;
+	u = s.dot(p) * inv_det;
+	if (u < 0 || u > 1)
+		return false;
+	const VEC3 q = s.cross(e1);
+	v = direction.dot(q) * inv_det;
+	if (v < 0 || u + v > 1)
+		return false;
+	t = e2.dot(q) * inv_det;
+	return t >= 0 && t < t_max;
+}
+
+inline SCALAR squared_distance_to_box(const BVH::Node& node, const VEC3& p)
+{
+	return (node.min_ - p).cwiseMax(p - node.max_).cwiseMax(VEC3::Zero()).squaredNorm();
+}
+
+// Ericson, Real-Time Collision Detection, 5.1.5
+VEC3 closest_point_on_triangle(const VEC3& p, const VEC3& a, const VEC3& b, const VEC3& c)
+{
+	const VEC3 ab = b - a;
+	const VEC3 ac = c - a;
+	const VEC3 ap = p - a;
+	const SCALAR d1 = ab.dot(ap);
+	const SCALAR d2 = ac.dot(ap);
+	if (d1 <= 0 && d2 <= 0)
+		return a;
+
+	const VEC3 bp = p - b;
+	const SCALAR d3 = ab.dot(bp);
+	const SCALAR d4 = ac.dot(bp);
+	if (d3 >= 0 && d4 <= d3)
+		return b;
+
+	const SCALAR vc = d1 * d4 - d3 * d2;
+	if (vc <= 0 && d1 >= 0 && d3 <= 0)
+		return a + (d1 / (d1 - d3)) * ab;
+
+	const VEC3 cp = p - c;
+	const SCALAR d5 = ab.dot(cp);
+	const SCALAR d6 = ac.dot(cp);
+	if (d6 >= 0 && d5 <= d6)
+		return c;
+
+	const SCALAR vb = d5 * d2 - d1 * d6;
+	if (vb <= 0 && d2 >= 0 && d6 <= 0)
+		return a + (d2 / (d2 - d6)) * ac;
+
+	const SCALAR va = d3 * d6 - d5 * d4;
+	if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0)
+		return b + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (c - b);
+
+	const SCALAR sum = va + vb + vc;
+	if (sum == SCALAR(0))
+		return a;
+	return a + ab * (vb / sum) + ac * (vc / sum);
+}
+
+// separating axis test of a triangle (relative to the center of the box) and a box
+inline bool separated(const VEC3& axis, const VEC3& v0, const VEC3& v1, const VEC3& v2, const VEC3& half)
+{
+	const SCALAR p0 = axis.dot(v0);
+	const SCALAR p1 = axis.dot(v1);
+	const SCALAR p2 = axis.dot(v2);
+	const SCALAR r = half.dot(axis.cwiseAbs());
+	return std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r;
+}
+
+// Akenine-Moller: the 3 axes of the box, the normal of the triangle and the 9 edge cross products
+bool triangle_overlaps_box(const VEC3& center, const VEC3& half, const VEC3& a, const VEC3& b, const VEC3& c)
+{
+	const VEC3 v0 = a - center;
+	const VEC3 v1 = b - center;
+	const VEC3 v2 = c - center;
+	const VEC3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+	for (uint32 i = 0u; i < 3u; ++i)
+	{
+		const VEC3 axis = VEC3::Unit(i);
+		if (separated(axis, v0, v1, v2, half))
+			return false;
+		for (uint32 j = 0u; j < 3u; ++j)
+		{
+			if (separated(axis.cross(edges[j]), v0, v1, v2, half))
+				return false;
+		}
+	}
+	return !separated(edges[0].cross(edges[1]), v0, v1, v2, half);
+}
+
+} // namespace
+
+BVH::BVH() :
+	build_cost_(0),
+	cost_(0)
+{}
+
+void BVH::build(const MapAdjacency& adjacency, std::vector<VEC3>&& positions)
+{
+	ThreadPool& pool = ThreadPool::instance();
+
+	positions_ = std::move(positions);
+	face_darts_ = adjacency.face_darts_;
+	nodes_.clear();
+	level_offsets_.clear();
+	build_cost_ = cost_ = SCALAR(0);
+
+	// fan triangulation of the faces
+	const CSRRelation& face_vertex = adjacency.face_vertex_;
+	const uint32 nb_faces = face_vertex.nb_sources();
+	std::vector<uint32> triangle_offsets(nb_faces + 1u, 0u);
+	for (uint32 f = 0u; f < nb_faces; ++f)
+		triangle_offsets[f + 1u] = triangle_offsets[f] + std::max(face_vertex.degree(f), 2u) - 2u;
+	const uint32 nb_triangles = triangle_offsets[nb_faces];
+
+	std::vector<uint32> triangles(3u * nb_triangles);
+	std::vector<uint32> triangle_faces(nb_triangles);
+	std::vector<Box> boxes(nb_triangles);
+	std::vector<VEC3> centroids(nb_triangles);
+	std::vector<uint32> order(nb_triangles);
+	pool.parallel_for(0, nb_faces, [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t f = first; f < last; ++f)
+		{
+			const uint32* v = face_vertex.begin(uint32(f));
+			uint32 t = triangle_offsets[f];
+			for (uint32 k = 2u; k < face_vertex.degree(uint32(f)); ++k, ++t)
+			{
+				const uint32 tv[3] = { v[0], v[k - 1u], v[k] };
+				for (uint32 j = 0u; j < 3u; ++j)
+				{
+					triangles[3u * t + j] = tv[j];
+					boxes[t].extend(positions_[tv[j]]);
+				}
+				triangle_faces[t] = uint32(f);
+				centroids[t] = (boxes[t].min_ + boxes[t].max_) / SCALAR(2);
+				order[t] = t;
+			}
+		}
+	});
+
+	if (nb_triangles == 0u)
+	{
+		triangles_.clear();
+		triangle_faces_.clear();
+		return;
+	}
+
+	// split the tree level by level: the nodes of a level are contiguous
+	Builder builder(boxes, centroids, order);
+	nodes_.push_back(Node());
+	level_offsets_.push_back(0u);
+	std::vector<BuildRange> level(1u, BuildRange{ 0u, 0u, nb_triangles, 0u });
+	std::vector<Split> splits;
+	std::vector<BuildRange> next;
+	while (!level.empty())
+	{
+		splits.resize(level.size());
+		// the large ranges bin their triangles in parallel, the small ones are split in parallel
+		for (std::size_t i = 0; i < level.size(); ++i)
+		{
+			if (level[i].count_ >= PARALLEL_SPLIT_SIZE)
+				splits[i] = builder.split(level[i], true);
+		}
+		pool.parallel_for(0, level.size(), [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				if (level[i].count_ < PARALLEL_SPLIT_SIZE)
+					splits[i] = builder.split(level[i], false);
+			}
+		});
+
+		level_offsets_.push_back(uint32(nodes_.size()));
+		next.clear();
+		for (std::size_t i = 0; i < level.size(); ++i)
+		{
+			const BuildRange& r = level[i];
+			const Split& s = splits[i];
+			Node& node = nodes_[r.node_];
+			node.min_ = s.bounds_.min_;
+			node.max_ = s.bounds_.max_;
+			if (s.nb_left_ == 0u)
+			{
+				node.first_ = r.first_;
+				node.count_ = r.count_;
+			}
+			else
+			{
+				const uint32 child = uint32(level_offsets_.back() + next.size());
+				node.first_ = child;
+				node.count_ = 0u;
+				next.push_back(BuildRange{ child, r.first_, s.nb_left_, r.depth_ + 1u });
+				next.push_back(BuildRange{ child + 1u, r.first_ + s.nb_left_, r.count_ - s.nb_left_, r.depth_ + 1u });
+			}
+		}
+		nodes_.resize(nodes_.size() + next.size());
+		level.swap(next);
+	}
+
+	// store the triangles in the order of the leaves
+	triangles_.resize(3u * nb_triangles);
+	triangle_faces_.resize(nb_triangles);
+	pool.parallel_for(0, nb_triangles, [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+		{
+			const uint32 t = order[i];
+			for (uint32 j = 0u; j < 3u; ++j)
+				triangles_[3u * i + j] = triangles[3u * t + j];
+			triangle_faces_[i] = triangle_faces[t];
+		}
+	});
+
+	refit_nodes();
+	build_cost_ = cost_;
+}
+
+void BVH::refit(std::vector<VEC3>&& positions)
+{
+	positions_ = std::move(positions);
+	refit_nodes();
+}
+
+void BVH::refit_nodes()
+{
+	ThreadPool& pool = ThreadPool::instance();
+
+	if (nodes_.empty())
+		return;
+
+	// the children are in the next level: the levels are refitted from the deepest one
+	SCALAR cost = SCALAR(0);
+	for (std::size_t l = level_offsets_.size() - 1u; l-- > 0u;)
+	{
+		cost += pool.parallel_reduce(level_offsets_[l], level_offsets_[l + 1u], SCALAR(0),
+			[&] (std::size_t first, std::size_t last) -> SCALAR
+			{
+				SCALAR c = SCALAR(0);
+				for (std::size_t i = first; i < last; ++i)
+				{
+					Node& node = nodes_[i];
+					Box b;
+					if (node.count_ > 0u)
+					{
+						for (uint32 t = 3u * node.first_; t < 3u * (node.first_ + node.count_); ++t)
+							b.extend(positions_[triangles_[t]]);
+						c += b.area() * SCALAR(node.count_);
+					}
+					else
+					{
+						b.extend(nodes_[node.first_].min_, nodes_[node.first_].max_);
+						b.extend(nodes_[node.first_ + 1u].min_, nodes_[node.first_ + 1u].max_);
+						c += b.area() * TRAVERSAL_COST;
+					}
+					node.min_ = b.min_;
+					node.max_ = b.max_;
+				}
+				return c;
+			},
+			[] (SCALAR a, SCALAR b) { return a + b; }
+		);
+	}
+
+	Box root;
+	root.extend(nodes_[0].min_, nodes_[0].max_);
+	const SCALAR area = root.area();
+	cost_ = area > 0 ? cost / area : SCALAR(0);
+}
+
+bool BVH::intersect(const VEC3& origin, const VEC3& direction, RayHit& hit, SCALAR t_max) const
+{
+	if (nodes_.empty())
+		return false;
+
+	const VEC3 inv_direction = direction.cwiseInverse();
+	SCALAR t_enter;
+	if (!ray_box(nodes_[0], origin, inv_direction, t_max, t_enter))
+		return false;
+
+	uint32 stack[2u * MAX_DEPTH + 2u];
+	uint32 size = 0u;
+	stack[size++] = 0u;
+	bool found = false;
+	while (size > 0u)
+	{
+		const Node& node = nodes_[stack[--size]];
+		if (!ray_box(node, origin, inv_direction, t_max, t_enter))
+			continue;
+
+		if (node.count_ > 0u)
+		{
+			for (uint32 t = node.first_; t < node.first_ + node.count_; ++t)
+			{
+				SCALAR tt, u, v;
+				const uint32* tv = &triangles_[3u * t];
+				if (ray_triangle(origin, direction, positions_[tv[0]], positions_[tv[1]], positions_[tv[2]], t_max, tt, u, v))
+				{
+					found = true;
+					t_max = tt;
+					hit.face_ = triangle_faces_[t];
+					hit.u_ = u;
+					hit.v_ = v;
+				}
+			}
+		}
+		else
+		{
+			// the nearest child is visited first
+			SCALAR t0, t1;
+			const bool h0 = ray_box(nodes_[node.first_], origin, inv_direction, t_max, t0);
+			const bool h1 = ray_box(nodes_[node.first_ + 1u], origin, inv_direction, t_max, t1);
+			if (h0 && h1)
+			{
+				stack[size++] = t0 <= t1 ? node.first_ + 1u : node.first_;
+				stack[size++] = t0 <= t1 ? node.first_ : node.first_ + 1u;
+			}
+			else if (h0)
+				stack[size++] = node.first_;
+			else if (h1)
+				stack[size++] = node.first_ + 1u;
+		}
+	}
+
+	if (found)
+	{
+		hit.t_ = t_max;
+		hit.point_ = origin + t_max * direction;
+	}
+	return found;
+}
+
+bool BVH::closest_point(const VEC3& p, ClosestPoint& result, SCALAR max_distance) const
+{
+	if (nodes_.empty())
+		return false;
+
+	SCALAR best = max_distance < std::sqrt(std::numeric_limits<SCALAR>::max()) ? max_distance * max_distance : std::numeric_limits<SCALAR>::max();
+	uint32 stack[2u * MAX_DEPTH + 2u];
+	uint32 size = 0u;
+	stack[size++] = 0u;
+	bool found = false;
+	while (size > 0u)
+	{
+		const Node& node = nodes_[stack[--size]];
+		if (squared_distance_to_box(node, p) >= best)
+			continue;
+
+		if (node.count_ > 0u)
+		{
+			for (uint32 t = node.first_; t < node.first_ + node.count_; ++t)
+			{
+				const uint32* tv = &triangles_[3u * t];
+				const VEC3 q = closest_point_on_triangle(p, positions_[tv[0]], positions_[tv[1]], positions_[tv[2]]);
+				const SCALAR d = (q - p).squaredNorm();
+				if (d < best)
+				{
+					found = true;
+					best = d;
+					result.face_ = triangle_faces_[t];
+					result.point_ = q;
+				}
+			}
+		}
+		else
+		{
+			const SCALAR d0 = squared_distance_to_box(nodes_[node.first_], p);
+			const SCALAR d1 = squared_distance_to_box(nodes_[node.first_ + 1u], p);
+			stack[size++] = d0 <= d1 ? node.first_ + 1u : node.first_;
+			stack[size++] = d0 <= d1 ? node.first_ : node.first_ + 1u;
+		}
+	}
+
+	if (found)
+		result.distance_ = std::sqrt(best);
+	return found;
+}
+
+void BVH::overlap(const VEC3& box_min, const VEC3& box_max, std::vector<uint32>& faces) const
+{
+	faces.clear();
+	if (nodes_.empty())
+		return;
+
+	const VEC3 center = (box_min + box_max) / SCALAR(2);
+	const VEC3 half = (box_max - box_min) / SCALAR(2);
+	uint32 stack[2u * MAX_DEPTH + 2u];
+	uint32 size = 0u;
+	stack[size++] = 0u;
+	while (size > 0u)
+	{
+		const Node& node = nodes_[stack[--size]];
+		if ((node.min_.array() > box_max.array()).any() || (node.max_.array() < box_min.array()).any())
+			continue;
+
+		if (node.count_ > 0u)
+		{
+			for (uint32 t = node.first_; t < node.first_ + node.count_; ++t)
+			{
+				const uint32* tv = &triangles_[3u * t];
+				if (triangle_overlaps_box(center, half, positions_[tv[0]], positions_[tv[1]], positions_[tv[2]]))
+					faces.push_back(triangle_faces_[t]);
+			}
+		}
+		else
+		{
+			stack[size++] = node.first_;
+			stack[size++] = node.first_ + 1u;
+		}
+	}
+
+	std::sort(faces.begin(), faces.end());
+	faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+}
+
+uint64 BVH::memory() const
+{
+	return uint64(nodes_.capacity()) * sizeof(Node) +
+		uint64(level_offsets_.capacity() + triangles_.capacity() + triangle_faces_.capacity() + face_darts_.capacity()) * sizeof(uint32) +
+		uint64(positions_.capacity()) * sizeof(VEC3);
+}
+
+} // namespace schnapps
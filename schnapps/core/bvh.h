@@ -0,0 +1,153 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_BVH_H_
+#define SCHNAPPS_CORE_BVH_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+#include <schnapps/core/map_adjacency.h>
+
+#include <limits>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Bounding volume hierarchy over the faces of a map (see MapHandlerGen::get_bvh)
+* The faces are fan-triangulated and the hierarchy is built top-down with a binned surface area
+* heuristic: each level of the tree is split in parallel (the large nodes bin their triangles in
+* parallel). The triangles are stored in the order of the leaves and the nodes level by level,
+* so that a refit after a deformation updates each level in parallel without changing the tree.
+* The BVH keeps its own copy of the vertex positions: queries only read the BVH.
+* The faces are numbered as in the MapAdjacency the BVH was built from.
+*/
+class SCHNAPPS_CORE_API BVH
+{
+public:
+
+	struct Node
+	{
+		VEC3 min_;
+		VEC3 max_;
+		// inner node: children first_ and first_ + 1 / leaf: first triangle
+		uint32 first_;
+		// number of triangles of a leaf (0 for an inner node)
+		uint32 count_;
+	};
+
+	struct RayHit
+	{
+		uint32 face_;
+		// hit point: origin + t_ * direction, barycentric coordinates (u_, v_) in the hit triangle
+		SCALAR t_;
+		SCALAR u_;
+		SCALAR v_;
+		VEC3 point_;
+	};
+
+	struct ClosestPoint
+	{
+		uint32 face_;
+		SCALAR distance_;
+		VEC3 point_;
+	};
+
+	BVH();
+
+	/**
+	 * @brief build the hierarchy
+	 * @param adjacency the faces to index (face_vertex_ and face_darts_)
+	 * @param positions position of each vertex of the adjacency (moved into the BVH)
+	 */
+	void build(const MapAdjacency& adjacency, std::vector<VEC3>&& positions);
+
+	/**
+	 * @brief update the bounding boxes after a deformation (the connectivity must be unchanged)
+	 * @param positions new position of each vertex of the adjacency (moved into the BVH)
+	 */
+	void refit(std::vector<VEC3>&& positions);
+
+	/**
+	 * @brief cast a ray on the faces
+	 * @param origin origin of the ray
+	 * @param direction direction of the ray (not necessarily normalized: t_ is in its unit)
+	 * @param t_max the hits beyond origin + t_max * direction are ignored
+	 * @return false if no face is hit
+	 */
+	bool intersect(const VEC3& origin, const VEC3& direction, RayHit& hit, SCALAR t_max = std::numeric_limits<SCALAR>::max()) const;
+
+	/**
+	 * @brief find the closest point of the faces
+	 * @param max_distance the points further than max_distance are ignored
+	 * @return false if no face is closer than max_distance
+	 */
+	bool closest_point(const VEC3& p, ClosestPoint& result, SCALAR max_distance = std::numeric_limits<SCALAR>::max()) const;
+
+	/**
+	 * @brief get the faces overlapping an axis-aligned box (exact triangle / box test)
+	 * @param faces the numbers of the faces, sorted without duplicates
+	 */
+	void overlap(const VEC3& box_min, const VEC3& box_max, std::vector<uint32>& faces) const;
+
+	/**
+	 * @brief get the index of a dart of a face (cgogn::Dart(index) for a cell of the map)
+	 */
+	inline uint32 get_face_dart(uint32 face) const { return face_darts_[face]; }
+
+	inline uint32 nb_faces() const { return uint32(face_darts_.size()); }
+	inline uint32 nb_triangles() const { return uint32(triangle_faces_.size()); }
+	inline uint32 nb_nodes() const { return uint32(nodes_.size()); }
+	inline const std::vector<Node>& get_nodes() const { return nodes_; }
+
+	/**
+	 * @brief get the surface area heuristic cost of the tree relative to its cost when it was built
+	 * The refits keep the tree: a ratio far above 1 means the tree should be rebuilt.
+	 */
+	inline SCALAR get_degradation() const { return build_cost_ > 0 ? cost_ / build_cost_ : SCALAR(1); }
+
+	uint64 memory() const;
+
+private:
+
+	void refit_nodes();
+
+	std::vector<Node> nodes_;
+	// nodes of the level i: level_offsets_[i] .. level_offsets_[i+1] - 1
+	std::vector<uint32> level_offsets_;
+
+	// 3 vertices and the face of each triangle, in the order of the leaves
+	std::vector<uint32> triangles_;
+	std::vector<uint32> triangle_faces_;
+
+	std::vector<VEC3> positions_;
+	std::vector<uint32> face_darts_;
+
+	SCALAR build_cost_;
+	SCALAR cost_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_BVH_H_
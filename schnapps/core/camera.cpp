@@ -25,6 +25,9 @@
 #include <schnapps/core/schnapps.h>
 #include <schnapps/core/view.h>
 
+#include <algorithm>
+#include <cmath>
+
 namespace schnapps
 {
 
@@ -95,6 +98,67 @@ void Camera::from_string(QString cam)
 	this->setOrientation(ori);
 }
 
+void Camera::add_keyframe()
+{
+	path_.add_keyframe(this->position(), this->orientation());
+	emit(path_changed());
+}
+
+void Camera::clear_path()
+{
+	path_.clear();
+	emit(path_changed());
+}
+
+void Camera::set_path_closed(bool b)
+{
+	path_.set_closed(b);
+	emit(path_changed());
+}
+
+void Camera::make_turntable_path(int nb_keyframes)
+{
+	nb_keyframes = std::max(nb_keyframes, 3);
+
+	const qoglviewer::Vec center = this->sceneCenter();
+	const qoglviewer::Vec axis = this->upVector();
+	const qoglviewer::Vec pos = this->position();
+	const qoglviewer::Quaternion ori = this->orientation();
+
+	path_.clear();
+	for (int i = 0; i < nb_keyframes; ++i)
+	{
+		qoglviewer::Quaternion rot(axis, 2.0 * M_PI * double(i) / double(nb_keyframes));
+		path_.add_keyframe(center + rot.rotate(pos - center), rot * ori);
+	}
+	path_.set_closed(true);
+
+	emit(path_changed());
+}
+
+void Camera::set_path_pose(double t)
+{
+	qoglviewer::Vec pos;
+	qoglviewer::Quaternion ori;
+	if (path_.interpolate(t, pos, ori))
+	{
+		this->setPosition(pos);
+		this->setOrientation(ori);
+	}
+}
+
+QString Camera::path_to_string()
+{
+	return path_.to_string();
+}
+
+bool Camera::path_from_string(QString path)
+{
+	bool res = path_.from_string(path);
+	emit(path_changed());
+	return res;
+}
+
 void Camera::link_view(View* view)
 {
 	if(view && !views_.contains(view))
@@ -25,6 +25,7 @@
 #define SCHNAPPS_CORE_CAMERA_H_
 
 #include <schnapps/core/dll.h>
+#include <schnapps/core/camera_path.h>
 
 #include <QOGLViewer/camera.h>
 #include <QOGLViewer/manipulatedCameraFrame.h>
@@ -153,6 +154,52 @@ public slots:
 	*/
 	void from_string(QString camera);
 
+	/**
+	* @brief get the keyframe path of the camera
+	*/
+	inline const CameraPath& get_path() const { return path_; }
+
+	/**
+	* @brief add the current pose of the camera as a new keyframe of its path
+	*/
+	void add_keyframe();
+
+	/**
+	* @brief remove all keyframes of the camera path
+	*/
+	void clear_path();
+
+	/**
+	* @brief set whether the camera path loops back to its first keyframe
+	*/
+	void set_path_closed(bool b);
+
+	/**
+	* @brief replace the camera path by a closed orbit around the scene center
+	* The orbit starts from the current pose and turns around the camera up vector.
+	* @param nb_keyframes number of keyframes of the orbit (at least 3)
+	*/
+	void make_turntable_path(int nb_keyframes);
+
+	/**
+	* @brief set the camera pose at a given time of its path
+	* @param t time in [0, get_path().duration()]
+	*/
+	void set_path_pose(double t);
+
+	/**
+	* @brief store the camera path into a string
+	* @return the storage string
+	*/
+	QString path_to_string();
+
+	/**
+	* @brief restore the camera path from string storage
+	* @param path the string containing data
+	* @return false if the string is invalid
+	*/
+	bool path_from_string(QString path);
+
 private:
 
 	void link_view(View* view);
@@ -168,6 +215,7 @@ signals:
 	void projection_type_changed(int);
 	void draw_changed(bool);
 	void draw_path_changed(bool);
+	void path_changed();
 
 protected:
 
@@ -185,6 +233,9 @@ protected:
 
 	// fit the camera to the bounding box of view
 	bool fit_to_views_bb_;
+
+	// keyframes of the camera path
+	CameraPath path_;
 };
 
 } // namespace schnapps
@@ -0,0 +1,185 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/camera_path.h>
+
+#include <QTextStream>
+
+#include <algorithm>
+#include <cmath>
+
+namespace schnapps
+{
+
+CameraPath::CameraPath() :
+	closed_(false)
+{}
+
+void CameraPath::add_keyframe(const qoglviewer::Vec& position, const qoglviewer::Quaternion& orientation)
+{
+	KeyFrame k;
+	k.position_ = position;
+	k.orientation_ = orientation;
+	// keep consecutive orientations in the same hemisphere for the shortest interpolation
+	if (!keyframes_.empty())
+	{
+		const qoglviewer::Quaternion& prev = keyframes_.back().orientation_;
+		if (prev[0] * k.orientation_[0] + prev[1] * k.orientation_[1] + prev[2] * k.orientation_[2] + prev[3] * k.orientation_[3] < 0.0)
+			k.orientation_.negate();
+	}
+	keyframes_.push_back(k);
+}
+
+void CameraPath::clear()
+{
+	keyframes_.clear();
+}
+
+double CameraPath::duration() const
+{
+	if (keyframes_.size() < 2)
+		return 0.0;
+	return closed_ ? double(keyframes_.size()) : double(keyframes_.size() - 1);
+}
+
+std::size_t CameraPath::index(long i) const
+{
+	const long n = long(keyframes_.size());
+	if (closed_)
+		return std::size_t(((i % n) + n) % n);
+	return std::size_t(std::min(std::max(i, 0l), n - 1));
+}
+
+bool CameraPath::interpolate(double t, qoglviewer::Vec& position, qoglviewer::Quaternion& orientation) const
+{
+	if (keyframes_.empty())
+		return false;
+
+	if (keyframes_.size() == 1)
+	{
+		position = keyframes_[0].position_;
+		orientation = keyframes_[0].orientation_;
+		return true;
+	}
+
+	t = std::min(std::max(t, 0.0), duration());
+	long segment = long(std::floor(t));
+	if (segment >= long(duration()))
+		segment = long(duration()) - 1;
+	const double u = t - double(segment);
+
+	const KeyFrame& k0 = keyframes_[index(segment - 1)];
+	const KeyFrame& k1 = keyframes_[index(segment)];
+	const KeyFrame& k2 = keyframes_[index(segment + 1)];
+	const KeyFrame& k3 = keyframes_[index(segment + 2)];
+
+	// Catmull-Rom spline
+	const double u2 = u * u;
+	const double u3 = u2 * u;
+	position =
+		0.5 * (
+			(2.0 * k1.position_) +
+			(k2.position_ - k0.position_) * u +
+			(2.0 * k0.position_ - 5.0 * k1.position_ + 4.0 * k2.position_ - k3.position_) * u2 +
+			(3.0 * k1.position_ - k0.position_ - 3.0 * k2.position_ + k3.position_) * u3
+		);
+
+	// squad
+	qoglviewer::Quaternion q1 = k1.orientation_;
+	qoglviewer::Quaternion q2 = k2.orientation_;
+	if (closed_ && std::size_t(segment) == keyframes_.size() - 1)
+	{
+		// the loop closes on the first keyframe: keep it in the same hemisphere
+		if (q1[0] * q2[0] + q1[1] * q2[1] + q1[2] * q2[2] + q1[3] * q2[3] < 0.0)
+			q2.negate();
+	}
+	const qoglviewer::Quaternion tg1 = qoglviewer::Quaternion::squadTangent(k0.orientation_, q1, q2);
+	const qoglviewer::Quaternion tg2 = qoglviewer::Quaternion::squadTangent(q1, q2, k3.orientation_);
+	orientation = qoglviewer::Quaternion::squad(q1, tg1, tg2, q2, u);
+	orientation.normalize();
+
+	return true;
+}
+
+void CameraPath::sample(unsigned int nb_frames, std::vector<KeyFrame>& frames) const
+{
+	frames.clear();
+	if (keyframes_.empty() || nb_frames == 0)
+		return;
+
+	frames.resize(nb_frames);
+	const double d = duration();
+	for (unsigned int i = 0; i < nb_frames; ++i)
+	{
+		double t = 0.0;
+		if (closed_)
+			t = d * double(i) / double(nb_frames);
+		else if (nb_frames > 1)
+			t = d * double(i) / double(nb_frames - 1);
+		interpolate(t, frames[i].position_, frames[i].orientation_);
+	}
+}
+
+QString CameraPath::to_string() const
+{
+	QString res;
+	QTextStream str(&res);
+	str << (closed_ ? 1 : 0) << " " << keyframes_.size();
+	for (const KeyFrame& k : keyframes_)
+	{
+		str << " " << k.position_[0] << " " << k.position_[1] << " " << k.position_[2];
+		str << " " << k.orientation_[0] << " " << k.orientation_[1] << " " << k.orientation_[2] << " " << k.orientation_[3];
+	}
+	return res;
+}
+
+bool CameraPath::from_string(QString path)
+{
+	clear();
+
+	QTextStream str(&path);
+	int closed = 0;
+	int nb = 0;
+	str >> closed >> nb;
+	if (str.status() != QTextStream::Ok || nb < 0)
+		return false;
+
+	closed_ = closed != 0;
+	for (int i = 0; i < nb; ++i)
+	{
+		qoglviewer::Vec pos;
+		double ori[4];
+		str >> pos[0] >> pos[1] >> pos[2];
+		str >> ori[0] >> ori[1] >> ori[2] >> ori[3];
+		if (str.status() != QTextStream::Ok)
+		{
+			clear();
+			return false;
+		}
+		add_keyframe(pos, qoglviewer::Quaternion(ori[0], ori[1], ori[2], ori[3]));
+	}
+
+	return true;
+}
+
+} // namespace schnapps
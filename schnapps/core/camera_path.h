@@ -0,0 +1,109 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_CAMERA_PATH_H_
+#define SCHNAPPS_CORE_CAMERA_PATH_H_
+
+#include <schnapps/core/dll.h>
+
+#include <QOGLViewer/vec.h>
+#include <QOGLViewer/quaternion.h>
+
+#include <QString>
+
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief A camera path is a sequence of keyframes (position & orientation).
+* Keyframes are uniformly spaced in time: positions are interpolated with a Catmull-Rom spline
+* and orientations with spherical quadrangle interpolation (squad).
+* A closed path loops from the last keyframe back to the first one (e.g. turntables).
+*/
+class SCHNAPPS_CORE_API CameraPath
+{
+public:
+
+	struct KeyFrame
+	{
+		qoglviewer::Vec position_;
+		qoglviewer::Quaternion orientation_;
+	};
+
+	CameraPath();
+
+	inline std::size_t nb_keyframes() const { return keyframes_.size(); }
+	inline const KeyFrame& keyframe(std::size_t i) const { return keyframes_[i]; }
+
+	inline bool is_closed() const { return closed_; }
+	inline void set_closed(bool b) { closed_ = b; }
+
+	void add_keyframe(const qoglviewer::Vec& position, const qoglviewer::Quaternion& orientation);
+	void clear();
+
+	/**
+	 * @brief length of the path (number of segments between keyframes)
+	 */
+	double duration() const;
+
+	/**
+	 * @brief interpolate the path
+	 * @param t time in [0, duration()]
+	 * @param position interpolated position
+	 * @param orientation interpolated orientation
+	 * @return false if the path has no keyframe
+	 */
+	bool interpolate(double t, qoglviewer::Vec& position, qoglviewer::Quaternion& orientation) const;
+
+	/**
+	 * @brief sample the path in a given number of frames
+	 * open paths: the first and last frames are the first and last keyframes
+	 * closed paths: the last frame precedes the first one (loopable sequence)
+	 */
+	void sample(unsigned int nb_frames, std::vector<KeyFrame>& frames) const;
+
+	/**
+	 * @brief store the path into a string (same pose format as Camera::to_string)
+	 */
+	QString to_string() const;
+
+	/**
+	 * @brief restore the path from a string
+	 * @return false if the string is invalid (the path is then empty)
+	 */
+	bool from_string(QString path);
+
+private:
+
+	// index of a keyframe (clamped for open paths, wrapped for closed paths)
+	std::size_t index(long i) const;
+
+	std::vector<KeyFrame> keyframes_;
+	bool closed_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_CAMERA_PATH_H_
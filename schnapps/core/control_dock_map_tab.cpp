@@ -26,6 +26,8 @@
 #include <schnapps/core/schnapps.h>
 #include <schnapps/core/view.h>
 
+#include <QMenu>
+
 namespace schnapps
 {
 
@@ -44,10 +46,16 @@ ControlDock_MapTab::ControlDock_MapTab(SCHNApps* s) :
 
 	connect(button_duplicate, SIGNAL(clicked()), this, SLOT(duplicate_current_map_clicked()));
 	connect(button_remove, SIGNAL(clicked()), this, SLOT(remove_current_map_clicked()));
+	connect(button_undo, SIGNAL(clicked()), this, SLOT(undo_clicked()));
+	connect(button_redo, SIGNAL(clicked()), this, SLOT(redo_clicked()));
 
 	connect(check_drawBB, SIGNAL(toggled(bool)), this, SLOT(show_bb_changed(bool)));
 	connect(combo_bbVertexAttribute, SIGNAL(currentIndexChanged(int)), this, SLOT(bb_vertex_attribute_changed(int)));
 	connect(list_vertexAttributes, SIGNAL(itemChanged(QListWidgetItem*)), this, SLOT(vertex_attribute_check_state_changed(QListWidgetItem*)));
+	list_vertexAttributes->setContextMenuPolicy(Qt::CustomContextMenu);
+	connect(list_vertexAttributes, SIGNAL(customContextMenuRequested(const QPoint&)), this, SLOT(vertex_attribute_context_menu(const QPoint&)));
+	connect(button_memoryRefresh, SIGNAL(clicked()), this, SLOT(update_memory_report()));
+	connect(button_memoryCompact, SIGNAL(clicked()), this, SLOT(compact_current_map_clicked()));
 
 //	connect(tabWidget_mapInfo, SIGNAL(currentChanged(int)), this, SLOT(selected_selector_changed()));
 
@@ -117,11 +125,10 @@ void ControlDock_MapTab::selected_map_changed()
 
 		if (old)
 		{
-			disconnect(old, SIGNAL(attribute_added(cgogn::Orbit, const QString&)), this, SLOT(selected_map_attribute_added(cgogn::Orbit, const QString&)));
-			disconnect(old, SIGNAL(vbo_added(cgogn::rendering::VBO*)), this, SLOT(selected_map_vbo_added(cgogn::rendering::VBO*)));
-			disconnect(old, SIGNAL(vbo_removed(cgogn::rendering::VBO*)), this, SLOT(selected_map_vbo_removed(cgogn::rendering::VBO*)));
+			disconnect(old, SIGNAL(changes_committed(const MapChangeSet&)), this, SLOT(selected_map_changes_committed(const MapChangeSet&)));
 			disconnect(old, SIGNAL(bb_vertex_attribute_changed(const QString&)), this, SLOT(selected_map_bb_vertex_attribute_changed(const QString&)));
-//			disconnect(old, SIGNAL(connectivity_changed()), this, SLOT(selected_map_connectivity_changed()));
+			disconnect(old, SIGNAL(connectivity_changed()), this, SLOT(selected_map_connectivity_changed()));
+			disconnect(old, SIGNAL(undo_stack_changed()), this, SLOT(selected_map_undo_stack_changed()));
 //			disconnect(old, SIGNAL(cell_selector_added(unsigned int, const QString&)), this, SLOT(selected_map_cell_selector_added(unsigned int, const QString&)));
 //			disconnect(old, SIGNAL(cell_selector_removed(unsigned int, const QString&)), this, SLOT(selected_map_cell_selector_removed(unsigned int, const QString&)));
 		}
@@ -132,11 +139,10 @@ void ControlDock_MapTab::selected_map_changed()
 			QString selected_map_name = items[0]->text();
 			selected_map_ = schnapps_->get_map(selected_map_name);
 
-			connect(selected_map_, SIGNAL(attribute_added(cgogn::Orbit, const QString&)), this, SLOT(selected_map_attribute_added(cgogn::Orbit, const QString&)));
-			connect(selected_map_, SIGNAL(vbo_added(cgogn::rendering::VBO*)), this, SLOT(selected_map_vbo_added(cgogn::rendering::VBO*)));
-			connect(selected_map_, SIGNAL(vbo_removed(cgogn::rendering::VBO*)), this, SLOT(selected_map_vbo_removed(cgogn::rendering::VBO*)));
+			connect(selected_map_, SIGNAL(changes_committed(const MapChangeSet&)), this, SLOT(selected_map_changes_committed(const MapChangeSet&)));
 			connect(selected_map_, SIGNAL(bb_vertex_attribute_changed(const QString&)), this, SLOT(selected_map_bb_vertex_attribute_changed(const QString&)));
-//			connect(selected_map_, SIGNAL(connectivity_changed()), this, SLOT(selected_map_connectivity_changed()));
+			connect(selected_map_, SIGNAL(connectivity_changed()), this, SLOT(selected_map_connectivity_changed()));
+			connect(selected_map_, SIGNAL(undo_stack_changed()), this, SLOT(selected_map_undo_stack_changed()));
 //			connect(selected_map_, SIGNAL(cell_selector_added(unsigned int, const QString&)), this, SLOT(selected_map_cell_selector_added(unsigned int, const QString&)));
 //			connect(selected_map_, SIGNAL(cell_selector_removed(unsigned int, const QString&)), this, SLOT(selected_map_cell_selector_removed(unsigned int, const QString&)));
 
@@ -155,8 +161,8 @@ void ControlDock_MapTab::duplicate_current_map_clicked()
 {
 	if (!updating_ui_)
 	{
-//		if (selected_map_)
-//			schnapps_->duplicate_map(selected_map_->get_name(), true);
+		if (selected_map_)
+			schnapps_->duplicate_map(selected_map_->get_name(), true);
 	}
 }
 
@@ -169,6 +175,34 @@ void ControlDock_MapTab::remove_current_map_clicked()
 	}
 }
 
+void ControlDock_MapTab::undo_clicked()
+{
+	if (!updating_ui_)
+	{
+		// the GUI does not wait for a job writing the map:
+		// the buttons are enabled again when the changes of the writer are published
+		if (selected_map_ && !selected_map_->try_undo())
+		{
+			button_undo->setEnabled(false);
+			button_redo->setEnabled(false);
+		}
+	}
+}
+
+void ControlDock_MapTab::redo_clicked()
+{
+	if (!updating_ui_)
+	{
+		// the GUI does not wait for a job writing the map:
+		// the buttons are enabled again when the changes of the writer are published
+		if (selected_map_ && !selected_map_->try_redo())
+		{
+			button_undo->setEnabled(false);
+			button_redo->setEnabled(false);
+		}
+	}
+}
+
 void ControlDock_MapTab::show_bb_changed(bool b)
 {
 	if (!updating_ui_)
@@ -203,6 +237,148 @@ void ControlDock_MapTab::vertex_attribute_check_state_changed(QListWidgetItem* i
 	}
 }
 
+void ControlDock_MapTab::vertex_attribute_context_menu(const QPoint& pos)
+{
+	QListWidgetItem* item = list_vertexAttributes->itemAt(pos);
+	if (!item || !selected_map_)
+		return;
+
+	const QString name = item->text();
+
+	QMenu menu(this);
+	QAction* evict = menu.addAction("Evict to disk");
+	QAction* compress = menu.addAction("Compress");
+	QAction* compress_lossy = menu.addAction("Compress (lossy)");
+	menu.addSeparator();
+	QAction* compressible = menu.addAction("Compress when memory is low");
+	compressible->setCheckable(true);
+	compressible->setChecked(selected_map_->is_attribute_compressible(name));
+
+	QAction* action = menu.exec(list_vertexAttributes->viewport()->mapToGlobal(pos));
+	if (!action)
+		return;
+
+	if (action == compressible)
+	{
+		selected_map_->set_attribute_compressible(name, compressible->isChecked());
+		return;
+	}
+
+	bool res = false;
+	if (action == evict)
+		res = selected_map_->evict_attribute(name);
+	else if (action == compress)
+		res = selected_map_->compress_attribute(name, false);
+	else if (action == compress_lossy)
+		res = selected_map_->compress_attribute(name, true);
+
+	// the stored attribute is no longer in the map
+	if (res)
+		update_selected_map_info();
+}
+
+void ControlDock_MapTab::compact_current_map_clicked()
+{
+	if (!updating_ui_)
+	{
+		if (selected_map_)
+			selected_map_->compact();
+	}
+}
+
+void ControlDock_MapTab::update_memory_report()
+{
+	tree_memory->clear();
+
+	if (!selected_map_)
+	{
+		label_memoryTotal->setText("-");
+		return;
+	}
+
+	MapMemoryReport report;
+	if (!selected_map_->get_memory_report(report))
+	{
+		label_memoryTotal->setText("map is being modified");
+		return;
+	}
+
+	for (const ContainerMemory& c : report.containers_)
+	{
+		QTreeWidgetItem* citem = new QTreeWidgetItem(tree_memory);
+		citem->setText(0, QString("%1 (%2 / %3 / %4 lines)").arg(c.name_).arg(c.nb_lines_).arg(c.end_).arg(c.capacity_));
+		citem->setText(1, format_bytes(c.used()));
+		citem->setText(2, format_bytes(c.allocated()));
+		// containers with many holes are worth compacting
+		if (c.holes_ratio() > MapMemoryReport::HOLES_THRESHOLD)
+		{
+			citem->setToolTip(0, QString("%1% of the lines are holes").arg(int(c.holes_ratio() * 100.0f)));
+			for (int i = 0; i < 3; ++i)
+				citem->setForeground(i, QBrush(Qt::red));
+		}
+		for (const MemoryBlock& b : c.attributes_)
+		{
+			QTreeWidgetItem* item = new QTreeWidgetItem(citem);
+			item->setText(0, b.name_ + " (" + b.type_ + ")");
+			item->setText(1, format_bytes(b.used_));
+			item->setText(2, format_bytes(b.allocated_));
+		}
+	}
+
+	if (!report.caches_.empty())
+	{
+		QTreeWidgetItem* citem = new QTreeWidgetItem(tree_memory);
+		citem->setText(0, "Caches");
+		for (const MemoryBlock& b : report.caches_)
+		{
+			QTreeWidgetItem* item = new QTreeWidgetItem(citem);
+			item->setText(0, b.name_ + " (" + b.type_ + ")");
+			item->setText(1, format_bytes(b.used_));
+			item->setText(2, format_bytes(b.allocated_));
+		}
+	}
+
+	if (!report.index_buffers_.empty())
+	{
+		QTreeWidgetItem* iitem = new QTreeWidgetItem(tree_memory);
+		iitem->setText(0, "Index buffers (GPU)");
+		for (const MemoryBlock& b : report.index_buffers_)
+		{
+			QTreeWidgetItem* item = new QTreeWidgetItem(iitem);
+			item->setText(0, b.name_);
+			item->setText(2, format_bytes(b.allocated_));
+		}
+	}
+
+	if (!report.vbos_.empty())
+	{
+		QTreeWidgetItem* vitem = new QTreeWidgetItem(tree_memory);
+		vitem->setText(0, "VBOs (GPU)");
+		for (const MemoryBlock& b : report.vbos_)
+		{
+			QTreeWidgetItem* item = new QTreeWidgetItem(vitem);
+			item->setText(0, b.name_ + " (" + b.type_ + ")");
+			item->setText(2, format_bytes(b.allocated_));
+		}
+	}
+
+	if (!report.stored_attributes_.empty())
+	{
+		QTreeWidgetItem* sitem = new QTreeWidgetItem(tree_memory);
+		sitem->setText(0, "Stored attributes (out of the map)");
+		for (const MemoryBlock& b : report.stored_attributes_)
+		{
+			QTreeWidgetItem* item = new QTreeWidgetItem(sitem);
+			item->setText(0, b.name_ + " (" + b.type_ + ")");
+			item->setText(2, format_bytes(b.allocated_));
+		}
+	}
+
+	label_memoryTotal->setText(QString("%1 used / %2 allocated (%3 wasted) - %4 on GPU")
+		.arg(format_bytes(report.used())).arg(format_bytes(report.allocated()))
+		.arg(format_bytes(report.wasted())).arg(format_bytes(report.gpu())));
+}
+
 //void ControlDock_MapTab::selected_selector_changed()
 //{
 //	if (!updating_ui_)
@@ -328,9 +504,10 @@ void ControlDock_MapTab::map_removed(MapHandlerGen* m)
 
 
 
-void ControlDock_MapTab::selected_map_attribute_added(cgogn::Orbit orbit, const QString& name)
+void ControlDock_MapTab::selected_map_changes_committed(const MapChangeSet& changes)
 {
 	update_selected_map_info();
+	selected_map_undo_stack_changed();
 }
 
 void ControlDock_MapTab::selected_map_bb_vertex_attribute_changed(const QString& name)
@@ -338,20 +515,25 @@ void ControlDock_MapTab::selected_map_bb_vertex_attribute_changed(const QString&
 	update_selected_map_info();
 }
 
-void ControlDock_MapTab::selected_map_vbo_added(cgogn::rendering::VBO* vbo)
+void ControlDock_MapTab::selected_map_connectivity_changed()
 {
 	update_selected_map_info();
 }
 
-void ControlDock_MapTab::selected_map_vbo_removed(cgogn::rendering::VBO* vbo)
+void ControlDock_MapTab::selected_map_undo_stack_changed()
 {
-	update_selected_map_info();
-}
+	if (!selected_map_)
+	{
+		button_undo->setEnabled(false);
+		button_redo->setEnabled(false);
+		return;
+	}
 
-//void ControlDock_MapTab::selected_map_connectivity_changed()
-//{
-//	update_selected_map_info();
-//}
+	QStringList history = selected_map_->get_undo_history();
+	button_undo->setToolTip(history.empty() ? QString() : QString("undo ") + history.first());
+	button_undo->setEnabled(selected_map_->can_undo());
+	button_redo->setEnabled(selected_map_->can_redo());
+}
 
 //void ControlDock_MapTab::selected_map_cell_selector_added(unsigned int orbit, const QString& name)
 //{
@@ -551,6 +733,9 @@ void ControlDock_MapTab::update_selected_map_info()
 		label_volumeNbCells->setText(QString::number(0));
 	}
 
+	update_memory_report();
+	selected_map_undo_stack_changed();
+
 	updating_ui_ = false;
 }
 
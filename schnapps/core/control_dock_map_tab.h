@@ -60,10 +60,15 @@ private slots:
 
 	void duplicate_current_map_clicked();
 	void remove_current_map_clicked();
+	void undo_clicked();
+	void redo_clicked();
 
 	void show_bb_changed(bool b);
 	void bb_vertex_attribute_changed(int index);
 	void vertex_attribute_check_state_changed(QListWidgetItem* item);
+	void vertex_attribute_context_menu(const QPoint& pos);
+	void update_memory_report();
+	void compact_current_map_clicked();
 
 //	void selected_selector_changed();
 //	void selector_check_state_changed(QListWidgetItem* item);
@@ -75,11 +80,10 @@ private slots:
 	void map_removed(MapHandlerGen* m);
 
 	// slots called from selected MapHandler signals
-	void selected_map_attribute_added(cgogn::Orbit orbit, const QString& name);
+	void selected_map_changes_committed(const MapChangeSet& changes);
 	void selected_map_bb_vertex_attribute_changed(const QString& name);
-	void selected_map_vbo_added(cgogn::rendering::VBO* vbo);
-	void selected_map_vbo_removed(cgogn::rendering::VBO* vbo);
-//	void selected_map_connectivity_changed();
+	void selected_map_connectivity_changed();
+	void selected_map_undo_stack_changed();
 //	void selected_map_cell_selector_added(unsigned int orbit, const QString& name);
 //	void selected_map_cell_selector_removed(unsigned int orbit, const QString& name);
 
@@ -73,8 +73,10 @@ void ControlDock_PluginTab::enable_selected_plugins_clicked()
 	if(!updating_ui_)
 	{
 		QList<QListWidgetItem*> items = list_pluginsAvailable->selectedItems();
+		QStringList names;
 		foreach(QListWidgetItem* item, items)
-			schnapps_->enable_plugin(item->text());
+			names.append(item->text());
+		schnapps_->enable_plugins(names.join(";"));
 	}
 }
 
@@ -0,0 +1,265 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/frame_recorder.h>
+
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_3_3_Core>
+#include <QImage>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace schnapps
+{
+
+FrameRecorder::FrameRecorder(unsigned int nb_buffers, unsigned int nb_encoders, unsigned int max_queued_images) :
+	gl_(nullptr),
+	next_buffer_(0),
+	nb_frames_(0),
+	nb_pending_images_(0),
+	nb_encoders_(std::max(nb_encoders, 1u)),
+	max_queued_images_(std::max(max_queued_images, 1u)),
+	stop_encoders_(false)
+{
+	for (unsigned int i = 0; i < std::max(nb_buffers, 2u); ++i)
+		buffers_.push_back(std::unique_ptr<ReadbackBuffer>(new ReadbackBuffer()));
+}
+
+FrameRecorder::~FrameRecorder()
+{
+	wait_for_done();
+	{
+		std::lock_guard<std::mutex> lock(encoding_mutex_);
+		stop_encoders_ = true;
+	}
+	encoding_changed_.notify_all();
+	for (std::thread& t : encoders_)
+		t.join();
+}
+
+bool FrameRecorder::init_functions()
+{
+	if (!gl_)
+	{
+		QOpenGLContext* context = QOpenGLContext::currentContext();
+		if (!context)
+			return false;
+		gl_ = context->versionFunctions<QOpenGLFunctions_3_3_Core>();
+		if (!gl_ || !gl_->initializeOpenGLFunctions())
+		{
+			gl_ = nullptr;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FrameRecorder::begin_frame(int width, int height)
+{
+	if (!init_functions())
+		return false;
+
+	if (!fbo_ || fbo_->width() != width || fbo_->height() != height)
+	{
+		QOpenGLFramebufferObjectFormat format;
+		format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+		fbo_.reset(new QOpenGLFramebufferObject(width, height, format));
+	}
+
+	if (!fbo_->isValid() || !fbo_->bind())
+		return false;
+
+	gl_->glViewport(0, 0, width, height);
+	return true;
+}
+
+void FrameRecorder::end_frame(const QString& filename, bool blit_to_default)
+{
+	if (!fbo_ || !gl_)
+		return;
+
+	const int width = fbo_->width();
+	const int height = fbo_->height();
+
+	// the ring is full: the oldest readback has to be completed
+	ReadbackBuffer& buffer = *buffers_[next_buffer_];
+	if (buffer.pending_)
+		retrieve(buffer, true);
+
+	if (!buffer.pbo_.isCreated())
+	{
+		buffer.pbo_.create();
+		buffer.pbo_.setUsagePattern(QOpenGLBuffer::StreamRead);
+	}
+	buffer.pbo_.bind();
+	if (buffer.width_ != width || buffer.height_ != height)
+	{
+		buffer.pbo_.allocate(width * height * 4);
+		buffer.width_ = width;
+		buffer.height_ = height;
+	}
+
+	// asynchronous copy of the framebuffer into the PBO
+	gl_->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	gl_->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	buffer.pbo_.release();
+
+	buffer.fence_ = gl_->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	buffer.filename_ = filename;
+	buffer.pending_ = true;
+
+	next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+	++nb_frames_;
+
+	if (blit_to_default)
+		QOpenGLFramebufferObject::blitFramebuffer(nullptr, QRect(0, 0, width, height), fbo_.get(), QRect(0, 0, width, height));
+
+	QOpenGLFramebufferObject::bindDefault();
+
+	// retrieve the readbacks that are already completed (no wait)
+	for (std::size_t i = 0; i < buffers_.size(); ++i)
+	{
+		ReadbackBuffer& b = *buffers_[(next_buffer_ + i) % buffers_.size()];
+		if (b.pending_ && !retrieve(b, false))
+			break;
+	}
+}
+
+bool FrameRecorder::retrieve(ReadbackBuffer& buffer, bool wait)
+{
+	GLenum status = gl_->glClientWaitSync(buffer.fence_, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GLuint64(1000000000) : GLuint64(0));
+	// a blocking retrieval waits until the GPU has written the PBO, however long it takes
+	while (wait && status == GL_TIMEOUT_EXPIRED)
+		status = gl_->glClientWaitSync(buffer.fence_, 0, GLuint64(1000000000));
+	if (status == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	gl_->glDeleteSync(buffer.fence_);
+	buffer.fence_ = nullptr;
+	buffer.pending_ = false;
+
+	// the fence cannot be waited for (e.g. lost context): the content of the PBO is unknown, the frame is dropped
+	if (status == GL_WAIT_FAILED)
+	{
+		std::cerr << "FrameRecorder: readback of " << buffer.filename_.toStdString() << " failed, the frame is dropped" << std::endl;
+		return true;
+	}
+
+	QImage image(buffer.width_, buffer.height_, QImage::Format_RGBA8888);
+
+	buffer.pbo_.bind();
+	const void* data = buffer.pbo_.mapRange(0, buffer.width_ * buffer.height_ * 4, QOpenGLBuffer::RangeRead);
+	if (data)
+		std::memcpy(image.bits(), data, buffer.width_ * buffer.height_ * 4);
+	buffer.pbo_.unmap();
+	buffer.pbo_.release();
+
+	if (!data)
+		return true;
+
+	queue_image(image, buffer.filename_);
+
+	return true;
+}
+
+void FrameRecorder::flush()
+{
+	if (!gl_)
+		return;
+
+	for (std::size_t i = 0; i < buffers_.size(); ++i)
+	{
+		ReadbackBuffer& b = *buffers_[(next_buffer_ + i) % buffers_.size()];
+		if (b.pending_)
+			retrieve(b, true);
+	}
+}
+
+void FrameRecorder::release()
+{
+	flush();
+	for (auto& b : buffers_)
+	{
+		b->pbo_.destroy();
+		b->width_ = 0;
+		b->height_ = 0;
+	}
+	fbo_.reset();
+}
+
+void FrameRecorder::queue_image(const QImage& image, const QString& filename)
+{
+	std::unique_lock<std::mutex> lock(encoding_mutex_);
+	if (encoders_.empty())
+	{
+		for (unsigned int i = 0; i < nb_encoders_; ++i)
+			encoders_.emplace_back(&FrameRecorder::encode, this);
+	}
+
+	// the capture is throttled by the encoders: the memory of the queued images is bounded
+	encoding_changed_.wait(lock, [this] () { return encoding_queue_.size() < max_queued_images_; });
+	EncodedImage e;
+	e.image_ = image;
+	e.filename_ = filename;
+	encoding_queue_.push_back(e);
+	++nb_pending_images_;
+	lock.unlock();
+	encoding_changed_.notify_all();
+}
+
+void FrameRecorder::encode()
+{
+	for (;;)
+	{
+		EncodedImage e;
+		{
+			std::unique_lock<std::mutex> lock(encoding_mutex_);
+			encoding_changed_.wait(lock, [this] () { return stop_encoders_ || !encoding_queue_.empty(); });
+			if (encoding_queue_.empty())
+				return;
+			e = encoding_queue_.front();
+			encoding_queue_.pop_front();
+		}
+		encoding_changed_.notify_all();
+
+		// flip (OpenGL rows are bottom-up) & encode
+		if (!e.image_.mirrored().save(e.filename_))
+			std::cerr << "FrameRecorder: unable to write " << e.filename_.toStdString() << std::endl;
+
+		{
+			std::lock_guard<std::mutex> lock(encoding_mutex_);
+			--nb_pending_images_;
+		}
+		encoding_changed_.notify_all();
+	}
+}
+
+void FrameRecorder::wait_for_done()
+{
+	std::unique_lock<std::mutex> lock(encoding_mutex_);
+	encoding_changed_.wait(lock, [this] () { return nb_pending_images_.load() == 0; });
+}
+
+} // namespace schnapps
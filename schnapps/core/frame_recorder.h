@@ -0,0 +1,156 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_FRAME_RECORDER_H_
+#define SCHNAPPS_CORE_FRAME_RECORDER_H_
+
+#include <schnapps/core/dll.h>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFramebufferObject>
+#include <QString>
+
+#include <QImage>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class QOpenGLFunctions_3_3_Core;
+
+typedef struct __GLsync* GLsync;
+
+namespace schnapps
+{
+
+/**
+* @brief The FrameRecorder renders frames in an offscreen framebuffer and saves them without stalling the rendering.
+* Pixels are read back asynchronously in a ring of pixel buffer objects (PBO):
+* a frame is copied to the CPU only when the GPU has finished writing it, usually several frames later.
+* Images are then encoded (format deduced from the file suffix) by encoder threads of the recorder, not by
+* the shared ThreadPool: recording does not wait behind the processing jobs. The queue of images to encode is
+* bounded: when it is full, the capture waits for the encoders (no frame is dropped).
+*
+* All methods except wait_for_done() must be called with the OpenGL context of the rendering current.
+*/
+class SCHNAPPS_CORE_API FrameRecorder
+{
+public:
+
+	/**
+	 * @brief FrameRecorder constructor
+	 * @param nb_buffers number of PBOs of the readback ring (2: double buffering, 3: triple buffering)
+	 * @param nb_encoders number of encoder threads (started with the first image)
+	 * @param max_queued_images maximal number of images waiting for an encoder
+	 */
+	FrameRecorder(unsigned int nb_buffers = 3, unsigned int nb_encoders = 2, unsigned int max_queued_images = 8);
+	~FrameRecorder();
+
+	FrameRecorder(const FrameRecorder&) = delete;
+	FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+	/**
+	 * @brief bind the offscreen framebuffer, (re)allocated with the given size if needed
+	 * @return true if the framebuffer is bound and ready for drawing
+	 */
+	bool begin_frame(int width, int height);
+
+	/**
+	 * @brief start the readback of the frame drawn since begin_frame
+	 * @param filename name of the image file to write
+	 * @param blit_to_default copy the frame in the default framebuffer of the context (for display)
+	 */
+	void end_frame(const QString& filename, bool blit_to_default);
+
+	/**
+	 * @brief wait for all pending readbacks and queue their encoding
+	 */
+	void flush();
+
+	/**
+	 * @brief flush and release the OpenGL objects
+	 */
+	void release();
+
+	/**
+	 * @brief wait until all the queued images have been written (no OpenGL context needed)
+	 */
+	void wait_for_done();
+
+	inline unsigned int nb_frames() const { return nb_frames_; }
+	inline unsigned int nb_pending_images() const { return nb_pending_images_.load(); }
+
+private:
+
+	struct ReadbackBuffer
+	{
+		ReadbackBuffer() : pbo_(QOpenGLBuffer::PixelPackBuffer), fence_(nullptr), width_(0), height_(0), pending_(false) {}
+		QOpenGLBuffer pbo_;
+		GLsync fence_;
+		QString filename_;
+		int width_;
+		int height_;
+		bool pending_;
+	};
+
+	struct EncodedImage
+	{
+		QImage image_;
+		QString filename_;
+	};
+
+	bool init_functions();
+	// queue an image, waits while the queue is full
+	void queue_image(const QImage& image, const QString& filename);
+	// loop of the encoder threads
+	void encode();
+	// copy a completed readback to the CPU and queue its encoding
+	// returns false if the readback is not completed (only when wait is false)
+	bool retrieve(ReadbackBuffer& buffer, bool wait);
+
+	QOpenGLFunctions_3_3_Core* gl_;
+
+	std::unique_ptr<QOpenGLFramebufferObject> fbo_;
+	std::vector<std::unique_ptr<ReadbackBuffer>> buffers_;
+	unsigned int next_buffer_;
+	unsigned int nb_frames_;
+
+	// images queued or being encoded
+	std::atomic<unsigned int> nb_pending_images_;
+	unsigned int nb_encoders_;
+	std::size_t max_queued_images_;
+	std::vector<std::thread> encoders_;
+	std::deque<EncodedImage> encoding_queue_;
+	bool stop_encoders_;
+	// protects encoding_queue_ and stop_encoders_, encoding_changed_ is notified on each change of the queue
+	std::mutex encoding_mutex_;
+	std::condition_variable encoding_changed_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_FRAME_RECORDER_H_
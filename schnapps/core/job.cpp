@@ -0,0 +1,126 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/job.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <algorithm>
+#include <iostream>
+
+namespace schnapps
+{
+
+Job::Job(const QString& name, const Task& task, const Continuation& continuation, MapHandlerGen* map) :
+	name_(name),
+	task_(task),
+	continuation_(continuation),
+	map_(map),
+	elapsed_(-1),
+	progress_(0),
+	canceled_(false),
+	committed_(false),
+	done_(false)
+{}
+
+Job::~Job()
+{
+	// a job is deleted by its owner only once its task has ended
+	wait();
+}
+
+void Job::start(ThreadPool& pool)
+{
+	timer_.start();
+	pool.submit_job([this] () { run(); });
+}
+
+void Job::set_progress(double p)
+{
+	const int permille = int(std::min(std::max(p, 0.0), 1.0) * 1000.0);
+	// only emit when the displayed value changes (the signal is queued to the GUI thread)
+	if (progress_.exchange(permille) / 10 != permille / 10)
+		emit(progress_changed(double(permille) / 1000.0));
+}
+
+bool Job::is_done() const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return done_;
+}
+
+void Job::wait() const
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_condition_.wait(lock, [this] () { return done_; });
+}
+
+bool Job::commit()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	committed_ = !canceled_;
+	return committed_;
+}
+
+void Job::cancel()
+{
+	// the results of a committed task are published by the continuation
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!committed_ && !done_)
+		canceled_ = true;
+}
+
+void Job::run()
+{
+	if (!canceled_)
+	{
+		try
+		{
+			task_(*this);
+		}
+		catch (const std::exception& e)
+		{
+			std::cerr << "Job " << name_.toStdString() << ": " << e.what() << std::endl;
+			canceled_ = true;
+		}
+	}
+	elapsed_ = timer_.elapsed();
+
+	// the continuation is delivered to the thread of the job object
+	// (posted before signaling the end: the job may be deleted as soon as it is done)
+	QMetaObject::invokeMethod(this, "complete", Qt::QueuedConnection);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	done_ = true;
+	done_condition_.notify_all();
+}
+
+void Job::complete()
+{
+	// the messages of the continuation follow the end of the job
+	emit(finished(this));
+	if (!canceled_ && continuation_)
+		continuation_(*this);
+	this->deleteLater();
+}
+
+} // namespace schnapps
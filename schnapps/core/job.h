@@ -0,0 +1,167 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_JOB_H_
+#define SCHNAPPS_CORE_JOB_H_
+
+#include <schnapps/core/dll.h>
+
+#include <QObject>
+#include <QString>
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+
+namespace schnapps
+{
+
+class ThreadPool;
+class MapHandlerGen;
+
+/**
+* @brief A Job runs a task on the shared ThreadPool (see SCHNApps::submit_job).
+* The task receives the job to report its progress and to check whether it has been canceled.
+* The continuation is called on the GUI thread (thread of the job object) once the task
+* has ended without being canceled: this is where results are published (VBO updates, signals...).
+* The job deletes itself after having emitted finished() and called the continuation.
+*/
+class SCHNAPPS_CORE_API Job : public QObject
+{
+	Q_OBJECT
+
+public:
+
+	using Task = std::function<void(Job&)>;
+	using Continuation = std::function<void(Job&)>;
+
+	/**
+	 * @brief Job constructor (the job has to be started)
+	 * @param name name of the job (shown in the status bar)
+	 * @param task function executed by a worker thread
+	 * @param continuation function executed by the GUI thread after the task (may be empty)
+	 * @param map map used by the task (may be nullptr)
+	 */
+	Job(const QString& name, const Task& task, const Continuation& continuation, MapHandlerGen* map = nullptr);
+	~Job();
+
+	inline const QString& get_name() const { return name_; }
+
+	/**
+	 * @brief get the map used by the task (the map is not deleted before the end of the task)
+	 */
+	inline MapHandlerGen* get_map() const { return map_; }
+
+	/**
+	 * @brief queue the task in the pool
+	 */
+	void start(ThreadPool& pool);
+
+	/**
+	 * @brief report the progress of the task (thread-safe, called by the task)
+	 * @param p progress in [0, 1]
+	 */
+	void set_progress(double p);
+
+	/**
+	 * @brief get the last reported progress in [0, 1]
+	 */
+	inline double get_progress() const { return double(progress_.load()) / 1000.0; }
+
+	/**
+	 * @brief test if the job has been canceled (thread-safe, polled by the task)
+	 */
+	inline bool is_canceled() const { return canceled_.load(); }
+
+	/**
+	 * @brief mark the results of the task as published (thread-safe, called by the task before writing them)
+	 * Once committed, the job cannot be canceled anymore and its continuation is called.
+	 * @return false if the job has been canceled (the task must leave the data untouched)
+	 */
+	bool commit();
+
+	/**
+	 * @brief test if the task has ended (the continuation may not have been called yet)
+	 */
+	bool is_done() const;
+
+	/**
+	 * @brief block until the end of the task (the continuation is not called)
+	 */
+	void wait() const;
+
+	/**
+	 * @brief duration of the task in milliseconds (up to now if it is running)
+	 */
+	inline qint64 get_elapsed() const { return elapsed_.load() >= 0 ? elapsed_.load() : timer_.elapsed(); }
+
+public slots:
+
+	/**
+	 * @brief ask the task to stop (the continuation will not be called), ignored once the task has committed
+	 */
+	void cancel();
+
+signals:
+
+	void progress_changed(double);
+
+	/**
+	 * @brief emitted on the GUI thread just before the continuation (the job is deleted afterwards)
+	 * @param job the job
+	 */
+	void finished(Job* job);
+
+private:
+
+	void run();
+
+private slots:
+
+	void complete();
+
+private:
+
+	QString name_;
+	Task task_;
+	Continuation continuation_;
+	MapHandlerGen* map_;
+
+	QElapsedTimer timer_;
+	std::atomic<qint64> elapsed_;
+
+	// progress in 1/1000th
+	std::atomic<int> progress_;
+	std::atomic<bool> canceled_;
+
+	bool committed_;
+	bool done_;
+	mutable std::mutex mutex_;
+	mutable std::condition_variable done_condition_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_JOB_H_
@@ -0,0 +1,131 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_MAP_ADJACENCY_H_
+#define SCHNAPPS_CORE_MAP_ADJACENCY_H_
+
+#include <schnapps/core/types.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <functional>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Relation stored in compressed sparse row (CSR) format
+* The targets of the source i are indices_[offsets_[i]] .. indices_[offsets_[i+1] - 1].
+*/
+struct CSRRelation
+{
+	std::vector<uint32> offsets_;
+	std::vector<uint32> indices_;
+
+	inline uint32 nb_sources() const { return offsets_.empty() ? 0u : uint32(offsets_.size() - 1u); }
+	inline uint32 degree(uint32 i) const { return offsets_[i + 1u] - offsets_[i]; }
+	inline const uint32* begin(uint32 i) const { return indices_.data() + offsets_[i]; }
+	inline const uint32* end(uint32 i) const { return indices_.data() + offsets_[i + 1u]; }
+
+	inline uint64 memory() const { return uint64(offsets_.capacity() + indices_.capacity()) * sizeof(uint32); }
+
+	/**
+	 * @brief fill the relation in parallel
+	 * @param nb_sources number of sources
+	 * @param foreach_target function (i, f) calling f(j) for each target j of the source i
+	 * (called twice per source: once to count the targets, once to store them)
+	 */
+	template <typename FUNC>
+	void build(uint32 nb_sources, const FUNC& foreach_target)
+	{
+		ThreadPool& pool = ThreadPool::instance();
+
+		offsets_.assign(nb_sources + 1u, 0u);
+		pool.parallel_for(0, nb_sources, [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				uint32 degree = 0u;
+				foreach_target(uint32(i), std::function<void(uint32)>([&] (uint32) { ++degree; }));
+				offsets_[i + 1u] = degree;
+			}
+		});
+
+		for (uint32 i = 0u; i < nb_sources; ++i)
+			offsets_[i + 1u] += offsets_[i];
+
+		indices_.resize(offsets_[nb_sources]);
+		pool.parallel_for(0, nb_sources, [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				uint32 k = offsets_[i];
+				foreach_target(uint32(i), std::function<void(uint32)>([&] (uint32 j) { indices_[k++] = j; }));
+			}
+		});
+	}
+};
+
+/**
+* @brief Vertex and face adjacency of a map in CSR format (see MapHandlerGen::get_adjacency)
+* The vertices and the faces are numbered from 0 in the order of the traversal of the map:
+* neighborhood kernels iterate contiguous arrays instead of following the darts.
+* vertex_lines_ / face_lines_ give the line of each cell in its attribute container, to gather
+* attributes in contiguous arrays and to scatter the results back (face_lines_ is empty if the
+* faces of the map are not embedded). face_darts_ give a dart of each face to get back to the map.
+*/
+struct MapAdjacency
+{
+	MapAdjacency() : connectivity_version_(0u) {}
+
+	// version of the connectivity of the map when the adjacency was built
+	uint32 connectivity_version_;
+
+	std::vector<uint32> vertex_lines_;
+	std::vector<uint32> face_lines_;
+	// index of a dart of each face
+	std::vector<uint32> face_darts_;
+
+	// vertices adjacent through an edge, in the order of the turn around the vertex
+	CSRRelation vertex_vertex_;
+	// faces incident to each vertex
+	CSRRelation vertex_face_;
+	// vertices of each face, in the order of the boundary of the face
+	CSRRelation face_vertex_;
+
+	// vertices incident to a boundary dart
+	std::vector<uint8> boundary_vertex_;
+
+	inline uint32 nb_vertices() const { return uint32(vertex_lines_.size()); }
+	inline uint32 nb_faces() const { return face_vertex_.nb_sources(); }
+
+	inline uint64 memory() const
+	{
+		return uint64(vertex_lines_.capacity() + face_lines_.capacity() + face_darts_.capacity()) * sizeof(uint32) + boundary_vertex_.capacity() +
+			vertex_vertex_.memory() + vertex_face_.memory() + face_vertex_.memory();
+	}
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_MAP_ADJACENCY_H_
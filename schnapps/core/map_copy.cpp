@@ -0,0 +1,115 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/map_copy.h>
+
+#include <sstream>
+#include <string>
+
+namespace schnapps
+{
+
+namespace
+{
+
+using CMap2 = cgogn::CMap2<cgogn::DefaultMapTraits>;
+using CMap3 = cgogn::CMap3<cgogn::DefaultMapTraits>;
+
+/**
+* @brief map filled with the containers of another map (the copy is then used as a MAP)
+* The containers are serialized chunk by chunk (ChunkArrayContainer::save) and loaded in the copy,
+* which keeps the layout of the lines: holes, reference counters and free lines are preserved.
+*/
+template <typename MAP>
+class MapDataCopy : public MAP
+{
+public:
+
+	bool copy_containers(const MAP& source)
+	{
+		std::stringstream buffer(std::ios::in | std::ios::out | std::ios::binary);
+		source.get_topology_container().save(buffer);
+		if (!this->topology_.load(buffer))
+			return false;
+		return OrbitCopy<0u>::copy(*this, source);
+	}
+
+private:
+
+	template <uint32 ORBIT, bool END = (ORBIT == cgogn::NB_ORBITS)>
+	struct OrbitCopy
+	{
+		static bool copy(MapDataCopy& copy, const MAP& source)
+		{
+			return copy.template copy_orbit<cgogn::Orbit(ORBIT)>(source) && OrbitCopy<ORBIT + 1u>::copy(copy, source);
+		}
+	};
+
+	template <uint32 ORBIT>
+	struct OrbitCopy<ORBIT, true>
+	{
+		static bool copy(MapDataCopy&, const MAP&) { return true; }
+	};
+
+	template <cgogn::Orbit ORBIT>
+	bool copy_orbit(const MAP& source)
+	{
+		if (!source.template is_embedded<ORBIT>())
+			return true;
+
+		std::stringstream buffer(std::ios::in | std::ios::out | std::ios::binary);
+		source.template get_attribute_container<ORBIT>().save(buffer);
+		if (!this->attributes_[ORBIT].load(buffer))
+			return false;
+
+		// the embedding array has been copied with the topology
+		this->embeddings_[ORBIT] = this->topology_.template get_chunk_array<uint32>(std::string("EMB_") + cgogn::orbit_name(ORBIT));
+		return this->embeddings_[ORBIT] != nullptr;
+	}
+};
+
+template <typename MAP>
+MAP* copy_map_containers(const MAP& map)
+{
+	MapDataCopy<MAP>* copy = new MapDataCopy<MAP>();
+	if (!copy->copy_containers(map))
+	{
+		delete copy;
+		return nullptr;
+	}
+	return copy;
+}
+
+} // namespace
+
+CMap2* copy_map(const CMap2& map)
+{
+	return copy_map_containers(map);
+}
+
+CMap3* copy_map(const CMap3& map)
+{
+	return copy_map_containers(map);
+}
+
+} // namespace schnapps
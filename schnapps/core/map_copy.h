@@ -0,0 +1,53 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_MAP_COPY_H_
+#define SCHNAPPS_CORE_MAP_COPY_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+
+#include <cgogn/core/cmap/cmap2.h>
+#include <cgogn/core/cmap/cmap3.h>
+
+namespace schnapps
+{
+
+/**
+* @brief build a deep copy of a surface map
+* The topology and the attribute containers of all the orbits are copied chunk by chunk with their
+* holes and reference counters: the darts and the cells keep their indices, so that the attribute
+* lines, the index buffers and the cached adjacency of the map are valid for the copy.
+* @param map the map to copy
+* @return the copy (to be deleted by the caller)
+*/
+SCHNAPPS_CORE_API cgogn::CMap2<cgogn::DefaultMapTraits>* copy_map(const cgogn::CMap2<cgogn::DefaultMapTraits>& map);
+
+/**
+* @brief build a deep copy of a volume map (see the surface version)
+*/
+SCHNAPPS_CORE_API cgogn::CMap3<cgogn::DefaultMapTraits>* copy_map(const cgogn::CMap3<cgogn::DefaultMapTraits>& map);
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_MAP_COPY_H_
@@ -24,9 +24,19 @@
 #include <schnapps/core/map_handler.h>
 #include <schnapps/core/schnapps.h>
 #include <schnapps/core/view.h>
+#include <schnapps/core/job.h>
 
 #include <cgogn/rendering/drawer.h>
 
+#include <QPointer>
+#include <QTimer>
+
+#include <algorithm>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <utility>
+
 namespace schnapps
 {
 
@@ -36,8 +46,27 @@ MapHandlerGen::MapHandlerGen(const QString& name, SCHNApps* schnapps, MapBaseDat
 	map_(map),
 	show_bb_(true),
 	bb_diagonal_size_(.0f),
-	bb_color_(Qt::green)
+	bb_color_(Qt::green),
+	changes_depth_(0),
+	lock_(std::make_shared<QReadWriteLock>()),
+	version_(0),
+	connectivity_version_(0),
+	adjacency_building_(false),
+	bvh_building_(false),
+	bvh_connectivity_version_(0),
+	bvh_refit_(false),
+	sharing_(std::make_shared<QList<MapHandlerGen*>>()),
+	connectivity_written_(false),
+	undo_topology_(false),
+	can_undo_(false),
+	can_redo_(false),
+	undo_memory_limit_(0),
+	pending_connectivity_(false),
+	publish_queued_(false)
 {
+	sharing_->append(this);
+	access_clock_.start();
+
 	connect(&frame_, SIGNAL(manipulated()), this, SLOT(frame_changed()));
 
 	transformation_matrix_.setToIdentity();
@@ -45,7 +74,15 @@ MapHandlerGen::MapHandlerGen(const QString& name, SCHNApps* schnapps, MapBaseDat
 
 MapHandlerGen::~MapHandlerGen()
 {
-	delete map_;
+	// wait for the end of the current writer
+	lock_->lockForWrite();
+	// the map data are deleted with their last user
+	sharing_->removeOne(this);
+	if (sharing_->empty())
+		delete map_;
+	qDeleteAll(stored_attributes_);
+	stored_attributes_.clear();
+	lock_->unlock();
 }
 
 bool MapHandlerGen::is_selected_map() const
@@ -53,6 +90,878 @@ bool MapHandlerGen::is_selected_map() const
 	return schnapps_->get_selected_map() == this;
 }
 
+/*********************************************************
+ * MANAGE CONCURRENT ACCESS
+ *********************************************************/
+
+void MapHandlerGen::begin_write()
+{
+	lock_->lockForWrite();
+	start_write();
+}
+
+bool MapHandlerGen::try_begin_write()
+{
+	if (!lock_->tryLockForWrite())
+		return false;
+	start_write();
+	return true;
+}
+
+void MapHandlerGen::start_write()
+{
+	written_attributes_.clear();
+	written_chunks_.clear();
+	connectivity_written_ = false;
+	// an undoable operation recording the topology may span several write sections
+	if (!undo_stack_.is_recording())
+		undo_topology_ = false;
+	detach();
+}
+
+void MapHandlerGen::notify_attribute_change(const QString& name)
+{
+	if (!written_attributes_.contains(name))
+		written_attributes_.append(name);
+	// the whole attribute is uploaded
+	written_chunks_.remove(name);
+	attribute_written(name);
+}
+
+void MapHandlerGen::notify_attribute_change(const QString& name, uint32 first_line, uint32 last_line)
+{
+	QSet<uint32> chunks;
+	if (first_line < last_line)
+	{
+		for (uint32 c = chunk_index(first_line); c <= chunk_index(last_line - 1u); ++c)
+			chunks.insert(c);
+	}
+	notify_attribute_change(name, chunks);
+}
+
+void MapHandlerGen::notify_attribute_change(const QString& name, const QSet<uint32>& chunks)
+{
+	if (!written_attributes_.contains(name))
+	{
+		written_attributes_.append(name);
+		written_chunks_.insert(name, chunks);
+	}
+	// an attribute entirely modified by this writer stays so
+	else if (written_chunks_.contains(name))
+		written_chunks_[name].unite(chunks);
+	attribute_written(name);
+}
+
+void MapHandlerGen::attribute_written(const QString& name)
+{
+	touch_attribute(name);
+
+	QMutexLocker locker(&bvh_mutex_);
+	if (bvh_ && bvh_position_ == name)
+		bvh_refit_ = true;
+}
+
+void MapHandlerGen::notify_connectivity_change()
+{
+	connectivity_written_ = true;
+	// the stored values would land on other vertices
+	if (!stored_attributes_.empty())
+		drop_stored_attributes();
+	// the cached adjacency is rebuilt on next request
+	++connectivity_version_;
+}
+
+void MapHandlerGen::end_write()
+{
+	// cells may have been added or removed: the recorded chunks cannot be restored anymore
+	const bool clear_undo = connectivity_written_ && !undo_topology_;
+	if (clear_undo)
+	{
+		const bool recording = undo_stack_.is_recording();
+		undo_stack_.clear();
+		update_undo_state();
+		if (recording)
+			std::cerr << "MapHandlerGen: map " << name_.toStdString() << " connectivity changed during an undoable operation, the undo stack is cleared" << std::endl;
+	}
+
+	{
+		QMutexLocker locker(&pending_mutex_);
+		pending_connectivity_ |= connectivity_written_;
+		foreach (const QString& name, written_attributes_)
+		{
+			const bool partial = written_chunks_.contains(name);
+			if (!pending_attributes_.contains(name))
+			{
+				pending_attributes_.append(name);
+				if (partial)
+					pending_chunks_.insert(name, written_chunks_.value(name));
+			}
+			// the chunks of successive writers are gathered, an attribute entirely modified stays so
+			else if (pending_chunks_.contains(name))
+			{
+				if (partial)
+					pending_chunks_[name].unite(written_chunks_.value(name));
+				else
+					pending_chunks_.remove(name);
+			}
+		}
+	}
+	written_attributes_.clear();
+	written_chunks_.clear();
+	connectivity_written_ = false;
+	++version_;
+	lock_->unlock();
+
+	if (clear_undo)
+		emit(undo_stack_changed());
+
+	// direct call from the GUI thread, queued from a worker thread
+	queue_publication(Qt::AutoConnection);
+}
+
+void MapHandlerGen::queue_publication(Qt::ConnectionType type)
+{
+	// a single publication is queued for successive writers (e.g. simulation steps faster than display)
+	if (!publish_queued_.exchange(true))
+		QMetaObject::invokeMethod(this, "publish_changes", type);
+}
+
+void MapHandlerGen::publish_changes()
+{
+	// another writer (of this map or of a map sharing its lock) already started: try again later
+	if (!lock_->tryLockForRead())
+	{
+		QTimer::singleShot(10, this, SLOT(publish_changes()));
+		return;
+	}
+
+	publish_queued_ = false;
+
+	QStringList attributes;
+	QMap<QString, QSet<uint32>> chunks;
+	bool connectivity = false;
+	{
+		QMutexLocker locker(&pending_mutex_);
+		attributes.swap(pending_attributes_);
+		chunks.swap(pending_chunks_);
+		connectivity = pending_connectivity_;
+		pending_connectivity_ = false;
+	}
+
+	if (connectivity)
+	{
+		for (int p = cgogn::rendering::POINTS; p < cgogn::rendering::SIZE_BUFFER; ++p)
+			render_.set_primitive_dirty(cgogn::rendering::DrawingType(p));
+	}
+
+	// cells may have been added or renumbered: all the VBOs are refreshed
+	// otherwise only the modified chunks are uploaded when the writers declared them
+	for (auto it = vbos_.begin(); it != vbos_.end(); ++it)
+	{
+		if (connectivity)
+			refresh_vbo(it.key(), it.value());
+		else if (attributes.contains(it.key()))
+		{
+			if (!chunks.contains(it.key()) || !refresh_vbo_chunks(it.key(), it.value(), chunks.value(it.key())))
+				refresh_vbo(it.key(), it.value());
+		}
+	}
+
+	foreach (PackedVBO* vbo, packed_vbos_)
+	{
+		if (connectivity || attributes.contains(vbo->get_attribute_name()))
+			refresh_packed_vbo(vbo);
+	}
+
+	const bool update_bb = connectivity || attributes.contains(get_bb_vertex_attribute_name());
+	if (update_bb)
+		compute_bb();
+
+	lock_->unlock();
+
+	if (update_bb)
+	{
+		update_bb_drawer();
+		emit(bb_changed());
+		// the BVH used for picking follows the positions
+		if (!views_.empty())
+			prepare_bvh(get_bb_vertex_attribute_name());
+	}
+
+	if (connectivity)
+		emit(connectivity_changed());
+	foreach (const QString& name, attributes)
+		emit(attribute_changed(name));
+
+	foreach (View* view, views_)
+		view->update();
+}
+
+/*********************************************************
+ * MANAGE COPY-ON-WRITE DUPLICATES
+ *********************************************************/
+
+void MapHandlerGen::share_map_data(MapHandlerGen* source, bool properties)
+{
+	if (source == this)
+		return;
+
+	source->lock_->lockForWrite();
+
+	sharing_->removeOne(this);
+	if (sharing_->empty())
+		delete map_;
+
+	map_ = source->map_;
+	lock_ = source->lock_;
+	sharing_ = source->sharing_;
+	sharing_->append(this);
+
+	for (int p = cgogn::rendering::POINTS; p < cgogn::rendering::SIZE_BUFFER; ++p)
+		render_.set_primitive_dirty(cgogn::rendering::DrawingType(p));
+
+	lock_->unlock();
+
+	if (properties)
+	{
+		show_bb_ = source->show_bb_;
+		bb_color_ = source->bb_color_;
+		transformation_matrix_ = source->transformation_matrix_;
+		frame_.setPosition(source->frame_.position());
+		frame_.setOrientation(source->frame_.orientation());
+
+		begin_changes();
+		foreach (const QString& name, source->vbos_.keys())
+			create_vbo(name);
+		foreach (PackedVBO* vbo, source->packed_vbos_)
+			create_packed_vbo(vbo->get_attribute_name(), vbo->get_format());
+		end_changes();
+
+		const QString bb_name = source->get_bb_vertex_attribute_name();
+		if (!bb_name.isEmpty())
+			set_bb_vertex_attribute(bb_name);
+	}
+}
+
+bool MapHandlerGen::is_shared() const
+{
+	lock_->lockForRead();
+	const bool res = sharing_->size() > 1;
+	lock_->unlock();
+	return res;
+}
+
+void MapHandlerGen::detach()
+{
+	if (sharing_->size() < 2)
+		return;
+
+	MapBaseData* copy = copy_map_data();
+	if (!copy)
+	{
+		std::cerr << "MapHandlerGen::detach: the data of map " << name_.toStdString() << " cannot be copied, they are modified for all its duplicates" << std::endl;
+		return;
+	}
+
+	// only the writer moves to the copy: the data of the other handlers are never replaced under them
+	// (the cells keep their indices: the cached adjacency, the index buffers and the undo stack stay valid)
+	sharing_->removeOne(this);
+	map_ = copy;
+	sharing_ = std::make_shared<QList<MapHandlerGen*>>();
+	sharing_->append(this);
+	rebind_attributes();
+}
+
+/*********************************************************
+ * MANAGE STORED ATTRIBUTES
+ *********************************************************/
+
+bool MapHandlerGen::ensure_attribute(const QString& name)
+{
+	begin_read();
+	const bool stored = stored_attributes_.contains(name);
+	end_read();
+
+	return !stored || restore_attribute(name);
+}
+
+bool MapHandlerGen::evict_attribute(const QString& name)
+{
+	return store_attribute(name, [] (const QString& type_name) -> StoredAttribute*
+	{
+		return new MappedAttribute(type_name);
+	});
+}
+
+bool MapHandlerGen::compress_attribute(const QString& name, bool lossy)
+{
+	return store_attribute(name, [lossy] (const QString& type_name) -> StoredAttribute*
+	{
+		// only float64 based attributes can be narrowed
+		const bool narrow = lossy && (
+			type_name == QString::fromStdString(cgogn::name_of_type(VEC4())) ||
+			type_name == QString::fromStdString(cgogn::name_of_type(VEC3())) ||
+			type_name == QString::fromStdString(cgogn::name_of_type(VEC2())) ||
+			type_name == QString::fromStdString(cgogn::name_of_type(SCALAR()))
+		) && sizeof(SCALAR) == sizeof(float64);
+		return new CompressedAttribute(type_name, narrow);
+	});
+}
+
+bool MapHandlerGen::store_attribute(const QString& name, const StorageFactory& factory)
+{
+	if (name == get_bb_vertex_attribute_name())
+	{
+		std::cerr << "MapHandlerGen::store_attribute: " << name.toStdString() << " is used for the bounding box of map " << name_.toStdString() << std::endl;
+		return false;
+	}
+
+	begin_write();
+	const bool res = !stored_attributes_.contains(name) && store_vertex_attribute(name, factory);
+	end_write();
+
+	if (res)
+		notify_attribute_removed(cgogn::Orbit(get_vertex_container()), name);
+	else
+		std::cerr << "MapHandlerGen::store_attribute: vertex attribute " << name.toStdString() << " cannot be stored" << std::endl;
+
+	return res;
+}
+
+bool MapHandlerGen::restore_attribute(const QString& name)
+{
+	begin_write();
+	StoredAttribute* stored = stored_attributes_.value(name, nullptr);
+	const bool res = stored && restore_vertex_attribute(name, *stored);
+	if (res)
+	{
+		stored_attributes_.remove(name);
+		delete stored;
+		notify_attribute_change(name);
+	}
+	end_write();
+
+	if (res)
+		notify_attribute_added(cgogn::Orbit(get_vertex_container()), name);
+	else
+		std::cerr << "MapHandlerGen::restore_attribute: vertex attribute " << name.toStdString() << " cannot be restored" << std::endl;
+
+	return res;
+}
+
+QStringList MapHandlerGen::get_stored_attributes()
+{
+	begin_read();
+	QStringList res = stored_attributes_.keys();
+	end_read();
+	return res;
+}
+
+bool MapHandlerGen::restore_stored_attributes()
+{
+	bool res = true;
+	foreach (const QString& name, get_stored_attributes())
+		res &= restore_attribute(name);
+	return res;
+}
+
+void MapHandlerGen::drop_stored_attributes()
+{
+	for (auto it = stored_attributes_.constBegin(); it != stored_attributes_.constEnd(); ++it)
+	{
+		std::cerr << "MapHandlerGen: the connectivity of map " << name_.toStdString() << " has changed, stored attribute " << it.key().toStdString() << " is dropped" << std::endl;
+		delete it.value();
+	}
+	stored_attributes_.clear();
+}
+
+void MapHandlerGen::set_attribute_compressible(const QString& name, bool b)
+{
+	QMutexLocker locker(&access_mutex_);
+	if (b)
+		compressible_attributes_.insert(name);
+	else
+		compressible_attributes_.remove(name);
+}
+
+bool MapHandlerGen::is_attribute_compressible(const QString& name)
+{
+	QMutexLocker locker(&access_mutex_);
+	return compressible_attributes_.contains(name);
+}
+
+unsigned int MapHandlerGen::compress_cold_attributes(unsigned int idle_ms)
+{
+	QStringList cold;
+	{
+		QMutexLocker locker(&access_mutex_);
+		const qint64 now = access_clock_.elapsed();
+		foreach (const QString& name, compressible_attributes_)
+		{
+			// a VBO of a displayed map is read at each frame
+			if (!views_.empty() && get_vbo(name))
+				attribute_access_[name] = now;
+			if (now - attribute_access_.value(name, 0) >= qint64(idle_ms))
+				cold.append(name);
+		}
+	}
+
+	const QString bb_name = get_bb_vertex_attribute_name();
+	const QStringList stored = get_stored_attributes();
+	unsigned int res = 0u;
+	foreach (const QString& name, cold)
+	{
+		if (name != bb_name && !stored.contains(name) && compress_attribute(name, false))
+			++res;
+	}
+	return res;
+}
+
+void MapHandlerGen::touch_attribute(const QString& name)
+{
+	QMutexLocker locker(&access_mutex_);
+	attribute_access_[name] = access_clock_.elapsed();
+}
+
+/*********************************************************
+ * MANAGE SCALAR RANGES
+ *********************************************************/
+
+bool MapHandlerGen::get_scalar_range(const QString& name, float64& min, float64& max)
+{
+	touch_attribute(name);
+
+	begin_read();
+	const bool res = compute_scalar_range(name, min, max);
+	end_read();
+	return res;
+}
+
+/*********************************************************
+ * MANAGE ADJACENCY CACHE
+ *********************************************************/
+
+std::shared_ptr<const MapAdjacency> MapHandlerGen::get_adjacency()
+{
+	const uint32 version = connectivity_version_.load();
+	{
+		QMutexLocker locker(&adjacency_mutex_);
+		// a single build at a time: the other requesters wait for its result
+		while (adjacency_building_)
+			adjacency_built_.wait(&adjacency_mutex_);
+		if (adjacency_ && adjacency_->connectivity_version_ == version)
+			return adjacency_;
+		adjacency_building_ = true;
+	}
+
+	// the waiting requesters are released even if the build fails
+	std::shared_ptr<MapAdjacency> adjacency;
+	std::exception_ptr error;
+	try
+	{
+		adjacency = std::make_shared<MapAdjacency>();
+		adjacency->connectivity_version_ = version;
+		build_adjacency(*adjacency);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	QMutexLocker locker(&adjacency_mutex_);
+	if (!error)
+		adjacency_ = adjacency;
+	adjacency_building_ = false;
+	adjacency_built_.wakeAll();
+	if (error)
+		std::rethrow_exception(error);
+	return adjacency;
+}
+
+/*********************************************************
+ * MANAGE BVH
+ *********************************************************/
+
+std::shared_ptr<const BVH> MapHandlerGen::get_bvh(const QString& position_name)
+{
+	const uint32 version = connectivity_version_.load();
+	std::shared_ptr<BVH> bvh;
+	bool shared = false;
+	{
+		QMutexLocker locker(&bvh_mutex_);
+		// a single build at a time: the other requesters wait for its result
+		while (bvh_building_)
+			bvh_built_.wait(&bvh_mutex_);
+		const bool rebuild = !bvh_ || bvh_position_ != position_name || bvh_connectivity_version_ != version;
+		if (!rebuild && !bvh_refit_)
+			return bvh_;
+		// get_cached_bvh does not return a BVH to refit: only the previous readers share it
+		if (!rebuild)
+		{
+			bvh = bvh_;
+			shared = bvh.use_count() > 2;
+		}
+		bvh_building_ = true;
+	}
+
+	std::shared_ptr<BVH> result;
+	std::exception_ptr error;
+	try
+	{
+		result = update_bvh(position_name, bvh, shared);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+
+	QMutexLocker locker(&bvh_mutex_);
+	if (result)
+	{
+		bvh_ = result;
+		bvh_position_ = position_name;
+		bvh_connectivity_version_ = version;
+		bvh_refit_ = false;
+	}
+	bvh_building_ = false;
+	bvh_built_.wakeAll();
+	if (error)
+		std::rethrow_exception(error);
+	return result;
+}
+
+std::shared_ptr<BVH> MapHandlerGen::update_bvh(const QString& position_name, std::shared_ptr<BVH> bvh, bool shared)
+{
+	std::shared_ptr<const MapAdjacency> adjacency = get_adjacency();
+	std::vector<VEC3> positions;
+	if (!gather_positions(position_name, *adjacency, positions))
+		return nullptr;
+
+	if (bvh)
+	{
+		// the BVH may be in use by a reader: the refit is done on a copy
+		if (shared)
+			bvh = std::make_shared<BVH>(*bvh);
+		bvh->refit(std::move(positions));
+		// large deformations: a new tree is cheaper to traverse
+		if (bvh->get_degradation() < SCALAR(2))
+			return bvh;
+		gather_positions(position_name, *adjacency, positions);
+	}
+
+	bvh = std::make_shared<BVH>();
+	bvh->build(*adjacency, std::move(positions));
+	return bvh;
+}
+
+std::shared_ptr<const BVH> MapHandlerGen::get_cached_bvh(const QString& position_name)
+{
+	QMutexLocker locker(&bvh_mutex_);
+	if (!bvh_ || bvh_refit_ || bvh_position_ != position_name || bvh_connectivity_version_ != connectivity_version_.load())
+		return nullptr;
+	return bvh_;
+}
+
+void MapHandlerGen::prepare_bvh(const QString& position_name)
+{
+	if (bvh_job_ || position_name.isEmpty() || get_cached_bvh(position_name))
+		return;
+	// attributes stored out of the map are put back first (not from the job)
+	if (!ensure_attribute(position_name))
+		return;
+
+	QPointer<MapHandlerGen> guard(this);
+	bvh_job_ = schnapps_->submit_job(
+		QString("BVH of %1").arg(name_),
+		// the job is attached to the map: the map is not deleted while the task runs
+		[this, position_name] (Job&)
+		{
+			begin_read();
+			get_bvh(position_name);
+			end_read();
+		},
+		// the positions may have been modified while the job was running
+		[guard] (Job&)
+		{
+			if (!guard)
+				return;
+			// the job is deleted after its continuation
+			guard->bvh_job_.clear();
+			if (!guard->views_.empty())
+				guard->prepare_bvh(guard->get_bb_vertex_attribute_name());
+		},
+		this
+	);
+}
+
+void MapHandlerGen::release_bvh()
+{
+	QMutexLocker locker(&bvh_mutex_);
+	bvh_.reset();
+	bvh_position_.clear();
+	bvh_refit_ = false;
+}
+
+/*********************************************************
+ * MANAGE UNDO / REDO
+ *********************************************************/
+
+void MapHandlerGen::begin_undoable(const QString& name, const QStringList& vertex_attributes, bool topology)
+{
+	undo_stack_.begin(name);
+	UndoStack::MapAccess& map = get_map_access();
+	foreach (const QString& attribute, vertex_attributes)
+	{
+		if (!undo_stack_.record(map, get_vertex_container(), attribute.toStdString()))
+			std::cerr << "MapHandlerGen::begin_undoable: attribute " << attribute.toStdString() << " cannot be recorded" << std::endl;
+	}
+	if (topology)
+	{
+		// the writes of the topology cannot be anticipated
+		for (const std::string& array : map.get_array_names(UndoStack::TOPOLOGY))
+		{
+			undo_stack_.record(map, UndoStack::TOPOLOGY, array);
+			undo_stack_.save(map, UndoStack::TOPOLOGY, array, 0u, std::numeric_limits<uint32>::max());
+		}
+		undo_topology_ = true;
+	}
+	update_undo_state();
+	emit(undo_stack_changed());
+}
+
+void MapHandlerGen::undoable_write(const QString& name, uint32 first_line, uint32 last_line)
+{
+	if (undo_stack_.is_recording())
+		undo_stack_.save(get_map_access(), get_vertex_container(), name.toStdString(), first_line, last_line);
+}
+
+void MapHandlerGen::undoable_write(const QString& name)
+{
+	if (undo_stack_.is_recording())
+	{
+		undo_stack_.save(get_map_access(), get_vertex_container(), name.toStdString(), 0u, std::numeric_limits<uint32>::max());
+	}
+}
+
+void MapHandlerGen::end_undoable()
+{
+	undo_stack_.end(get_map_access());
+	update_undo_state();
+	emit(undo_stack_changed());
+}
+
+bool MapHandlerGen::can_undo()
+{
+	begin_read();
+	const bool res = undo_stack_.can_undo();
+	end_read();
+	return res;
+}
+
+bool MapHandlerGen::can_redo()
+{
+	begin_read();
+	const bool res = undo_stack_.can_redo();
+	end_read();
+	return res;
+}
+
+bool MapHandlerGen::undo()
+{
+	begin_write();
+	return restore_operation(true);
+}
+
+bool MapHandlerGen::redo()
+{
+	begin_write();
+	return restore_operation(false);
+}
+
+bool MapHandlerGen::try_undo()
+{
+	if (!try_begin_write())
+		return false;
+	return restore_operation(true);
+}
+
+bool MapHandlerGen::try_redo()
+{
+	if (!try_begin_write())
+		return false;
+	return restore_operation(false);
+}
+
+bool MapHandlerGen::restore_operation(bool undo)
+{
+	// the stack is tested and restored in the same write section: no job can change it in between
+	std::vector<UndoStack::ArrayId> restored;
+	const bool res = undo ? undo_stack_.undo(get_map_access(), restored) : undo_stack_.redo(get_map_access(), restored);
+	notify_restored(restored);
+	update_undo_state();
+	end_write();
+	if (res)
+		emit(undo_stack_changed());
+	return res;
+}
+
+bool MapHandlerGen::can_undo() const
+{
+	QMutexLocker locker(&undo_state_mutex_);
+	return can_undo_;
+}
+
+bool MapHandlerGen::can_redo() const
+{
+	QMutexLocker locker(&undo_state_mutex_);
+	return can_redo_;
+}
+
+void MapHandlerGen::clear_undo_stack()
+{
+	// the GUI does not wait for the current writer: try again later
+	if (!lock_->tryLockForWrite())
+	{
+		QTimer::singleShot(10, this, SLOT(clear_undo_stack()));
+		return;
+	}
+	undo_stack_.clear();
+	update_undo_state();
+	lock_->unlock();
+	emit(undo_stack_changed());
+}
+
+void MapHandlerGen::set_undo_memory_limit(unsigned int megabytes)
+{
+	undo_memory_limit_ = uint64(megabytes) * 1024u * 1024u;
+	apply_undo_memory_limit();
+}
+
+void MapHandlerGen::apply_undo_memory_limit()
+{
+	if (!lock_->tryLockForWrite())
+	{
+		QTimer::singleShot(10, this, SLOT(apply_undo_memory_limit()));
+		return;
+	}
+	undo_stack_.set_memory_limit(undo_memory_limit_.load());
+	update_undo_state();
+	lock_->unlock();
+	emit(undo_stack_changed());
+}
+
+QStringList MapHandlerGen::get_undo_history() const
+{
+	QMutexLocker locker(&undo_state_mutex_);
+	return undo_history_;
+}
+
+void MapHandlerGen::update_undo_state()
+{
+	QStringList names = undo_stack_.get_names().mid(0, int(undo_stack_.get_nb_done()));
+	std::reverse(names.begin(), names.end());
+
+	QMutexLocker locker(&undo_state_mutex_);
+	// an operation being recorded cannot be undone nor redone
+	can_undo_ = undo_stack_.can_undo() && !undo_stack_.is_recording();
+	can_redo_ = undo_stack_.can_redo() && !undo_stack_.is_recording();
+	undo_history_ = names;
+}
+
+void MapHandlerGen::notify_restored(const std::vector<UndoStack::ArrayId>& arrays)
+{
+	for (const UndoStack::ArrayId& id : arrays)
+	{
+		if (id.first == UndoStack::TOPOLOGY)
+		{
+			undo_topology_ = true;
+			notify_connectivity_change();
+		}
+		else
+			notify_attribute_change(QString::fromStdString(id.second));
+	}
+}
+
+/*********************************************************
+ * MANAGE CHANGES
+ *********************************************************/
+
+void MapHandlerGen::begin_changes()
+{
+	++changes_depth_;
+}
+
+void MapHandlerGen::end_changes()
+{
+	if (changes_depth_ == 0 || --changes_depth_ > 0)
+		return;
+
+	MapChangeSet changes;
+	std::swap(changes, changes_);
+
+	if (!changes.is_empty())
+		emit(changes_committed(changes));
+
+	foreach (cgogn::rendering::VBO* vbo, changes.removed_vbos_)
+		delete vbo;
+	foreach (PackedVBO* vbo, changes.removed_packed_vbos_)
+		delete vbo;
+}
+
+void MapHandlerGen::notify_attribute_added(cgogn::Orbit orbit, const QString& name)
+{
+	begin_changes();
+	const QPair<cgogn::Orbit, QString> attribute(orbit, name);
+	if (!changes_.removed_attributes_.removeOne(attribute))
+		changes_.added_attributes_.append(attribute);
+	end_changes();
+}
+
+void MapHandlerGen::notify_attribute_removed(cgogn::Orbit orbit, const QString& name)
+{
+	begin_changes();
+	const QPair<cgogn::Orbit, QString> attribute(orbit, name);
+	// an attribute added and removed in the same batch has never been seen
+	if (!changes_.added_attributes_.removeOne(attribute))
+		changes_.removed_attributes_.append(attribute);
+	end_changes();
+}
+
+void MapHandlerGen::notify_vbo_added(cgogn::rendering::VBO* vbo)
+{
+	begin_changes();
+	changes_.added_vbos_.append(vbo);
+	end_changes();
+}
+
+void MapHandlerGen::notify_vbo_removed(cgogn::rendering::VBO* vbo)
+{
+	begin_changes();
+	// a VBO created and deleted in the same batch has never been seen
+	if (changes_.added_vbos_.removeOne(vbo))
+		delete vbo;
+	else
+		changes_.removed_vbos_.append(vbo);
+	end_changes();
+}
+
+void MapHandlerGen::notify_packed_vbo_added(PackedVBO* vbo)
+{
+	begin_changes();
+	changes_.added_packed_vbos_.append(vbo);
+	end_changes();
+}
+
+void MapHandlerGen::notify_packed_vbo_removed(PackedVBO* vbo)
+{
+	begin_changes();
+	if (changes_.added_packed_vbos_.removeOne(vbo))
+		delete vbo;
+	else
+		changes_.removed_packed_vbos_.append(vbo);
+	end_changes();
+}
+
 /*********************************************************
  * MANAGE FRAME
  *********************************************************/
@@ -209,9 +1118,174 @@ void MapHandlerGen::delete_vbo(const QString &name)
 	{
 		cgogn::rendering::VBO* vbo = vbos_[name];
 		vbos_.remove(name);
-		emit(vbo_removed(vbo));
+		notify_vbo_removed(vbo);
+	}
+}
+
+PackedVBO* MapHandlerGen::create_packed_vbo(const QString& name, int format)
+{
+	if (format < PackedVBO::POSITION_Q16 || format > PackedVBO::NORMAL_OCT8)
+	{
+		std::cerr << "MapHandlerGen::create_packed_vbo: unknown format " << format << std::endl;
+		return nullptr;
+	}
+
+	const QString packed_name = PackedVBO::packed_name(name, PackedVBO::Format(format));
+	PackedVBO* vbo = get_packed_vbo(packed_name);
+	if (vbo)
+		return vbo;
+
+	if (!try_begin_read())
+	{
+		std::cerr << "MapHandlerGen::create_packed_vbo: map " << name_.toStdString() << " is being modified" << std::endl;
+		return nullptr;
+	}
+	vbo = new PackedVBO(name, PackedVBO::Format(format));
+	const bool res = refresh_packed_vbo(vbo);
+	end_read();
+
+	if (!res)
+	{
+		std::cerr << "MapHandlerGen::create_packed_vbo: " << name.toStdString() << " is not a VEC3 vertex attribute" << std::endl;
 		delete vbo;
+		return nullptr;
 	}
+
+	packed_vbos_.insert(packed_name, vbo);
+	notify_packed_vbo_added(vbo);
+	return vbo;
+}
+
+PackedVBO* MapHandlerGen::get_packed_vbo(const QString& packed_name) const
+{
+	return packed_vbos_.value(packed_name, nullptr);
+}
+
+void MapHandlerGen::delete_packed_vbo(const QString& packed_name)
+{
+	PackedVBO* vbo = packed_vbos_.value(packed_name, nullptr);
+	if (vbo)
+	{
+		packed_vbos_.remove(packed_name);
+		notify_packed_vbo_removed(vbo);
+	}
+}
+
+/*********************************************************
+ * MANAGE MEMORY
+ *********************************************************/
+
+bool MapHandlerGen::get_memory_report(MapMemoryReport& report)
+{
+	if (!try_begin_read())
+		return false;
+
+	report = MapMemoryReport();
+	append_containers_memory(report);
+	append_index_buffers_memory(report);
+	for (auto it = stored_attributes_.constBegin(); it != stored_attributes_.constEnd(); ++it)
+		report.stored_attributes_.push_back(MemoryBlock(it.key(), it.value()->get_type_name() + QString(", ") + it.value()->get_storage_name(), 0u, it.value()->get_stored_size()));
+	end_read();
+
+	{
+		QMutexLocker locker(&adjacency_mutex_);
+		if (adjacency_)
+		{
+			const QString state = adjacency_->connectivity_version_ == connectivity_version_.load() ? "CSR" : "CSR, outdated";
+			report.caches_.push_back(MemoryBlock("adjacency", state, adjacency_->memory(), adjacency_->memory()));
+		}
+	}
+	{
+		QMutexLocker locker(&bvh_mutex_);
+		if (bvh_)
+		{
+			const QString state = bvh_connectivity_version_ == connectivity_version_.load() ? "BVH of " + bvh_position_ : "BVH of " + bvh_position_ + ", outdated";
+			report.caches_.push_back(MemoryBlock("bvh", state, bvh_->memory(), bvh_->memory()));
+		}
+	}
+
+	append_vbos_memory(report);
+
+	return true;
+}
+
+QString MapHandlerGen::get_memory_report_string()
+{
+	MapMemoryReport report;
+	if (!get_memory_report(report))
+		return QString("map %1 is being modified").arg(name_);
+	return report.to_string();
+}
+
+void MapHandlerGen::append_vbos_memory(MapMemoryReport& report) const
+{
+	for (auto it = vbos_.constBegin(); it != vbos_.constEnd(); ++it)
+	{
+		const uint64 bytes = uint64(it.value()->size()) * it.value()->vector_dimension() * sizeof(float32);
+		report.vbos_.push_back(MemoryBlock(it.key(), QString("float32 x %1").arg(it.value()->vector_dimension()), bytes, bytes));
+	}
+	for (auto it = packed_vbos_.constBegin(); it != packed_vbos_.constEnd(); ++it)
+	{
+		const uint64 bytes = uint64(it.value()->size()) * it.value()->vector_bytes();
+		report.vbos_.push_back(MemoryBlock(it.key(), PackedVBO::format_name(it.value()->get_format()), bytes, bytes));
+	}
+}
+
+/*********************************************************
+ * MANAGE COMPACTION
+ *********************************************************/
+
+MapCompactionReport MapHandlerGen::compact_now()
+{
+	MapCompactionReport res;
+
+	begin_read();
+	MapMemoryReport before;
+	append_containers_memory(before);
+	res.used_before_ = before.used();
+	res.allocated_before_ = before.allocated();
+	res.traversal_before_ = measure_traversal();
+	end_read();
+
+	QElapsedTimer timer;
+	timer.start();
+	begin_write();
+	// the stored attributes not restored by compact() are dropped (their lines are renumbered)
+	compact_map();
+	notify_connectivity_change();
+	end_write();
+	res.duration_ = float64(timer.nsecsElapsed()) / 1.0e6;
+
+	begin_read();
+	MapMemoryReport after;
+	append_containers_memory(after);
+	res.used_after_ = after.used();
+	res.allocated_after_ = after.allocated();
+	res.traversal_after_ = measure_traversal();
+	end_read();
+
+	return res;
+}
+
+void MapHandlerGen::compact()
+{
+	restore_stored_attributes();
+	QPointer<MapHandlerGen> mh(this);
+	std::shared_ptr<MapCompactionReport> report = std::make_shared<MapCompactionReport>();
+	schnapps_->submit_job(
+		QString("compact %1").arg(name_),
+		// the job is attached to the map: the map is not deleted while the task runs
+		[this, report] (Job&) { *report = compact_now(); },
+		[mh, report] (Job&)
+		{
+			if (mh)
+			{
+				mh->schnapps_->status_bar_message(mh->get_name() + ": " + report->to_string(), 5000);
+				emit(mh->compacted(*report));
+			}
+		},
+		this
+	);
 }
 
 /*********************************************************
@@ -225,6 +1299,8 @@ void MapHandlerGen::link_view(View* view)
 		views_.push_back(view);
 		view->makeCurrent();
 		bb_drawer_renderer_[view] = bb_drawer_.generate_renderer();
+		// the BVH used for picking is ready before the first click
+		prepare_bvh(get_bb_vertex_attribute_name());
 	}
 }
 
@@ -26,6 +26,15 @@
 
 #include <schnapps/core/dll.h>
 #include <schnapps/core/types.h>
+#include <schnapps/core/memory_report.h>
+#include <schnapps/core/map_copy.h>
+#include <schnapps/core/undo_stack.h>
+#include <schnapps/core/stored_attribute.h>
+#include <schnapps/core/packed_vbo.h>
+#include <schnapps/core/map_adjacency.h>
+#include <schnapps/core/bvh.h>
+#include <schnapps/core/thread_pool.h>
+#include <schnapps/core/job.h>
 
 #include <cgogn/core/cmap/map_base.h>
 #include <cgogn/core/cmap/cmap2.h>
@@ -40,6 +49,25 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QPair>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QPointer>
+
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <type_traits>
+#include <iostream>
+#include <limits>
+#include <utility>
 
 namespace cgogn { namespace rendering { class Drawer; } }
 
@@ -53,6 +81,26 @@ using MapBaseData = cgogn::MapBaseData<cgogn::DefaultMapTraits>;
 using CMap2 = cgogn::CMap2<cgogn::DefaultMapTraits>;
 using CMap3 = cgogn::CMap3<cgogn::DefaultMapTraits>;
 
+/**
+* @brief Changes of the attributes and VBOs of a map, committed at once (see MapHandlerGen::begin_changes)
+*/
+struct SCHNAPPS_CORE_API MapChangeSet
+{
+	QList<QPair<cgogn::Orbit, QString>> added_attributes_;
+	QList<QPair<cgogn::Orbit, QString>> removed_attributes_;
+	QList<cgogn::rendering::VBO*> added_vbos_;
+	// removed VBOs are deleted once the change set has been emitted
+	QList<cgogn::rendering::VBO*> removed_vbos_;
+	QList<PackedVBO*> added_packed_vbos_;
+	QList<PackedVBO*> removed_packed_vbos_;
+
+	inline bool is_empty() const
+	{
+		return added_attributes_.empty() && removed_attributes_.empty() && added_vbos_.empty() && removed_vbos_.empty() &&
+			added_packed_vbos_.empty() && removed_packed_vbos_.empty();
+	}
+};
+
 class SCHNAPPS_CORE_API MapHandlerGen : public QObject
 {
 	Q_OBJECT
@@ -87,6 +135,480 @@ public slots:
 	virtual uint32 nb_edges() = 0;
 	virtual uint32 nb_faces() = 0;
 
+	/*********************************************************
+	 * MANAGE CONCURRENT ACCESS
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief start modifying the map (from any thread)
+	 * Blocks until the current readers are done. While the map is written, views keep drawing
+	 * the last published VBOs and index buffers.
+	 */
+	void begin_write();
+
+	/**
+	 * @brief start modifying the map if it is not being read or written (does not wait)
+	 * @return false if the map is locked (begin_write has not been done)
+	 */
+	bool try_begin_write();
+
+	/**
+	 * @brief declare that the values of an attribute have been modified by the writer
+	 * @param name name of the vertex attribute
+	 */
+	void notify_attribute_change(const QString& name);
+
+	/**
+	 * @brief declare that a range of lines of an attribute has been modified by the writer
+	 * Only the chunks of these lines are uploaded to the VBO of the attribute,
+	 * unless the whole attribute is declared modified before the changes are published.
+	 * @param name name of the vertex attribute
+	 * @param first_line first modified line
+	 * @param last_line line after the last modified line
+	 */
+	void notify_attribute_change(const QString& name, uint32 first_line, uint32 last_line);
+
+	/**
+	 * @brief declare that chunks of an attribute have been modified by the writer (see notify_attribute_change)
+	 * @param name name of the vertex attribute
+	 * @param chunks indices of the modified chunks (see chunk_index)
+	 */
+	void notify_attribute_change(const QString& name, const QSet<uint32>& chunks);
+
+	/**
+	 * @brief index of the chunk of the attributes that contains a line
+	 */
+	static inline uint32 chunk_index(uint32 line) { return line / cgogn::DefaultMapTraits::CHUNK_SIZE; }
+
+	/**
+	 * @brief declare that the connectivity of the map has been modified by the writer
+	 */
+	void notify_connectivity_change();
+
+	/**
+	 * @brief end the modification of the map
+	 * The declared changes are published on the GUI thread: VBOs of modified attributes,
+	 * index buffers and bounding box are refreshed at once, then the linked views are updated.
+	 */
+	void end_write();
+
+	/**
+	 * @brief try to lock the map for reading without waiting for the current writer
+	 * @return false if the map is being written
+	 */
+	inline bool try_begin_read() { return lock_->tryLockForRead(); }
+
+	/**
+	 * @brief lock the map for reading (waits for the current writer)
+	 */
+	inline void begin_read() { lock_->lockForRead(); }
+
+	inline void end_read() { lock_->unlock(); }
+
+	/**
+	 * @brief get the version of the map, incremented each time a writer ends
+	 */
+	inline uint32 get_version() const { return version_.load(); }
+
+	/**
+	 * @brief name of the back buffer of a double-buffered vertex attribute
+	 */
+	static inline QString back_buffer_name(const QString& name) { return name + "_back"; }
+
+	/**
+	 * @brief RAII helper for begin_write / end_write
+	 */
+	class Writer
+	{
+	public:
+		inline Writer(MapHandlerGen* mh) : mh_(mh) { mh_->begin_write(); }
+		inline ~Writer() { mh_->end_write(); }
+		inline void attribute_changed(const QString& name) { mh_->notify_attribute_change(name); }
+		inline void connectivity_changed() { mh_->notify_connectivity_change(); }
+	private:
+		MapHandlerGen* mh_;
+	};
+
+private:
+
+	// prepare the write section once the map is locked for writing
+	void start_write();
+	// an attribute has been modified by the writer (access time, BVH)
+	void attribute_written(const QString& name);
+
+	// queue the publication of the pending changes on the GUI thread
+	void queue_publication(Qt::ConnectionType type);
+
+private slots:
+
+	void publish_changes();
+
+	/*********************************************************
+	 * MANAGE COPY-ON-WRITE DUPLICATES
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief share the data of another map (copy-on-write duplicate, GUI thread)
+	 * Both handlers use the same map data until one of them is written: the writer then gets a deep
+	 * copy of the map data at the beginning of the write (see copy_map), the other handlers keep their data.
+	 * The copy keeps the indices of the cells: the lines read by running tasks stay valid.
+	 * The duplicates keep sharing the lock of the source.
+	 * @param source the map to share
+	 * @param properties also duplicate the bounding box settings, the transformation and the VBOs
+	 */
+	void share_map_data(MapHandlerGen* source, bool properties);
+
+	/**
+	 * @brief test if the data of the map are shared with a duplicate
+	 */
+	bool is_shared() const;
+
+protected:
+
+	// build a copy of the map data (the map must be locked)
+	virtual MapBaseData* copy_map_data() const = 0;
+	// get the attribute handles again after a change of the map data (the map must be locked for writing)
+	virtual void rebind_attributes() = 0;
+
+private:
+
+	// give its own copy of the map data to the writer (the map must be locked for writing)
+	void detach();
+
+public slots:
+
+	/*********************************************************
+	 * MANAGE UNDO / REDO
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief start an undoable operation (after begin_write, in the writer thread)
+	 * The chunks of the given attributes are saved on first write (see undoable_write) and end_undoable keeps
+	 * only the chunks modified by the operation. The topology, if declared, is saved at once.
+	 * The operation may span several write sections of its job and must not add or remove cells:
+	 * other connectivity changes clear the stack.
+	 * @param name name of the operation
+	 * @param vertex_attributes names of the vertex attributes modified by the operation
+	 * @param topology the operation modifies the topology of the darts (e.g. edge flips)
+	 */
+	void begin_undoable(const QString& name, const QStringList& vertex_attributes, bool topology = false);
+
+	/**
+	 * @brief save the chunks of a vertex attribute of the undoable operation before they are written
+	 * Must be called (in a write section) before writing the attribute, by each task of a parallel loop
+	 * before writing its range of lines. Does nothing when no undoable operation is recorded.
+	 * @param name name of the vertex attribute
+	 * @param first_line first line to be written
+	 * @param last_line line after the last line to be written
+	 */
+	void undoable_write(const QString& name, uint32 first_line, uint32 last_line);
+
+	/**
+	 * @brief save all the chunks of a vertex attribute of the undoable operation before they are written
+	 */
+	void undoable_write(const QString& name);
+
+	/**
+	 * @brief end the undoable operation (in a write section)
+	 */
+	void end_undoable();
+
+	/**
+	 * @brief test if an operation can be undone (does not wait for the current writer)
+	 * The state of the stack is copied by the writers: it is false while an operation is recorded.
+	 */
+	bool can_undo() const;
+
+	/**
+	 * @brief test if an operation can be redone (does not wait for the current writer)
+	 */
+	bool can_redo() const;
+
+public slots:
+
+	/**
+	 * @brief undo the last operation (waits for the current writer)
+	 * @return false if there is nothing to undo
+	 */
+	bool undo();
+
+	/**
+	 * @brief redo the last undone operation (waits for the current writer)
+	 * @return false if there is nothing to redo
+	 */
+	bool redo();
+
+	/**
+	 * @brief undo the last operation if the map is not locked (does not wait, for the GUI)
+	 * @return false if the map is locked or if there is nothing to undo
+	 */
+	bool try_undo();
+
+	/**
+	 * @brief redo the last undone operation if the map is not locked (does not wait, for the GUI)
+	 * @return false if the map is locked or if there is nothing to redo
+	 */
+	bool try_redo();
+
+	/**
+	 * @brief clear the undo stack (postponed while the map is written)
+	 */
+	void clear_undo_stack();
+
+	/**
+	 * @brief set the maximal memory of the undo stack (the oldest operations are dropped)
+	 * The limit is applied when the map is not written anymore.
+	 * @param megabytes the limit in MB (0: no limit)
+	 */
+	void set_undo_memory_limit(unsigned int megabytes);
+
+	/**
+	 * @brief get the names of the operations that can be undone (from the last one)
+	 * Does not wait for the current writer (see can_undo).
+	 */
+	QStringList get_undo_history() const;
+
+protected:
+
+	virtual UndoStack::MapAccess& get_map_access() = 0;
+	// container identifier (orbit) of the vertex attributes
+	virtual int32 get_vertex_container() const = 0;
+
+private:
+
+	// the map is locked for writing: undo or redo the last operation and end the write section
+	bool restore_operation(bool undo);
+	void notify_restored(const std::vector<UndoStack::ArrayId>& arrays);
+	// the map is locked: copy the state of the undo stack read by the GUI
+	void update_undo_state();
+
+private slots:
+
+	void apply_undo_memory_limit();
+
+	/*********************************************************
+	 * MANAGE STORED ATTRIBUTES
+	 *********************************************************/
+
+public:
+
+	// build the storage of an attribute from the name of its type
+	using StorageFactory = std::function<StoredAttribute*(const QString&)>;
+
+	/**
+	 * @brief get a vertex attribute back in the map if it is stored out of it (see evict_attribute, compress_attribute)
+	 * Must not be called while the map is locked.
+	 * @return false if the attribute is stored and cannot be restored
+	 */
+	bool ensure_attribute(const QString& name);
+
+public slots:
+
+	/**
+	 * @brief move a vertex attribute out of the heap, into a memory-mapped temporary file
+	 * The attribute is removed from the map: its VBO can still be created or refreshed from the file
+	 * (paged in by the OS on demand) and restore_attribute puts it back in the map.
+	 * Only attributes of trivially copyable types can be evicted.
+	 * @param name name of the vertex attribute
+	 * @return false if the attribute does not exist, cannot be evicted or is used for the bounding box
+	 */
+	bool evict_attribute(const QString& name);
+
+	/**
+	 * @brief compress a vertex attribute in memory
+	 * As evicted attributes, compressed attributes are removed from the map, can still feed their VBO
+	 * and are restored by restore_attribute or on first access through ensure_attribute / get_attribute.
+	 * @param name name of the vertex attribute
+	 * @param lossy store float64 values as float32 (VEC2/3/4 and SCALAR attributes)
+	 * @return false if the attribute does not exist, cannot be compressed or is used for the bounding box
+	 */
+	bool compress_attribute(const QString& name, bool lossy);
+
+	/**
+	 * @brief put an evicted or compressed vertex attribute back in the map
+	 * Cells created since the eviction get default values.
+	 * @param name name of the vertex attribute
+	 * @return false if the attribute is not stored or cannot be restored
+	 */
+	bool restore_attribute(const QString& name);
+
+	QStringList get_stored_attributes();
+
+	/**
+	 * @brief put all the evicted or compressed vertex attributes back in the map
+	 * The stored values follow the lines of the vertices at the time they were stored: they must be restored
+	 * before the connectivity changes (compaction, decimation...). A connectivity change drops the stored
+	 * attributes that have not been restored (with a warning).
+	 * @return false if an attribute cannot be restored
+	 */
+	bool restore_stored_attributes();
+
+	/**
+	 * @brief allow the memory monitor to compress an attribute when it has not been accessed for a while
+	 * Only attributes that are not referenced by handles held across accesses should be compressible:
+	 * compressed attributes are removed from the map.
+	 */
+	void set_attribute_compressible(const QString& name, bool b);
+
+	bool is_attribute_compressible(const QString& name);
+
+	/**
+	 * @brief compress the compressible vertex attributes that have not been accessed for a while
+	 * @param idle_ms minimal duration without access in milliseconds
+	 * @return the number of compressed attributes
+	 */
+	unsigned int compress_cold_attributes(unsigned int idle_ms);
+
+	/**
+	 * @brief declare an access to a vertex attribute (resets its idle duration)
+	 */
+	void touch_attribute(const QString& name);
+
+protected:
+
+	bool store_attribute(const QString& name, const StorageFactory& factory);
+	// the map must be locked for writing
+	void drop_stored_attributes();
+
+	// the map must be locked for writing
+	virtual bool store_vertex_attribute(const QString& name, const StorageFactory& factory) = 0;
+	// the map must be locked for writing
+	virtual bool restore_vertex_attribute(const QString& name, const StoredAttribute& stored) = 0;
+
+	/*********************************************************
+	 * MANAGE SCALAR RANGES
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief compute the range of the finite values of a SCALAR vertex attribute on the vertices of the map
+	 * The range is computed by a parallel reduction over the used lines of the vertex container.
+	 * It waits for the writers of the map: call it from a job, not from the GUI thread.
+	 * @param name name of the vertex attribute
+	 * @return false if the attribute does not exist (or is stored out of the map), is not a SCALAR attribute or has no finite value
+	 */
+	bool get_scalar_range(const QString& name, float64& min, float64& max);
+
+protected:
+
+	// the map must be locked for reading: range of the values of the used vertex lines
+	virtual bool compute_scalar_range(const QString& name, float64& min, float64& max) const = 0;
+
+	/*********************************************************
+	 * MANAGE ADJACENCY CACHE
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief get the CSR adjacency of the vertices and faces of the map (see MapAdjacency)
+	 * The adjacency is built in parallel on first request and cached until the connectivity changes.
+	 * Concurrent requests wait for a single build. The map must be locked (for reading or writing). The returned adjacency is shared:
+	 * it stays readable after an invalidation but no longer describes the map.
+	 */
+	std::shared_ptr<const MapAdjacency> get_adjacency();
+
+	/**
+	 * @brief get the version of the connectivity, incremented by each connectivity change
+	 */
+	inline uint32 get_connectivity_version() const { return connectivity_version_.load(); }
+
+protected:
+
+	// the map must be locked
+	virtual void build_adjacency(MapAdjacency& adjacency) const = 0;
+
+	/*********************************************************
+	 * MANAGE BVH
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief get the bounding volume hierarchy of the faces of the map (see BVH) for ray casting,
+	 * closest point and box overlap queries
+	 * The BVH is built in parallel on first request and cached for one position attribute: it is
+	 * refitted when this attribute changes, rebuilt when the connectivity changes, when another
+	 * attribute is requested or when the refits have degraded its quality. Concurrent requests wait for
+	 * a single build, get_cached_bvh does not wait. The map must be locked
+	 * (for reading or writing) and the attribute must be in the map (see ensure_attribute).
+	 * The returned BVH is shared: it stays readable after an update but no longer describes the map.
+	 * @param position_name name of a VEC3 vertex attribute
+	 * @return nullptr if the attribute does not exist or is not a VEC3 attribute
+	 */
+	std::shared_ptr<const BVH> get_bvh(const QString& position_name);
+
+	/**
+	 * @brief get the cached BVH if it is up to date for an attribute (it is never built nor refitted here)
+	 * The map does not need to be locked.
+	 * @return nullptr if the BVH has to be built or updated (see prepare_bvh)
+	 */
+	std::shared_ptr<const BVH> get_cached_bvh(const QString& position_name);
+
+	/**
+	 * @brief free the cached BVH
+	 */
+	void release_bvh();
+
+public slots:
+
+	/**
+	 * @brief build or update the BVH of an attribute in a background job (see get_bvh)
+	 * Called when the map is linked to a view, when its bounding box attribute changes or is modified,
+	 * so that picking finds the BVH ready. While such a job is pending, the BVH is updated again at its end.
+	 */
+	void prepare_bvh(const QString& position_name);
+
+protected:
+
+	// the map must be locked: position of each vertex of the adjacency
+	virtual bool gather_positions(const QString& name, const MapAdjacency& adjacency, std::vector<VEC3>& positions) const = 0;
+
+	// refit a BVH (a copy of it if it is shared) or build a new one when bvh is null, without caching it
+	std::shared_ptr<BVH> update_bvh(const QString& position_name, std::shared_ptr<BVH> bvh, bool shared);
+
+	/*********************************************************
+	 * MANAGE CHANGES
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief open a batch of changes (GUI thread, can be nested)
+	 * Added/removed attributes and VBOs are gathered until the outermost end_changes,
+	 * which emits a single changes_committed signal.
+	 */
+	void begin_changes();
+
+	/**
+	 * @brief close a batch of changes
+	 */
+	void end_changes();
+
+	/**
+	 * @brief declare an attribute added to the map (committed at once if no batch is open)
+	 */
+	void notify_attribute_added(cgogn::Orbit orbit, const QString& name);
+
+	/**
+	 * @brief declare an attribute removed from the map (committed at once if no batch is open)
+	 */
+	void notify_attribute_removed(cgogn::Orbit orbit, const QString& name);
+
+protected:
+
+	void notify_vbo_added(cgogn::rendering::VBO* vbo);
+	void notify_vbo_removed(cgogn::rendering::VBO* vbo);
+	void notify_packed_vbo_added(PackedVBO* vbo);
+	void notify_packed_vbo_removed(PackedVBO* vbo);
+
 	/*********************************************************
 	 * MANAGE FRAME
 	 *********************************************************/
@@ -162,7 +684,13 @@ public slots:
 protected:
 
 	void update_bb_drawer();
+	// the map must be locked for reading
 	virtual void compute_bb() = 0;
+	virtual void refresh_vbo(const QString& name, cgogn::rendering::VBO* vbo) = 0;
+	// the map must be locked for reading: upload some chunks of an attribute (false if the VBO must be filled again)
+	virtual bool refresh_vbo_chunks(const QString& name, cgogn::rendering::VBO* vbo, const QSet<uint32>& chunks) = 0;
+	// the map must be locked for reading
+	virtual bool refresh_packed_vbo(PackedVBO* vbo) = 0;
 
 	/*********************************************************
 	 * MANAGE DRAWING
@@ -176,6 +704,8 @@ public:
 	 * MANAGE VBOs
 	 *********************************************************/
 
+public slots:
+
 	/**
 	* @brief create a VBO from vertex attribute (with same name)
 	* @param name name of attribute
@@ -183,13 +713,94 @@ public:
 	*/
 	virtual cgogn::rendering::VBO* create_vbo(const QString& name) = 0;
 
+	/**
+	* @brief refresh a VBO from its vertex attribute
+	* Does nothing while the map is written (the VBO is refreshed when the writer publishes its changes).
+	* @param name name of attribute
+	*/
+	virtual void update_vbo(const QString& name) = 0;
+
+	cgogn::rendering::VBO* get_vbo(const QString& name) const;
+
+	void delete_vbo(const QString& name);
+
+	inline const QMap<QString, cgogn::rendering::VBO*>& get_vbo_set() const { return vbos_; }
+
+	/**
+	* @brief create a VBO of a VEC3 vertex attribute in a compact GPU format (see PackedVBO)
+	* The packed VBO is named <attribute>:<format> (e.g. position:q16) and refreshed with the attribute.
+	* @param name name of attribute
+	* @param format 0: quantized positions (16 bits) / 1: octahedral normals (2 x 16 bits) / 2: octahedral normals (2 x 8 bits)
+	* @return the packed VBO or nullptr if the attribute is not a VEC3 vertex attribute
+	*/
+	PackedVBO* create_packed_vbo(const QString& name, int format);
+
+	PackedVBO* get_packed_vbo(const QString& packed_name) const;
+
+	void delete_packed_vbo(const QString& packed_name);
+
+	inline const QMap<QString, PackedVBO*>& get_packed_vbo_set() const { return packed_vbos_; }
+
+	/*********************************************************
+	 * MANAGE MEMORY
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief measure the memory used by the map: attribute containers of each orbit, dart topology,
+	 * index buffers and VBOs
+	 * @param report the report to fill
+	 * @return false if the map is being written
+	 */
+	bool get_memory_report(MapMemoryReport& report);
+
 public slots:
 
-	cgogn::rendering::VBO* get_vbo(const QString& name) const;
+	/**
+	 * @brief get a human readable memory report of the map
+	 */
+	QString get_memory_report_string();
+
+protected:
+
+	// the map must be locked for reading
+	virtual void append_containers_memory(MapMemoryReport& report) const = 0;
+	// the map must be locked for reading
+	virtual void append_index_buffers_memory(MapMemoryReport& report) = 0;
+	void append_vbos_memory(MapMemoryReport& report) const;
+
+	/*********************************************************
+	 * MANAGE COMPACTION
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief compact the map in the calling thread (any thread)
+	 * The holes left by removed cells are removed from the dart and attribute containers and the
+	 * cells are renumbered. The index buffers and VBOs are then rebuilt when the changes are published.
+	 * The stored attributes must be restored first (see restore_stored_attributes), compact() does it.
+	 * @return sizes and traversal durations before and after the compaction
+	 */
+	MapCompactionReport compact_now();
+
+public slots:
+
+	/**
+	 * @brief compact the map in a background job (see compact_now)
+	 * The compacted signal is emitted once the job has ended.
+	 */
+	void compact();
+
+protected:
 
-	void delete_vbo(const QString& name);
+	// the map must be locked for writing
+	virtual void compact_map() = 0;
+	// the map must be locked for reading
+	virtual float64 measure_traversal() const = 0;
 
-	inline const QMap<QString, cgogn::rendering::VBO*>& get_vbo_set() const { return vbos_; }
+public slots:
 
 	/*********************************************************
 	 * MANAGE LINKED VIEWS
@@ -211,10 +822,14 @@ signals:
 	void bb_changed();
 	void bb_vertex_attribute_changed(const QString&);
 
-	void vbo_added(cgogn::rendering::VBO*);
-	void vbo_removed(cgogn::rendering::VBO*);
+	void changes_committed(const MapChangeSet&);
+
+	void attribute_changed(const QString&);
+	void connectivity_changed();
 
-	void attribute_added(cgogn::Orbit, const QString&);
+	void compacted(const MapCompactionReport&);
+
+	void undo_stack_changed();
 
 protected:
 
@@ -249,11 +864,78 @@ protected:
 
 	// VBO managed for the map attributes
 	QMap<QString, cgogn::rendering::VBO*> vbos_;
+	// VBO in compact formats, by packed name
+	QMap<QString, PackedVBO*> packed_vbos_;
+
+	// batch of changes being gathered
+	uint32 changes_depth_;
+	MapChangeSet changes_;
+
+	// readers (GUI thread) / writer (any thread) lock of the map data
+	// (shared by the copy-on-write duplicates of the map)
+	std::shared_ptr<QReadWriteLock> lock_;
+	std::atomic<uint32> version_;
+	std::atomic<uint32> connectivity_version_;
+
+	// cached adjacency, built outside of the mutex by one requester at a time while the others wait
+	// (the thread building it only runs the ranges of its own parallel_for: it never requests it again)
+	QMutex adjacency_mutex_;
+	QWaitCondition adjacency_built_;
+	bool adjacency_building_;
+	std::shared_ptr<const MapAdjacency> adjacency_;
+
+	// cached BVH of the faces, built for bvh_position_ (like the adjacency)
+	QMutex bvh_mutex_;
+	QWaitCondition bvh_built_;
+	bool bvh_building_;
+	std::shared_ptr<BVH> bvh_;
+	QString bvh_position_;
+	uint32 bvh_connectivity_version_;
+	bool bvh_refit_;
+	// pending prepare_bvh job (GUI thread, null once the job is done)
+	QPointer<Job> bvh_job_;
+
+	// handlers sharing the map data (the first one owns it), protected by lock_
+	std::shared_ptr<QList<MapHandlerGen*>> sharing_;
+
+	// changes declared by the current writer
+	QStringList written_attributes_;
+	// modified chunks of the written attributes that are not entirely modified
+	QMap<QString, QSet<uint32>> written_chunks_;
+	bool connectivity_written_;
+
+	// vertex attributes stored out of the map (memory-mapped files, compressed), protected by lock_
+	QMap<QString, StoredAttribute*> stored_attributes_;
+
+	// last access to the vertex attributes (ms of access_clock_)
+	QMutex access_mutex_;
+	QElapsedTimer access_clock_;
+	QMap<QString, qint64> attribute_access_;
+	QSet<QString> compressible_attributes_;
+
+	// undo stack, protected by lock_
+	UndoStack undo_stack_;
+	// the current writer records or restores the topology with undo_stack_
+	bool undo_topology_;
+	// copy of the state of undo_stack_ for the GUI (see update_undo_state)
+	mutable QMutex undo_state_mutex_;
+	bool can_undo_;
+	bool can_redo_;
+	QStringList undo_history_;
+	// limit of undo_stack_ (bytes) applied by apply_undo_memory_limit
+	std::atomic<uint64> undo_memory_limit_;
+
+	// changes of the ended writers not yet published on the GUI thread
+	QMutex pending_mutex_;
+	QStringList pending_attributes_;
+	QMap<QString, QSet<uint32>> pending_chunks_;
+	bool pending_connectivity_;
+	std::atomic<bool> publish_queued_;
 };
 
 
 template <typename MAP_TYPE>
-class MapHandler : public MapHandlerGen
+class MapHandler : public MapHandlerGen, public UndoStack::MapAccess
 {
 public:
 
@@ -280,7 +962,7 @@ public:
 	 * MANAGE BOUNDING BOX
 	 *********************************************************/
 
-	QString get_bb_vertex_attribute_name() const
+	QString get_bb_vertex_attribute_name() const override
 	{
 		if (bb_vertex_attribute_.is_valid())
 			return QString::fromStdString(bb_vertex_attribute_.get_name());
@@ -290,11 +972,21 @@ public:
 
 	void set_bb_vertex_attribute(const QString& name) override
 	{
+		if (!this->try_begin_read())
+		{
+			std::cerr << "MapHandler::set_bb_vertex_attribute: map " << this->name_.toStdString() << " is being modified" << std::endl;
+			return;
+		}
 		bb_vertex_attribute_ = get_map()->template get_attribute<VEC3, Vertex::ORBIT>(name.toStdString());
 		compute_bb();
+		this->end_read();
 		this->update_bb_drawer();
 		emit(bb_vertex_attribute_changed(name));
 		emit(bb_changed());
+
+		// the displayed maps are picked through the BVH of their bounding box attribute
+		if (!this->views_.empty())
+			this->prepare_bvh(name);
 	}
 
 private:
@@ -318,11 +1010,515 @@ private:
 
 	void draw(cgogn::rendering::DrawingType primitive) override
 	{
-		if (!render_.is_primitive_uptodate(primitive))
+		// while a writer modifies the map, the previous index buffers are drawn
+		if (!render_.is_primitive_uptodate(primitive) && this->try_begin_read())
+		{
 			render_.init_primitives<VEC3>(*get_map(), primitive);
+			this->end_read();
+		}
 		render_.draw(primitive);
 	}
 
+	/*********************************************************
+	 * MANAGE MEMORY
+	 *********************************************************/
+
+public:
+
+	void append_containers_memory(MapMemoryReport& report) const override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		report.containers_.push_back(MapMemoryReport::container_memory("Topology", cmap->get_topology_container(), cgogn::DefaultMapTraits::CHUNK_SIZE));
+		append_orbit_memory<MAP_TYPE::CDart::ORBIT>(report, "Dart");
+		append_orbit_memory<Vertex::ORBIT>(report, "Vertex");
+		append_orbit_memory<Edge::ORBIT>(report, "Edge");
+		append_orbit_memory<Face::ORBIT>(report, "Face");
+		append_orbit_memory<MAP_TYPE::Volume::ORBIT>(report, "Volume");
+	}
+
+	void append_index_buffers_memory(MapMemoryReport& report) override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+
+		// index buffers of the MapRender are made of uint32 indices
+		if (render_.is_primitive_uptodate(cgogn::rendering::POINTS))
+			report.index_buffers_.push_back(MemoryBlock("points", "uint32", 0u, uint64(cmap->template nb_cells<Vertex::ORBIT>()) * sizeof(uint32)));
+		if (render_.is_primitive_uptodate(cgogn::rendering::LINES))
+			report.index_buffers_.push_back(MemoryBlock("lines", "uint32", 0u, uint64(cmap->template nb_cells<Edge::ORBIT>()) * 2u * sizeof(uint32)));
+		if (render_.is_primitive_uptodate(cgogn::rendering::TRIANGLES))
+		{
+			uint64 nb_triangles = 0u;
+			cmap->foreach_cell([&] (Face f) { nb_triangles += cmap->codegree(f) - 2u; });
+			report.index_buffers_.push_back(MemoryBlock("triangles", "uint32", 0u, nb_triangles * 3u * sizeof(uint32)));
+		}
+	}
+
+private:
+
+	template <cgogn::Orbit ORBIT>
+	void append_orbit_memory(MapMemoryReport& report, const QString& orbit_name) const
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		if (cmap->template is_embedded<ORBIT>())
+			report.containers_.push_back(MapMemoryReport::container_memory(orbit_name, cmap->template get_attribute_container<ORBIT>(), cgogn::DefaultMapTraits::CHUNK_SIZE));
+	}
+
+	/*********************************************************
+	 * MANAGE STORED ATTRIBUTES
+	 *********************************************************/
+
+	bool store_vertex_attribute(const QString& name, const StorageFactory& factory) override
+	{
+		bool res = false;
+		store<VEC4>(name, factory, res) ||
+		store<VEC3>(name, factory, res) ||
+		store<VEC2>(name, factory, res) ||
+		store<float64>(name, factory, res) ||
+		store<float32>(name, factory, res) ||
+		store<uint32>(name, factory, res) ||
+		store<int32>(name, factory, res);
+		return res;
+	}
+
+	bool restore_vertex_attribute(const QString& name, const StoredAttribute& stored) override
+	{
+		bool res = false;
+		restore<VEC4>(name, stored, res) ||
+		restore<VEC3>(name, stored, res) ||
+		restore<VEC2>(name, stored, res) ||
+		restore<float64>(name, stored, res) ||
+		restore<float32>(name, stored, res) ||
+		restore<uint32>(name, stored, res) ||
+		restore<int32>(name, stored, res);
+		return res;
+	}
+
+	/**
+	 * @return true if the attribute has the type T (res tells if it has been stored)
+	 */
+	template <typename T>
+	bool store(const QString& name, const StorageFactory& factory, bool& res)
+	{
+		MAP_TYPE* map = get_map();
+		const MAP_TYPE* cmap = map;
+		const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
+		MapBaseData::ChunkArray<T>* ca = dynamic_cast<MapBaseData::ChunkArray<T>*>(vcont.get_attribute(name.toStdString()));
+		if (!ca)
+			return false;
+
+		StoredAttribute* stored = factory(QString::fromStdString(cgogn::name_of_type(T())));
+		res = stored->write(ca, vcont.end());
+		if (res)
+		{
+			VertexAttribute<T> va(map, ca);
+			map->remove_attribute(va);
+			this->stored_attributes_.insert(name, stored);
+		}
+		else
+			delete stored;
+		return true;
+	}
+
+	/**
+	 * @return true if the stored attribute has the type T (res tells if it has been restored)
+	 */
+	template <typename T>
+	bool restore(const QString& name, const StoredAttribute& stored, bool& res)
+	{
+		if (stored.get_type_name() != QString::fromStdString(cgogn::name_of_type(T())))
+			return false;
+
+		MAP_TYPE* map = get_map();
+		VertexAttribute<T> va = map->template add_attribute<T, Vertex::ORBIT>(name.toStdString());
+		if (va.is_valid())
+		{
+			const MAP_TYPE* cmap = map;
+			res = stored.read(cmap->template get_attribute_container<Vertex::ORBIT>().get_attribute(name.toStdString()));
+			if (!res)
+				map->remove_attribute(va);
+		}
+		return true;
+	}
+
+public:
+
+	/**
+	 * @brief get an attribute of the map, restored first if it is stored out of the map (vertex attributes)
+	 * Must not be called while the map is locked.
+	 * @param name name of the attribute
+	 * @return the attribute (invalid if it does not exist)
+	 */
+	template <typename T, cgogn::Orbit ORBIT>
+	typename MAP_TYPE::template Attribute<T, ORBIT> get_attribute(const QString& name)
+	{
+		if (ORBIT == Vertex::ORBIT)
+		{
+			this->ensure_attribute(name);
+			this->touch_attribute(name);
+		}
+		this->begin_read();
+		typename MAP_TYPE::template Attribute<T, ORBIT> res = get_map()->template get_attribute<T, ORBIT>(name.toStdString());
+		this->end_read();
+		return res;
+	}
+
+private:
+
+	/*********************************************************
+	 * MANAGE UNDO / REDO
+	 *********************************************************/
+
+	inline UndoStack::MapAccess& get_map_access() override { return *this; }
+
+	inline int32 get_vertex_container() const override { return int32(Vertex::ORBIT); }
+
+	MapBaseData::ChunkArrayGen* get_chunk_array(int32 container, const std::string& name) override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		MapBaseData::ChunkArrayGen* cag = nullptr;
+		if (container == UndoStack::TOPOLOGY)
+			cag = cmap->get_topology_container().get_attribute(name);
+		else if (cgogn::Orbit(container) == MAP_TYPE::CDart::ORBIT)
+			cag = orbit_chunk_array<MAP_TYPE::CDart::ORBIT>(name);
+		else if (cgogn::Orbit(container) == Vertex::ORBIT)
+			cag = orbit_chunk_array<Vertex::ORBIT>(name);
+		else if (cgogn::Orbit(container) == Edge::ORBIT)
+			cag = orbit_chunk_array<Edge::ORBIT>(name);
+		else if (cgogn::Orbit(container) == Face::ORBIT)
+			cag = orbit_chunk_array<Face::ORBIT>(name);
+		else if (cgogn::Orbit(container) == MAP_TYPE::Volume::ORBIT)
+			cag = orbit_chunk_array<MAP_TYPE::Volume::ORBIT>(name);
+
+		// only the arrays of trivially copyable types can be saved byte per byte
+		if (dynamic_cast<MapBaseData::ChunkArray<VEC4>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<VEC3>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<VEC2>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<float64>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<float32>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<uint32>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<int32>*>(cag) ||
+			dynamic_cast<MapBaseData::ChunkArray<cgogn::Dart>*>(cag))
+			return cag;
+		return nullptr;
+	}
+
+	uint32 get_nb_lines(int32 container) override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		if (container == UndoStack::TOPOLOGY)
+			return cmap->get_topology_container().size();
+		if (cgogn::Orbit(container) == MAP_TYPE::CDart::ORBIT)
+			return orbit_nb_lines<MAP_TYPE::CDart::ORBIT>();
+		if (cgogn::Orbit(container) == Vertex::ORBIT)
+			return orbit_nb_lines<Vertex::ORBIT>();
+		if (cgogn::Orbit(container) == Edge::ORBIT)
+			return orbit_nb_lines<Edge::ORBIT>();
+		if (cgogn::Orbit(container) == Face::ORBIT)
+			return orbit_nb_lines<Face::ORBIT>();
+		if (cgogn::Orbit(container) == MAP_TYPE::Volume::ORBIT)
+			return orbit_nb_lines<MAP_TYPE::Volume::ORBIT>();
+		return 0u;
+	}
+
+	std::vector<std::string> get_array_names(int32 container) override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		if (container == UndoStack::TOPOLOGY)
+			return cmap->get_topology_container().get_names();
+		if (cgogn::Orbit(container) == Vertex::ORBIT && cmap->template is_embedded<Vertex::ORBIT>())
+			return cmap->template get_attribute_container<Vertex::ORBIT>().get_names();
+		return std::vector<std::string>();
+	}
+
+private:
+
+	template <cgogn::Orbit ORBIT>
+	MapBaseData::ChunkArrayGen* orbit_chunk_array(const std::string& name) const
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		if (!cmap->template is_embedded<ORBIT>())
+			return nullptr;
+		return cmap->template get_attribute_container<ORBIT>().get_attribute(name);
+	}
+
+	template <cgogn::Orbit ORBIT>
+	uint32 orbit_nb_lines() const
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		if (!cmap->template is_embedded<ORBIT>())
+			return 0u;
+		return cmap->template get_attribute_container<ORBIT>().size();
+	}
+
+	/*********************************************************
+	 * MANAGE COPY-ON-WRITE DUPLICATES
+	 *********************************************************/
+
+	inline MapBaseData* copy_map_data() const override
+	{
+		return copy_map(*static_cast<const MAP_TYPE*>(this->map_));
+	}
+
+	void rebind_attributes() override
+	{
+		if (bb_vertex_attribute_.is_valid())
+			bb_vertex_attribute_ = get_map()->template get_attribute<VEC3, Vertex::ORBIT>(bb_vertex_attribute_.get_name());
+	}
+
+	/*********************************************************
+	 * MANAGE COMPACTION
+	 *********************************************************/
+
+	inline void compact_map() override
+	{
+		get_map()->compact();
+	}
+
+	float64 measure_traversal() const override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		uint64 sum = 0u;
+		QElapsedTimer timer;
+		timer.start();
+		cmap->foreach_cell([&] (Face f)
+		{
+			cmap->foreach_incident_vertex(f, [&] (Vertex v) { sum += cmap->embedding(v); });
+		});
+		const float64 duration = float64(timer.nsecsElapsed()) / 1.0e6;
+		// keep the traversal from being optimized away
+		volatile uint64 sink = sum;
+		(void)sink;
+		return duration;
+	}
+
+	bool compute_scalar_range(const QString& name, float64& min, float64& max) const override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
+		const MapBaseData::ChunkArray<SCALAR>* ca = dynamic_cast<const MapBaseData::ChunkArray<SCALAR>*>(vcont.get_attribute(name.toStdString()));
+		if (!ca)
+			return false;
+
+		// the empty range (min > max) is the identity of the reduction
+		using Range = std::pair<SCALAR, SCALAR>;
+		const Range empty(std::numeric_limits<SCALAR>::max(), std::numeric_limits<SCALAR>::lowest());
+		const Range range = ThreadPool::instance().parallel_reduce(
+			std::size_t(vcont.begin()), std::size_t(vcont.end()), empty,
+			[&] (std::size_t first, std::size_t last) -> Range
+			{
+				Range r = empty;
+				for (std::size_t i = first; i < last; ++i)
+				{
+					if (!vcont.used(uint32(i)))
+						continue;
+					const SCALAR x = (*ca)[uint32(i)];
+					// NaN and infinite values would hide the range of the other values
+					if (std::isfinite(x))
+					{
+						r.first = std::min(r.first, x);
+						r.second = std::max(r.second, x);
+					}
+				}
+				return r;
+			},
+			[] (const Range& a, const Range& b) -> Range
+			{
+				return Range(std::min(a.first, b.first), std::max(a.second, b.second));
+			}
+		);
+		if (range.first > range.second)
+			return false;
+		min = float64(range.first);
+		max = float64(range.second);
+		return true;
+	}
+
+	bool gather_positions(const QString& name, const MapAdjacency& adjacency, std::vector<VEC3>& positions) const override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		const MapBaseData::ChunkArray<VEC3>* ca = dynamic_cast<const MapBaseData::ChunkArray<VEC3>*>(
+			cmap->template get_attribute_container<Vertex::ORBIT>().get_attribute(name.toStdString())
+		);
+		if (!ca)
+			return false;
+
+		positions.resize(adjacency.nb_vertices());
+		ThreadPool::instance().parallel_for(0, positions.size(), [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+				positions[i] = (*ca)[adjacency.vertex_lines_[i]];
+		});
+		return true;
+	}
+
+	void build_adjacency(MapAdjacency& adjacency) const override
+	{
+		const MAP_TYPE* cmap = static_cast<const MAP_TYPE*>(this->map_);
+		const uint32 invalid = std::numeric_limits<uint32>::max();
+
+		std::vector<Vertex> vertices;
+		cmap->foreach_cell([&] (Vertex v) { vertices.push_back(v); });
+		std::vector<Face> faces;
+		cmap->foreach_cell([&] (Face f) { faces.push_back(f); });
+
+		// the vertices are indexed by line, the faces by dart (they may not be embedded)
+		std::vector<uint32> vertex_index(cmap->template get_attribute_container<Vertex::ORBIT>().end(), invalid);
+		adjacency.vertex_lines_.resize(vertices.size());
+		for (uint32 i = 0u; i < uint32(vertices.size()); ++i)
+		{
+			adjacency.vertex_lines_[i] = cmap->embedding(vertices[i]);
+			vertex_index[adjacency.vertex_lines_[i]] = i;
+		}
+
+		std::vector<uint32> face_index(cmap->get_topology_container().end(), invalid);
+		const bool face_embedded = cmap->template is_embedded<Face::ORBIT>();
+		adjacency.face_lines_.resize(face_embedded ? faces.size() : 0u);
+		adjacency.face_darts_.resize(faces.size());
+		for (uint32 i = 0u; i < uint32(faces.size()); ++i)
+		{
+			adjacency.face_darts_[i] = faces[i].dart.index;
+			cmap->foreach_dart_of_orbit(faces[i], [&] (cgogn::Dart d) { face_index[d.index] = i; });
+			if (face_embedded)
+				adjacency.face_lines_[i] = cmap->embedding(faces[i]);
+		}
+
+		adjacency.vertex_vertex_.build(uint32(vertices.size()), [&] (uint32 i, const std::function<void(uint32)>& f)
+		{
+			cmap->foreach_adjacent_vertex_through_edge(vertices[i], [&] (Vertex u) { f(vertex_index[cmap->embedding(u)]); });
+		});
+		adjacency.vertex_face_.build(uint32(vertices.size()), [&] (uint32 i, const std::function<void(uint32)>& f)
+		{
+			cmap->foreach_incident_face(vertices[i], [&] (Face g) { f(face_index[g.dart.index]); });
+		});
+		adjacency.face_vertex_.build(uint32(faces.size()), [&] (uint32 i, const std::function<void(uint32)>& f)
+		{
+			cmap->foreach_incident_vertex(faces[i], [&] (Vertex u) { f(vertex_index[cmap->embedding(u)]); });
+		});
+
+		adjacency.boundary_vertex_.assign(vertices.size(), 0u);
+		ThreadPool::instance().parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				bool boundary = false;
+				cmap->foreach_dart_of_orbit(vertices[i], [&] (cgogn::Dart d) { boundary |= cmap->is_boundary(d); });
+				adjacency.boundary_vertex_[i] = boundary;
+			}
+		});
+	}
+
+	/*********************************************************
+	 * MANAGE DOUBLE-BUFFERED ATTRIBUTES
+	 *********************************************************/
+
+public:
+
+	/**
+	 * @brief create the back buffer of a vertex attribute, initialized with its values
+	 * A worker thread (e.g. a simulation) computes step N+1 in the back buffer while the attribute
+	 * (front buffer) feeds its VBO, then calls swap_buffers. The connectivity of the map must not
+	 * change while the back buffer is used.
+	 * @param name name of the vertex attribute
+	 * @return the back buffer (invalid if the attribute does not exist)
+	 */
+	template <typename T>
+	VertexAttribute<T> add_back_buffer(const QString& name)
+	{
+		VertexAttribute<T> back = get_back_buffer<T>(name);
+		if (back.is_valid())
+			return back;
+
+		this->begin_write();
+		// the map data may be copied by begin_write (copy-on-write duplicates)
+		MAP_TYPE* map = get_map();
+		VertexAttribute<T> front = map->template get_attribute<T, Vertex::ORBIT>(name.toStdString());
+		if (front.is_valid())
+		{
+			back = map->template add_attribute<T, Vertex::ORBIT>(back_buffer_name(name).toStdString());
+			map->foreach_cell([&] (Vertex v) { back[v] = front[v]; });
+		}
+		this->end_write();
+
+		return back;
+	}
+
+	/**
+	 * @brief get the back buffer of a vertex attribute
+	 * @return the back buffer (invalid if add_back_buffer has not been called)
+	 */
+	template <typename T>
+	VertexAttribute<T> get_back_buffer(const QString& name)
+	{
+		this->begin_read();
+		VertexAttribute<T> back = get_map()->template get_attribute<T, Vertex::ORBIT>(back_buffer_name(name).toStdString());
+		this->end_read();
+		return back;
+	}
+
+	/**
+	 * @brief make the back buffer the displayed values of the attribute (from any thread)
+	 * The buffers are exchanged in O(1) (no copy) under the write lock, then the VBO of the attribute
+	 * is refreshed on the GUI thread. The handles on the front and back buffers stay valid:
+	 * the back buffer then contains the previous values of the attribute.
+	 * In an undoable operation, the front buffer must be saved (undoable_write) before the first swap.
+	 * @return false if the attribute has no back buffer
+	 */
+	template <typename T>
+	bool swap_buffers(const QString& name)
+	{
+		return exchange_buffers<T>(name, nullptr);
+	}
+
+	/**
+	 * @brief make the back buffer the displayed values of the attribute when the buffers only differ on some chunks
+	 * Only these chunks are uploaded to the VBO of the attribute (e.g. the chunks of the moving vertices of a simulation).
+	 * @param chunks indices of the chunks that differ between the buffers (see chunk_index)
+	 */
+	template <typename T>
+	bool swap_buffers(const QString& name, const QSet<uint32>& chunks)
+	{
+		return exchange_buffers<T>(name, &chunks);
+	}
+
+	/**
+	 * @brief remove the back buffer of a vertex attribute
+	 */
+	template <typename T>
+	void remove_back_buffer(const QString& name)
+	{
+		this->begin_write();
+		MAP_TYPE* map = get_map();
+		VertexAttribute<T> back = map->template get_attribute<T, Vertex::ORBIT>(back_buffer_name(name).toStdString());
+		if (back.is_valid())
+			map->remove_attribute(back);
+		this->end_write();
+	}
+
+private:
+
+	// swap the buffers of an attribute, only the given chunks are declared modified (all if nullptr)
+	template <typename T>
+	bool exchange_buffers(const QString& name, const QSet<uint32>* chunks)
+	{
+		this->begin_write();
+		MAP_TYPE* map = get_map();
+		VertexAttribute<T> front = map->template get_attribute<T, Vertex::ORBIT>(name.toStdString());
+		VertexAttribute<T> back = map->template get_attribute<T, Vertex::ORBIT>(back_buffer_name(name).toStdString());
+		const bool res = front.is_valid() && back.is_valid();
+		if (res)
+		{
+			map->swap_attributes(front, back);
+			if (chunks)
+				this->notify_attribute_change(name, *chunks);
+			else
+				this->notify_attribute_change(name);
+		}
+		this->end_write();
+		return res;
+	}
+
+public:
+
 	/*********************************************************
 	 * MANAGE ATTRIBUTES
 	 *********************************************************/
@@ -345,56 +1541,228 @@ private:
 
 		if (!vbo)
 		{
-			MAP_TYPE* map = get_map();
-
-			const MAP_TYPE* cmap = map;
-			const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
-			MapBaseData::ChunkArrayGen* cag = vcont.get_attribute(name.toStdString());
-
-			MapBaseData::ChunkArray<VEC4>* ca4 = dynamic_cast<MapBaseData::ChunkArray<VEC4>*>(cag);
-			if (ca4)
+			if (!this->try_begin_read())
 			{
-				vbo = new cgogn::rendering::VBO(4);
-				VertexAttribute<VEC4> va(map, ca4);
-				cgogn::rendering::update_vbo(va, vbo);
-				this->vbos_.insert(name, vbo);
-				emit(vbo_added(vbo));
-				return vbo;
+				std::cerr << "MapHandler::create_vbo: map " << this->name_.toStdString() << " is being modified" << std::endl;
+				return nullptr;
 			}
+			vbo = fill_vbo(name, nullptr);
+			this->end_read();
 
-			MapBaseData::ChunkArray<VEC3>* ca3 = dynamic_cast<MapBaseData::ChunkArray<VEC3>*>(cag);
-			if (ca3)
+			if (vbo)
 			{
-				vbo = new cgogn::rendering::VBO(3);
-				VertexAttribute<VEC3> va(map, ca3);
-				cgogn::rendering::update_vbo(va, vbo);
 				this->vbos_.insert(name, vbo);
-				emit(vbo_added(vbo));
-				return vbo;
+				this->notify_vbo_added(vbo);
 			}
+		}
+
+		return vbo;
+	}
+
+	void update_vbo(const QString& name) override
+	{
+		cgogn::rendering::VBO* vbo = get_vbo(name);
+		if (vbo && this->try_begin_read())
+		{
+			fill_vbo(name, vbo);
+			this->end_read();
+		}
+	}
+
+private:
+
+	inline void refresh_vbo(const QString& name, cgogn::rendering::VBO* vbo) override
+	{
+		fill_vbo(name, vbo);
+	}
 
-			MapBaseData::ChunkArray<VEC2>* ca2 = dynamic_cast<MapBaseData::ChunkArray<VEC2>*>(cag);
-			if (ca2)
+	bool refresh_vbo_chunks(const QString& name, cgogn::rendering::VBO* vbo, const QSet<uint32>& chunks) override
+	{
+		const MAP_TYPE* cmap = get_map();
+		const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
+		MapBaseData::ChunkArrayGen* cag = vcont.get_attribute(name.toStdString());
+		if (!cag)
+			return false;
+
+		std::vector<void*> pointers;
+		uint32 chunk_bytes = 0u;
+		const uint32 nb_chunks = cag->get_chunks_pointers(pointers, chunk_bytes);
+
+		// the chunks must have the layout of fill_vbo (SCALAR values, one VBO element per line)
+		// and the VBO the size of the attribute, otherwise it is filled again
+		const uint32 nb_values = chunk_bytes / uint32(sizeof(SCALAR));
+		if (chunk_bytes % sizeof(SCALAR) != 0u ||
+			nb_values != cgogn::DefaultMapTraits::CHUNK_SIZE * vbo->vector_dimension() ||
+			vbo->size() != nb_chunks * cgogn::DefaultMapTraits::CHUNK_SIZE)
+			return false;
+
+		this->touch_attribute(name);
+
+		// each chunk is uploaded with glBufferSubData
+		const uint32 bytes = nb_values * uint32(sizeof(float32));
+		std::vector<float32> values(std::is_same<SCALAR, float32>::value ? 0u : nb_values);
+		vbo->bind();
+		foreach (uint32 c, chunks)
+		{
+			if (c >= nb_chunks)
+				continue;
+			if (std::is_same<SCALAR, float32>::value)
+				vbo->copy_data(c * bytes, bytes, pointers[c]);
+			else
 			{
-				vbo = new cgogn::rendering::VBO(2);
-				VertexAttribute<VEC2> va(map, ca2);
-				cgogn::rendering::update_vbo(va, vbo);
-				this->vbos_.insert(name, vbo);
-				emit(vbo_added(vbo));
-				return vbo;
+				const SCALAR* src = static_cast<const SCALAR*>(pointers[c]);
+				for (uint32 i = 0u; i < nb_values; ++i)
+					values[i] = float32(src[i]);
+				vbo->copy_data(c * bytes, bytes, values.data());
 			}
+		}
+		vbo->release();
+
+		return true;
+	}
+
+	bool refresh_packed_vbo(PackedVBO* vbo) override
+	{
+		MAP_TYPE* map = get_map();
+		const MAP_TYPE* cmap = map;
+		const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
+		MapBaseData::ChunkArray<VEC3>* ca = dynamic_cast<MapBaseData::ChunkArray<VEC3>*>(vcont.get_attribute(vbo->get_attribute_name().toStdString()));
+		if (!ca)
+			return false;
+
+		std::vector<void*> pointers;
+		uint32 chunk_bytes = 0u;
+		ca->get_chunks_pointers(pointers, chunk_bytes);
+		std::vector<const VEC3*> chunks;
+		chunks.reserve(pointers.size());
+		for (void* p : pointers)
+			chunks.push_back(static_cast<const VEC3*>(p));
+
+		// positions are quantized in the bounding box of the used vertices
+		cgogn::geometry::BoundingBox<VEC3> bb;
+		if (vbo->is_position())
+		{
+			VertexAttribute<VEC3> va(map, ca);
+			cgogn::geometry::compute_bounding_box(va, bb);
+		}
+		if (bb.is_initialized())
+			vbo->fill(chunks, cgogn::DefaultMapTraits::CHUNK_SIZE, bb.min(), bb.max());
+		else
+			vbo->fill(chunks, cgogn::DefaultMapTraits::CHUNK_SIZE, VEC3::Zero(), VEC3::Zero());
+
+		return true;
+	}
+
+	/**
+	 * @brief copy a vertex attribute into a VBO (the map must be locked for reading)
+	 * @param name name of the attribute
+	 * @param vbo the VBO to fill (created with the dimension of the attribute if nullptr)
+	 * @return the VBO or nullptr if the attribute cannot be stored in a VBO
+	 */
+	cgogn::rendering::VBO* fill_vbo(const QString& name, cgogn::rendering::VBO* vbo)
+	{
+		MAP_TYPE* map = get_map();
+		this->touch_attribute(name);
+
+		const MAP_TYPE* cmap = map;
+		const MapBaseData::ChunkArrayContainer<cgogn::uint32>& vcont = cmap->template get_attribute_container<Vertex::ORBIT>();
+		MapBaseData::ChunkArrayGen* cag = vcont.get_attribute(name.toStdString());
+
+		MapBaseData::ChunkArray<VEC4>* ca4 = dynamic_cast<MapBaseData::ChunkArray<VEC4>*>(cag);
+		if (ca4)
+			return fill_vbo(ca4, 4u, vbo);
+
+		MapBaseData::ChunkArray<VEC3>* ca3 = dynamic_cast<MapBaseData::ChunkArray<VEC3>*>(cag);
+		if (ca3)
+			return fill_vbo(ca3, 3u, vbo);
 
-			MapBaseData::ChunkArray<SCALAR>* ca1 = dynamic_cast<MapBaseData::ChunkArray<SCALAR>*>(cag);
-			if (ca1)
+		MapBaseData::ChunkArray<VEC2>* ca2 = dynamic_cast<MapBaseData::ChunkArray<VEC2>*>(cag);
+		if (ca2)
+			return fill_vbo(ca2, 2u, vbo);
+
+		MapBaseData::ChunkArray<SCALAR>* ca1 = dynamic_cast<MapBaseData::ChunkArray<SCALAR>*>(cag);
+		if (ca1)
+			return fill_vbo(ca1, 1u, vbo);
+
+		// stored attributes are read from their storage
+		StoredAttribute* stored = this->stored_attributes_.value(name, nullptr);
+		if (stored)
+			return fill_vbo(*stored, vbo);
+
+		return nullptr;
+	}
+
+	/**
+	 * @brief copy a vertex attribute into a VBO
+	 * float32 attributes have the layout of the VBO: their chunks are copied without conversion.
+	 */
+	template <typename T>
+	cgogn::rendering::VBO* fill_vbo(MapBaseData::ChunkArray<T>* ca, uint32 dim, cgogn::rendering::VBO* vbo)
+	{
+		if (!vbo)
+			vbo = new cgogn::rendering::VBO(dim);
+
+		if (std::is_same<SCALAR, float32>::value)
+		{
+			std::vector<void*> chunks;
+			uint32 chunk_bytes = 0u;
+			const uint32 nb_chunks = ca->get_chunks_pointers(chunks, chunk_bytes);
+			vbo->allocate(nb_chunks * cgogn::DefaultMapTraits::CHUNK_SIZE, dim);
+			uint8* dst = reinterpret_cast<uint8*>(vbo->lock_pointer());
+			for (uint32 i = 0u; i < nb_chunks; ++i, dst += chunk_bytes)
+				std::memcpy(dst, chunks[i], chunk_bytes);
+			vbo->release_pointer();
+		}
+		else
+		{
+			VertexAttribute<T> va(get_map(), ca);
+			cgogn::rendering::update_vbo(va, vbo);
+		}
+
+		return vbo;
+	}
+
+	/**
+	 * @brief copy a stored vertex attribute into a VBO
+	 */
+	cgogn::rendering::VBO* fill_vbo(const StoredAttribute& stored, cgogn::rendering::VBO* vbo)
+	{
+		uint32 dim = 0u;
+		if (stored.get_type_name() == QString::fromStdString(cgogn::name_of_type(VEC4())))
+			dim = 4u;
+		else if (stored.get_type_name() == QString::fromStdString(cgogn::name_of_type(VEC3())))
+			dim = 3u;
+		else if (stored.get_type_name() == QString::fromStdString(cgogn::name_of_type(VEC2())))
+			dim = 2u;
+		else if (stored.get_type_name() == QString::fromStdString(cgogn::name_of_type(SCALAR())))
+			dim = 1u;
+		else
+			return nullptr;
+
+		if (!vbo)
+			vbo = new cgogn::rendering::VBO(dim);
+
+		// same layout as cgogn::rendering::update_vbo: one VBO element per line of each chunk
+		vbo->allocate(stored.get_nb_chunks() * cgogn::DefaultMapTraits::CHUNK_SIZE, dim);
+		float32* dst = vbo->lock_pointer();
+		if (std::is_same<SCALAR, float32>::value)
+		{
+			// the stored chunks have the layout of the VBO
+			for (uint32 i = 0u; i < stored.get_nb_chunks(); ++i)
+				stored.read_chunk(i, reinterpret_cast<uint8*>(dst + uint64(i) * cgogn::DefaultMapTraits::CHUNK_SIZE * dim));
+		}
+		else
+		{
+			const uint32 nb_values = cgogn::DefaultMapTraits::CHUNK_SIZE * dim;
+			std::vector<SCALAR> chunk(nb_values);
+			for (uint32 i = 0u; i < stored.get_nb_chunks(); ++i)
 			{
-				vbo = new cgogn::rendering::VBO(1);
-				VertexAttribute<SCALAR> va(map, ca1);
-				cgogn::rendering::update_vbo(va, vbo);
-				this->vbos_.insert(name, vbo);
-				emit(vbo_added(vbo));
-				return vbo;
+				stored.read_chunk(i, reinterpret_cast<uint8*>(chunk.data()));
+				for (uint32 j = 0u; j < nb_values; ++j)
+					*dst++ = float32(chunk[j]);
 			}
 		}
+		vbo->release_pointer();
 
 		return vbo;
 	}
@@ -0,0 +1,151 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/memory_report.h>
+
+namespace schnapps
+{
+
+const float32 MapMemoryReport::HOLES_THRESHOLD = 0.25f;
+
+uint64 ContainerMemory::used() const
+{
+	uint64 res = 0u;
+	for (const MemoryBlock& b : attributes_)
+		res += b.used_;
+	return res;
+}
+
+uint64 ContainerMemory::allocated() const
+{
+	uint64 res = 0u;
+	for (const MemoryBlock& b : attributes_)
+		res += b.allocated_;
+	return res;
+}
+
+uint64 MapMemoryReport::used() const
+{
+	uint64 res = 0u;
+	for (const ContainerMemory& c : containers_)
+		res += c.used();
+	for (const MemoryBlock& b : caches_)
+		res += b.used_;
+	return res;
+}
+
+uint64 MapMemoryReport::allocated() const
+{
+	uint64 res = 0u;
+	for (const ContainerMemory& c : containers_)
+		res += c.allocated();
+	for (const MemoryBlock& b : caches_)
+		res += b.allocated_;
+	return res;
+}
+
+uint64 MapMemoryReport::gpu() const
+{
+	uint64 res = 0u;
+	for (const MemoryBlock& b : index_buffers_)
+		res += b.allocated_;
+	for (const MemoryBlock& b : vbos_)
+		res += b.allocated_;
+	return res;
+}
+
+uint64 MapMemoryReport::stored() const
+{
+	uint64 res = 0u;
+	for (const MemoryBlock& b : stored_attributes_)
+		res += b.allocated_;
+	return res;
+}
+
+bool MapMemoryReport::needs_compaction() const
+{
+	for (const ContainerMemory& c : containers_)
+		if (c.holes_ratio() > HOLES_THRESHOLD)
+			return true;
+	return false;
+}
+
+QString MapMemoryReport::to_string() const
+{
+	QString res;
+
+	for (const ContainerMemory& c : containers_)
+	{
+		res += QString("%1: %2 lines / %3 used / %4 allocated - %5 used, %6 allocated")
+			.arg(c.name_)
+			.arg(c.nb_lines_).arg(c.end_).arg(c.capacity_)
+			.arg(format_bytes(c.used())).arg(format_bytes(c.allocated()));
+		if (c.holes_ratio() > HOLES_THRESHOLD)
+			res += QString(" [%1% holes]").arg(int(c.holes_ratio() * 100.0f));
+		res += "\n";
+		for (const MemoryBlock& b : c.attributes_)
+			res += QString("    %1 (%2): %3 used, %4 allocated\n")
+				.arg(b.name_).arg(b.type_)
+				.arg(format_bytes(b.used_)).arg(format_bytes(b.allocated_));
+	}
+
+	for (const MemoryBlock& b : caches_)
+		res += QString("cache %1 (%2): %3\n").arg(b.name_).arg(b.type_).arg(format_bytes(b.allocated_));
+
+	for (const MemoryBlock& b : index_buffers_)
+		res += QString("index buffer %1: %2\n").arg(b.name_).arg(format_bytes(b.allocated_));
+
+	for (const MemoryBlock& b : vbos_)
+		res += QString("VBO %1: %2\n").arg(b.name_).arg(format_bytes(b.allocated_));
+
+	for (const MemoryBlock& b : stored_attributes_)
+		res += QString("stored attribute %1 (%2): %3\n").arg(b.name_).arg(b.type_).arg(format_bytes(b.allocated_));
+
+	res += QString("total: %1 used, %2 allocated (%3 wasted), %4 on GPU\n")
+		.arg(format_bytes(used())).arg(format_bytes(allocated()))
+		.arg(format_bytes(wasted())).arg(format_bytes(gpu()));
+
+	return res;
+}
+
+QString MapCompactionReport::to_string() const
+{
+	return QString("compacted in %1 ms: %2 allocated -> %3 allocated (%4 -> %5 used), traversal %6 ms -> %7 ms")
+		.arg(duration_, 0, 'f', 1)
+		.arg(format_bytes(allocated_before_)).arg(format_bytes(allocated_after_))
+		.arg(format_bytes(used_before_)).arg(format_bytes(used_after_))
+		.arg(traversal_before_, 0, 'f', 2).arg(traversal_after_, 0, 'f', 2);
+}
+
+QString format_bytes(uint64 bytes)
+{
+	if (bytes < 1024u)
+		return QString("%1 B").arg(bytes);
+	if (bytes < 1024u * 1024u)
+		return QString("%1 KB").arg(float64(bytes) / 1024.0, 0, 'f', 1);
+	if (bytes < 1024u * 1024u * 1024u)
+		return QString("%1 MB").arg(float64(bytes) / (1024.0 * 1024.0), 0, 'f', 1);
+	return QString("%1 GB").arg(float64(bytes) / (1024.0 * 1024.0 * 1024.0), 0, 'f', 2);
+}
+
+} // namespace schnapps
@@ -0,0 +1,186 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_MEMORY_REPORT_H_
+#define SCHNAPPS_CORE_MEMORY_REPORT_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+
+#include <QString>
+#include <QList>
+
+#include <string>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Memory used by an attribute or a buffer
+*/
+struct SCHNAPPS_CORE_API MemoryBlock
+{
+	MemoryBlock() : used_(0), allocated_(0) {}
+	MemoryBlock(const QString& name, const QString& type, uint64 used, uint64 allocated) :
+		name_(name), type_(type), used_(used), allocated_(allocated)
+	{}
+
+	QString name_;
+	QString type_;
+	// bytes holding live elements
+	uint64 used_;
+	// bytes allocated
+	uint64 allocated_;
+};
+
+/**
+* @brief Memory used by the attribute container of an orbit (or by the topology of the darts)
+* Lines between nb_lines_ and end_ are the holes left by removed cells,
+* lines between end_ and capacity_ are allocated but never used yet.
+*/
+struct SCHNAPPS_CORE_API ContainerMemory
+{
+	ContainerMemory() : nb_lines_(0), end_(0), capacity_(0) {}
+
+	QString name_;
+	uint32 nb_lines_;
+	uint32 end_;
+	uint32 capacity_;
+	QList<MemoryBlock> attributes_;
+
+	uint64 used() const;
+	uint64 allocated() const;
+
+	// ratio of the used range [0, end_) occupied by holes
+	inline float32 holes_ratio() const { return end_ > 0u ? float32(end_ - nb_lines_) / float32(end_) : 0.0f; }
+};
+
+/**
+* @brief Memory used by a map: attribute containers, index buffers and VBOs
+*/
+struct SCHNAPPS_CORE_API MapMemoryReport
+{
+	// holes ratio above which a container is worth compacting
+	static const float32 HOLES_THRESHOLD;
+
+	QList<ContainerMemory> containers_;
+	QList<MemoryBlock> index_buffers_;
+	QList<MemoryBlock> vbos_;
+	// attributes stored out of the map (size of the memory-mapped file or of the compressed data)
+	QList<MemoryBlock> stored_attributes_;
+	// data derived from the map (e.g. adjacency)
+	QList<MemoryBlock> caches_;
+
+	// CPU side
+	uint64 used() const;
+	uint64 allocated() const;
+	inline uint64 wasted() const { return allocated() - used(); }
+
+	// GPU side
+	uint64 gpu() const;
+
+	// attributes stored out of the map
+	uint64 stored() const;
+
+	/**
+	 * @brief does one of the containers have enough holes to be worth compacting
+	 */
+	bool needs_compaction() const;
+
+	/**
+	 * @brief human readable report (one line per container/attribute/buffer)
+	 */
+	QString to_string() const;
+
+	/**
+	 * @brief measure the memory of a ChunkArrayContainer
+	 * @param name name of the container (orbit name)
+	 * @param container the container
+	 * @param chunk_size number of elements of a chunk
+	 */
+	template <typename CONTAINER>
+	static ContainerMemory container_memory(const QString& name, const CONTAINER& container, uint32 chunk_size)
+	{
+		ContainerMemory cm;
+		cm.name_ = name;
+		cm.nb_lines_ = container.size();
+		cm.end_ = container.end();
+		cm.capacity_ = container.capacity();
+
+		const std::vector<std::string>& names = container.get_names();
+		const std::vector<std::string>& type_names = container.get_type_names();
+		std::vector<void*> chunks;
+		for (std::size_t i = 0u; i < names.size(); ++i)
+		{
+			const auto* cag = container.get_attribute(names[i]);
+			if (!cag)
+				continue;
+			uint32 block_size = 0u;
+			const uint32 nb_chunks = cag->get_chunks_pointers(chunks, block_size);
+			const uint64 element_size = block_size / chunk_size;
+			cm.attributes_.push_back(MemoryBlock(
+				QString::fromStdString(names[i]),
+				QString::fromStdString(type_names[i]),
+				uint64(cm.nb_lines_) * element_size,
+				uint64(nb_chunks) * block_size
+			));
+		}
+		return cm;
+	}
+};
+
+/**
+* @brief Effect of the compaction of a map (see MapHandlerGen::compact)
+*/
+struct SCHNAPPS_CORE_API MapCompactionReport
+{
+	MapCompactionReport() :
+		used_before_(0), allocated_before_(0), used_after_(0), allocated_after_(0),
+		traversal_before_(0), traversal_after_(0), duration_(0)
+	{}
+
+	// bytes of the attribute containers
+	uint64 used_before_;
+	uint64 allocated_before_;
+	uint64 used_after_;
+	uint64 allocated_after_;
+
+	// duration in ms of a traversal of the vertices of all the faces
+	float64 traversal_before_;
+	float64 traversal_after_;
+
+	// duration in ms of the compaction
+	float64 duration_;
+
+	QString to_string() const;
+};
+
+/**
+* @brief format a number of bytes (B, KB, MB, GB)
+*/
+SCHNAPPS_CORE_API QString format_bytes(uint64 bytes);
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_MEMORY_REPORT_H_
@@ -0,0 +1,190 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/packed_vbo.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace schnapps
+{
+
+PackedVBO::PackedVBO(const QString& attribute_name, Format format) :
+	attribute_name_(attribute_name),
+	name_(packed_name(attribute_name, format)),
+	format_(format),
+	nb_vectors_(0),
+	offset_(0.0f, 0.0f, 0.0f),
+	scale_(1.0f, 1.0f, 1.0f),
+	buffer_(QOpenGLBuffer::VertexBuffer)
+{
+	buffer_.create();
+	buffer_.setUsagePattern(QOpenGLBuffer::StaticDraw);
+}
+
+PackedVBO::~PackedVBO()
+{
+	buffer_.destroy();
+}
+
+QString PackedVBO::packed_name(const QString& attribute_name, Format format)
+{
+	return attribute_name + QString(":") + format_name(format);
+}
+
+QString PackedVBO::format_name(Format format)
+{
+	switch (format)
+	{
+		case POSITION_Q16: return QString("q16");
+		case NORMAL_OCT16: return QString("oct16");
+		case NORMAL_OCT8: return QString("oct8");
+	}
+	return QString();
+}
+
+uint32 PackedVBO::vector_bytes() const
+{
+	switch (format_)
+	{
+		// the 4th component keeps the vectors 4-byte aligned
+		case POSITION_Q16: return 4u * sizeof(uint16);
+		case NORMAL_OCT16: return 2u * sizeof(int16);
+		case NORMAL_OCT8: return 2u * sizeof(int8);
+	}
+	return 0u;
+}
+
+uint32 PackedVBO::nb_components() const
+{
+	return format_ == POSITION_Q16 ? 3u : 2u;
+}
+
+void PackedVBO::encode_position(const VEC3& p, const VEC3& offset, const VEC3& inv_scale, uint16* dst)
+{
+	for (uint32 i = 0u; i < 3u; ++i)
+	{
+		// unused lines of the chunks may hold any value
+		const SCALAR q = std::isfinite(p[i]) ? (p[i] - offset[i]) * inv_scale[i] : SCALAR(0);
+		dst[i] = uint16(std::lround(std::min(std::max(q, SCALAR(0)), SCALAR(1)) * 65535.0));
+	}
+	dst[3] = 0u;
+}
+
+void PackedVBO::encode_octahedral(const VEC3& n, float32& u, float32& v)
+{
+	const SCALAR l1 = std::abs(n[0]) + std::abs(n[1]) + std::abs(n[2]);
+	if (!(l1 > SCALAR(0)) || !std::isfinite(l1))
+	{
+		u = 0.0f;
+		v = 0.0f;
+		return;
+	}
+
+	float32 x = float32(n[0] / l1);
+	float32 y = float32(n[1] / l1);
+	// the lower hemisphere is folded on the corners of the square
+	if (n[2] < SCALAR(0))
+	{
+		const float32 fx = (1.0f - std::abs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+		const float32 fy = (1.0f - std::abs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+		x = fx;
+		y = fy;
+	}
+	u = x;
+	v = y;
+}
+
+void PackedVBO::fill(const std::vector<const VEC3*>& chunks, uint32 chunk_size, const VEC3& bb_min, const VEC3& bb_max)
+{
+	nb_vectors_ = uint32(chunks.size()) * chunk_size;
+	std::vector<uint8> data(std::size_t(nb_vectors_) * vector_bytes());
+
+	switch (format_)
+	{
+		case POSITION_Q16:
+		{
+			VEC3 inv_scale;
+			for (uint32 i = 0u; i < 3u; ++i)
+			{
+				const SCALAR extent = bb_max[i] - bb_min[i];
+				inv_scale[i] = extent > SCALAR(0) ? SCALAR(1) / extent : SCALAR(0);
+				offset_[i] = float32(bb_min[i]);
+				scale_[i] = float32(extent);
+			}
+			uint16* dst = reinterpret_cast<uint16*>(data.data());
+			for (const VEC3* chunk : chunks)
+				for (uint32 j = 0u; j < chunk_size; ++j, dst += 4)
+					encode_position(chunk[j], bb_min, inv_scale, dst);
+			break;
+		}
+		case NORMAL_OCT16:
+		{
+			int16* dst = reinterpret_cast<int16*>(data.data());
+			for (const VEC3* chunk : chunks)
+				for (uint32 j = 0u; j < chunk_size; ++j)
+				{
+					float32 u, v;
+					encode_octahedral(chunk[j], u, v);
+					*dst++ = int16(std::lround(u * 32767.0f));
+					*dst++ = int16(std::lround(v * 32767.0f));
+				}
+			break;
+		}
+		case NORMAL_OCT8:
+		{
+			int8* dst = reinterpret_cast<int8*>(data.data());
+			for (const VEC3* chunk : chunks)
+				for (uint32 j = 0u; j < chunk_size; ++j)
+				{
+					float32 u, v;
+					encode_octahedral(chunk[j], u, v);
+					*dst++ = int8(std::lround(u * 127.0f));
+					*dst++ = int8(std::lround(v * 127.0f));
+				}
+			break;
+		}
+	}
+
+	buffer_.bind();
+	buffer_.allocate(data.data(), int(data.size()));
+	buffer_.release();
+}
+
+void PackedVBO::bind_attribute(QOpenGLFunctions* gl, int location)
+{
+	GLenum type = GL_UNSIGNED_SHORT;
+	if (format_ == NORMAL_OCT16)
+		type = GL_SHORT;
+	else if (format_ == NORMAL_OCT8)
+		type = GL_BYTE;
+
+	buffer_.bind();
+	gl->glEnableVertexAttribArray(GLuint(location));
+	// integers are normalized: [0,1] for unsigned, [-1,1] for signed values
+	gl->glVertexAttribPointer(GLuint(location), GLint(nb_components()), type, GL_TRUE, GLsizei(vector_bytes()), nullptr);
+	buffer_.release();
+}
+
+} // namespace schnapps
@@ -0,0 +1,123 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_PACKED_VBO_H_
+#define SCHNAPPS_CORE_PACKED_VBO_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QVector3D>
+#include <QString>
+
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief VBO of a VEC3 vertex attribute stored in a compact GPU format
+* - POSITION_Q16: positions quantized on 16 bits relative to a bounding box (4 x uint16, 8 bytes instead of 12),
+*   the shader computes offset + scale * value
+* - NORMAL_OCT16 / NORMAL_OCT8: normals octahedral-encoded on 2 x 16 bits (4 bytes) or 2 x 8 bits (2 bytes)
+* Values are normalized integers: the shader reads them as floats in [0,1] (positions) or [-1,1] (normals).
+* As cgogn::rendering::VBO, a PackedVBO must be created, filled and deleted with an OpenGL context current.
+*/
+class SCHNAPPS_CORE_API PackedVBO
+{
+public:
+
+	enum Format
+	{
+		POSITION_Q16 = 0,
+		NORMAL_OCT16,
+		NORMAL_OCT8
+	};
+
+	/**
+	 * @param attribute_name name of the encoded vertex attribute
+	 * @param format encoding of the values
+	 */
+	PackedVBO(const QString& attribute_name, Format format);
+	~PackedVBO();
+
+	PackedVBO(const PackedVBO&) = delete;
+	PackedVBO& operator=(const PackedVBO&) = delete;
+
+	/**
+	 * @brief name of a packed VBO: <attribute name>:<format name>
+	 */
+	static QString packed_name(const QString& attribute_name, Format format);
+	// "q16", "oct16", "oct8"
+	static QString format_name(Format format);
+
+	inline const QString& get_name() const { return name_; }
+	inline const QString& get_attribute_name() const { return attribute_name_; }
+	inline Format get_format() const { return format_; }
+	inline bool is_position() const { return format_ == POSITION_Q16; }
+	inline bool is_normal() const { return format_ != POSITION_Q16; }
+
+	// number of encoded vectors
+	inline uint32 size() const { return nb_vectors_; }
+	// bytes per encoded vector
+	uint32 vector_bytes() const;
+	// components read by the shader (3 for positions, 2 for normals)
+	uint32 nb_components() const;
+
+	// dequantization of positions: offset + scale * value
+	inline const QVector3D& get_offset() const { return offset_; }
+	inline const QVector3D& get_scale() const { return scale_; }
+
+	/**
+	 * @brief encode the chunks of a VEC3 attribute
+	 * @param chunks the chunks of the attribute
+	 * @param chunk_size number of vectors per chunk
+	 * @param bb_min, bb_max bounding box of the positions (ignored for normals)
+	 */
+	void fill(const std::vector<const VEC3*>& chunks, uint32 chunk_size, const VEC3& bb_min, const VEC3& bb_max);
+
+	/**
+	 * @brief set the buffer as the source of a vertex attribute of the bound shader program
+	 * @param location location of the vertex attribute in the program
+	 */
+	void bind_attribute(QOpenGLFunctions* gl, int location);
+
+	static void encode_position(const VEC3& p, const VEC3& offset, const VEC3& inv_scale, uint16* dst);
+	static void encode_octahedral(const VEC3& n, float32& u, float32& v);
+
+private:
+
+	QString attribute_name_;
+	QString name_;
+	Format format_;
+	uint32 nb_vectors_;
+	QVector3D offset_;
+	QVector3D scale_;
+	QOpenGLBuffer buffer_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_PACKED_VBO_H_
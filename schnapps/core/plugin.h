@@ -74,6 +74,14 @@ private:
 
 	inline void set_schnapps(SCHNApps* s) { schnapps_ = s; }
 
+	/**
+	 * @brief non-OpenGL initialization of the plugin, run before enable()
+	 * Called from a worker of the ThreadPool, concurrently with the preparation of the plugins
+	 * that do not depend on this one: it must not use OpenGL, widgets or the SCHNApps object.
+	 * @return false if the plugin cannot be enabled
+	 */
+	virtual bool prepare() { return true; }
+
 	virtual bool enable() = 0;
 	virtual void disable() = 0;
 
@@ -0,0 +1,156 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/plugin_manifest.h>
+
+#include <QPluginLoader>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QStandardPaths>
+
+#include <iostream>
+
+namespace schnapps
+{
+
+namespace
+{
+// version of the manifest format: a manifest of another version is ignored
+const int manifest_version = 1;
+}
+
+PluginManifest::PluginManifest(const QString& filename) :
+	filename_(filename),
+	modified_(false)
+{
+	QFile file(filename_);
+	if (file.open(QIODevice::ReadOnly))
+	{
+		QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+		if (root.value("version").toInt() == manifest_version)
+			plugins_ = root.value("plugins").toObject();
+	}
+}
+
+PluginManifest::~PluginManifest()
+{
+	save();
+}
+
+QString PluginManifest::default_filename()
+{
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("plugins_manifest.json");
+}
+
+bool PluginManifest::get_plugin_info(const QString& file_path, PluginInfo& info)
+{
+	QFileInfo fi(file_path);
+	const qint64 modified = fi.lastModified().toMSecsSinceEpoch();
+	const qint64 size = fi.size();
+
+	QJsonObject entry = plugins_.value(file_path).toObject();
+	if (entry.isEmpty() ||
+		qint64(entry.value("modified").toDouble()) != modified ||
+		qint64(entry.value("size").toDouble()) != size)
+	{
+		// new or modified library: read its metadata (the library is not loaded)
+		QJsonObject metadata = QPluginLoader(file_path).metaData();
+		entry = QJsonObject();
+		entry.insert("modified", double(modified));
+		entry.insert("size", double(size));
+		entry.insert("valid", metadata.value("IID").toString() == "SCHNApps.Plugin");
+		entry.insert("metadata", metadata.value("MetaData").toObject());
+		plugins_.insert(file_path, entry);
+		modified_ = true;
+	}
+
+	if (!entry.value("valid").toBool())
+		return false;
+
+	info = PluginInfo();
+	info.file_path_ = file_path;
+	parse_metadata(entry.value("metadata").toObject(), info);
+	if (info.name_.isEmpty())
+	{
+#ifdef WIN32
+		info.name_ = fi.baseName();
+#else
+		info.name_ = fi.baseName().remove(0, 3);
+#endif
+	}
+
+	return true;
+}
+
+bool PluginManifest::save()
+{
+	if (!modified_)
+		return true;
+
+	foreach (const QString& file_path, plugins_.keys())
+	{
+		if (!QFileInfo::exists(file_path))
+			plugins_.remove(file_path);
+	}
+
+	QDir().mkpath(QFileInfo(filename_).absolutePath());
+	QFile file(filename_);
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		std::cerr << "PluginManifest: unable to write " << filename_.toStdString() << std::endl;
+		return false;
+	}
+
+	QJsonObject root;
+	root.insert("version", manifest_version);
+	root.insert("plugins", plugins_);
+	file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+	modified_ = false;
+
+	return true;
+}
+
+void PluginManifest::parse_metadata(const QJsonObject& metadata, PluginInfo& info)
+{
+	info.name_ = metadata.value("name").toString();
+	info.interaction_ = metadata.value("interaction").toBool();
+
+	foreach (const QJsonValue& dep, metadata.value("dependencies").toArray())
+		info.dependencies_.append(dep.toString());
+
+	foreach (const QJsonValue& m, metadata.value("menu").toArray())
+	{
+		QJsonObject o = m.toObject();
+		PluginMenuEntry entry;
+		entry.menu_path_ = o.value("path").toString();
+		entry.slot_ = o.value("slot").toString();
+		if (!entry.menu_path_.isEmpty() && !entry.slot_.isEmpty())
+			info.menu_entries_.append(entry);
+	}
+}
+
+} // namespace schnapps
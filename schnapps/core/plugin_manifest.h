@@ -0,0 +1,125 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_PLUGIN_MANIFEST_H_
+#define SCHNAPPS_CORE_PLUGIN_MANIFEST_H_
+
+#include <schnapps/core/dll.h>
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QJsonObject>
+
+namespace schnapps
+{
+
+/**
+* @brief menu entry declared in the metadata of a plugin
+* The entry is shown before the plugin is loaded and triggers its slot once loaded.
+*/
+struct SCHNAPPS_CORE_API PluginMenuEntry
+{
+	// menu path (same syntax as SCHNApps::add_menu_action)
+	QString menu_path_;
+	// slot of the plugin called when the entry is triggered
+	QString slot_;
+};
+
+/**
+* @brief description of a plugin read from its metadata (without loading the library)
+*/
+struct SCHNAPPS_CORE_API PluginInfo
+{
+	PluginInfo() : interaction_(false) {}
+
+	QString name_;
+	QString file_path_;
+	// the plugin can be linked to views
+	bool interaction_;
+	// names of the plugins that must be enabled before this one
+	QStringList dependencies_;
+	QList<PluginMenuEntry> menu_entries_;
+};
+
+/**
+* @brief The PluginManifest caches the metadata of the plugin libraries.
+* Metadata are read from the libraries (QPluginLoader::metaData, no dlopen) only when
+* a library is new or has been modified since the last run, so that a startup only
+* reads the manifest file. The metadata of a plugin is the JSON file given to
+* Q_PLUGIN_METADATA, e.g.:
+*
+*	{
+*		"name": "import",
+*		"interaction": false,
+*		"dependencies": [],
+*		"menu": [ { "path": "Surface;Import Mesh", "slot": "import_surface_mesh_from_file_dialog" } ]
+*	}
+*/
+class SCHNAPPS_CORE_API PluginManifest
+{
+public:
+
+	/**
+	 * @brief PluginManifest constructor
+	 * @param filename path of the manifest file (read if it exists)
+	 */
+	PluginManifest(const QString& filename);
+
+	/**
+	 * @brief PluginManifest destructor: saves the manifest if it has been modified
+	 */
+	~PluginManifest();
+
+	/**
+	 * @brief get the description of a plugin library
+	 * @param file_path absolute path of the library
+	 * @param info the description (name deduced from the file name if not given by the metadata)
+	 * @return false if the library is not a SCHNApps plugin
+	 */
+	bool get_plugin_info(const QString& file_path, PluginInfo& info);
+
+	/**
+	 * @brief write the manifest file if it has been modified
+	 * Entries of libraries that do not exist anymore are removed.
+	 * @return false if the file cannot be written
+	 */
+	bool save();
+
+	/**
+	 * @brief default location of the manifest file (user cache directory)
+	 */
+	static QString default_filename();
+
+private:
+
+	static void parse_metadata(const QJsonObject& metadata, PluginInfo& info);
+
+	QString filename_;
+	QJsonObject plugins_;
+	bool modified_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_PLUGIN_MANIFEST_H_
@@ -26,6 +26,7 @@
 
 #include <schnapps/core/dll.h>
 #include <schnapps/core/plugin.h>
+#include <schnapps/core/job.h>
 
 namespace schnapps
 {
@@ -41,6 +42,19 @@ public:
 
 	~PluginProcessing() override
 	{}
+
+protected:
+
+	/**
+	 * @brief run a processing task asynchronously (see SCHNApps::submit_job)
+	 * The name of the plugin prefixes the name of the job.
+	 * @param name name of the job
+	 * @param task function executed by a worker thread, it must poll Job::is_canceled
+	 * @param continuation function executed by the GUI thread with the results of the task
+	 * @param map map used by the task (not deleted before the end of the task)
+	 * @return the job (valid until its finished signal)
+	 */
+	Job* submit_job(const QString& name, const Job::Task& task, const Job::Continuation& continuation = Job::Continuation(), MapHandlerGen* map = nullptr);
 };
 
 } // namespace schnapps
@@ -28,6 +28,10 @@
 #include <schnapps/core/plugin.h>
 #include <schnapps/core/plugin_interaction.h>
 #include <schnapps/core/map_handler.h>
+#include <schnapps/core/memory_report.h>
+#include <schnapps/core/frame_recorder.h>
+#include <schnapps/core/startup_profiler.h>
+#include <schnapps/core/thread_pool.h>
 
 #include <schnapps/core/control_dock_camera_tab.h>
 #include <schnapps/core/control_dock_plugin_tab.h>
@@ -50,27 +54,110 @@
 #include <QFile>
 #include <QByteArray>
 #include <QAction>
+#include <QMetaMethod>
+#include <QRegularExpression>
+#include <QSet>
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QTimer>
+#include <QCoreApplication>
+#include <QEventLoop>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace schnapps
 {
 
 SCHNApps::SCHNApps(const QString& app_path, SCHNAppsWindow* window) :
 	app_path_(app_path),
+	plugin_manifest_(nullptr),
+	memory_monitor_(nullptr),
+	memory_min_free_ratio_(0.1),
+	memory_cold_delay_s_(300u),
+	undo_memory_limit_mb_(0u),
 	first_view_(nullptr),
 	selected_view_(nullptr),
-	window_(window)
+	window_(window),
+	offscreen_surface_(nullptr),
+	offscreen_context_(nullptr),
+	control_camera_tab_(nullptr),
+	control_plugin_tab_(nullptr),
+	control_map_tab_(nullptr),
+	root_splitter_(nullptr),
+	root_splitter_initialized_(false)
 {
+	StartupProfiler::Scope profile("SCHNApps");
+
+	plugin_manifest_ = new PluginManifest(PluginManifest::default_filename());
+
+	// SCHNAPPS_MEMORY_MONITOR="<min_free_ratio>[:<cold_delay_s>]" enables the memory pressure monitor
+	const QString memory_setting = QString::fromLocal8Bit(qgetenv("SCHNAPPS_MEMORY_MONITOR"));
+	if (!memory_setting.isEmpty())
+	{
+		const QStringList values = memory_setting.split(':');
+		bool ratio_ok = false;
+		bool delay_ok = values.size() < 2;
+		const double min_free_ratio = values[0].toDouble(&ratio_ok);
+		const unsigned int cold_delay_s = values.size() < 2 ? memory_cold_delay_s_ : values[1].toUInt(&delay_ok);
+		if (ratio_ok && delay_ok && min_free_ratio > 0.0 && min_free_ratio < 1.0)
+			set_memory_monitor(true, min_free_ratio, cold_delay_s);
+		else
+			std::cerr << "SCHNApps: invalid SCHNAPPS_MEMORY_MONITOR value \"" << memory_setting.toStdString() << "\"" << std::endl;
+	}
+
+	// SCHNAPPS_UNDO_MEMORY_LIMIT="<MB>" bounds the undo stack of each map
+	const QString undo_setting = QString::fromLocal8Bit(qgetenv("SCHNAPPS_UNDO_MEMORY_LIMIT"));
+	if (!undo_setting.isEmpty())
+	{
+		bool ok = false;
+		undo_memory_limit_mb_ = undo_setting.toUInt(&ok);
+		if (!ok)
+			std::cerr << "SCHNApps: invalid SCHNAPPS_UNDO_MEMORY_LIMIT value \"" << undo_setting.toStdString() << "\"" << std::endl;
+	}
+
+	if (!window_)
+	{
+		// headless: no widget, views render in an offscreen context
+
+		offscreen_surface_ = new QOffscreenSurface();
+		offscreen_surface_->create();
+		offscreen_context_ = new QOpenGLContext(this);
+		offscreen_context_->setShareContext(QOpenGLContext::globalShareContext());
+		if (offscreen_context_->create())
+			make_offscreen_context_current();
+		else
+			std::cerr << "SCHNApps: unable to create offscreen OpenGL context" << std::endl;
+
+		register_plugins_directory(app_path + QString("/../lib"));
+		return;
+	}
+
 	// create & setup control dock
 
+	StartupProfiler::instance().begin("control dock");
 	control_camera_tab_ = new ControlDock_CameraTab(this);
 	window_->control_dock_tab_widget_->addTab(control_camera_tab_, control_camera_tab_->title());
 	control_plugin_tab_ = new ControlDock_PluginTab(this);
 	window_->control_dock_tab_widget_->addTab(control_plugin_tab_, control_plugin_tab_->title());
 	control_map_tab_ = new ControlDock_MapTab(this);
 	window_->control_dock_tab_widget_->addTab(control_map_tab_, control_map_tab_->title());
+	StartupProfiler::instance().end();
 
 	// create & setup central widget (views)
 
+	StartupProfiler::instance().begin("first view");
 	root_splitter_ = new QSplitter(window_->centralwidget);
 	root_splitter_initialized_ = false;
 	window_->central_layout_->addWidget(root_splitter_);
@@ -78,12 +165,148 @@ SCHNApps::SCHNApps(const QString& app_path, SCHNAppsWindow* window) :
 	first_view_ = add_view();
 	set_selected_view(first_view_);
 	root_splitter_->addWidget(first_view_);
+	StartupProfiler::instance().end();
 
 	register_plugins_directory(app_path + QString("/../lib"));
 }
 
 SCHNApps::~SCHNApps()
-{}
+{
+	// running jobs may use maps and plugins
+	cancel_jobs();
+	foreach (Job* job, jobs_)
+		delete job;
+	jobs_.clear();
+
+	delete plugin_manifest_;
+	if (offscreen_context_)
+		offscreen_context_->doneCurrent();
+	delete offscreen_surface_;
+}
+
+bool SCHNApps::make_offscreen_context_current()
+{
+	if (offscreen_context_ && offscreen_context_->isValid())
+		return offscreen_context_->makeCurrent(offscreen_surface_);
+	return false;
+}
+
+/*********************************************************
+ * MANAGE SCRIPTS
+ *********************************************************/
+
+bool SCHNApps::execute_command(const QString& command)
+{
+	QString line = command.trimmed();
+	if (line.isEmpty() || line.startsWith('#'))
+		return true;
+
+	// split the line in tokens, double quotes enclose tokens with spaces
+	QStringList tokens;
+	QRegularExpression re("\"([^\"]*)\"|(\\S+)");
+	QRegularExpressionMatchIterator it = re.globalMatch(line);
+	while (it.hasNext())
+	{
+		QRegularExpressionMatch match = it.next();
+		tokens << (match.capturedStart(1) != -1 ? match.captured(1) : match.captured(2));
+	}
+
+	if (tokens.size() < 2)
+	{
+		std::cerr << "SCHNApps: invalid command \"" << line.toStdString() << "\"" << std::endl;
+		return false;
+	}
+
+	QObject* object = get_script_object(tokens[0]);
+	if (!object)
+	{
+		std::cerr << "SCHNApps: unknown object \"" << tokens[0].toStdString() << "\"" << std::endl;
+		return false;
+	}
+
+	return invoke_slot(object, tokens[1], tokens.mid(2));
+}
+
+bool SCHNApps::execute_script(const QString& filename)
+{
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		std::cerr << "SCHNApps: unable to open script " << filename.toStdString() << std::endl;
+		return false;
+	}
+
+	QTextStream stream(&file);
+	unsigned int line_number = 0;
+	while (!stream.atEnd())
+	{
+		QString line = stream.readLine();
+		++line_number;
+		if (!execute_command(line))
+		{
+			std::cerr << "SCHNApps: script " << filename.toStdString() << " failed at line " << line_number << std::endl;
+			return false;
+		}
+		// without event loop, the next command must see the results of the jobs of this one
+		if (!window_)
+			wait_for_jobs();
+	}
+
+	return true;
+}
+
+QObject* SCHNApps::get_script_object(const QString& name)
+{
+	if (name == "schnapps")
+		return this;
+	if (plugins_.contains(name))
+		return plugins_[name];
+	// the first use of a plugin in a script loads it
+	if (available_plugins_.contains(name))
+		return enable_plugin(name);
+	if (maps_.contains(name))
+		return maps_[name];
+	if (views_.contains(name))
+		return views_[name];
+	if (cameras_.contains(name))
+		return cameras_[name];
+	return nullptr;
+}
+
+bool SCHNApps::invoke_slot(QObject* object, const QString& slot_name, const QStringList& args)
+{
+	if (args.size() > 10)
+		return false;
+
+	const QMetaObject* mo = object->metaObject();
+	for (int i = 0; i < mo->methodCount(); ++i)
+	{
+		QMetaMethod method = mo->method(i);
+		if (method.name() != slot_name.toLatin1() || method.parameterCount() != args.size())
+			continue;
+
+		// convert the string arguments to the types of the slot parameters
+		QList<QVariant> values;
+		bool converted = true;
+		for (int j = 0; j < args.size() && converted; ++j)
+		{
+			QVariant v(args[j]);
+			converted = v.convert(method.parameterType(j));
+			values.append(v);
+		}
+		if (!converted)
+			continue;
+
+		QGenericArgument a[10];
+		for (int j = 0; j < values.size(); ++j)
+			a[j] = QGenericArgument(QMetaType::typeName(method.parameterType(j)), values[j].data());
+
+		return method.invoke(object, Qt::DirectConnection, a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], a[9]);
+	}
+
+	std::cerr << "SCHNApps: no slot " << slot_name.toStdString() << " with " << args.size() << " argument(s) in " << object->metaObject()->className() << std::endl;
+	return false;
+}
 
 /*********************************************************
  * MANAGE CAMERAS
@@ -130,6 +353,8 @@ Camera* SCHNApps::get_camera(const QString& name) const
 
 void SCHNApps::register_plugins_directory(const QString& path)
 {
+	StartupProfiler::Scope profile("scan plugins directory " + path);
+
 #ifdef WIN32
 #ifdef _DEBUG
 	QDir directory(path + QString("Debug/"));
@@ -150,20 +375,23 @@ void SCHNApps::register_plugins_directory(const QString& path)
 
 		foreach (QString plugin_file, plugin_files)
 		{
-			QFileInfo pfi(plugin_file);
-#ifdef WIN32
-			QString plugin_name = pfi.baseName();
-#else
-			QString plugin_name = pfi.baseName().remove(0, 3);
-#endif
 			QString plugin_file_path = directory.absoluteFilePath(plugin_file);
 
-			if(!available_plugins_.contains(plugin_name))
+			// metadata come from the manifest: the library is not loaded
+			PluginInfo info;
+			if (!plugin_manifest_->get_plugin_info(plugin_file_path, info))
+				continue;
+
+			if(!available_plugins_.contains(info.name_))
 			{
-				available_plugins_.insert(plugin_name, plugin_file_path);
-				emit(plugin_available_added(plugin_name));
+				available_plugins_.insert(info.name_, plugin_file_path);
+				plugin_infos_.insert(info.name_, info);
+				add_plugin_placeholder_actions(info);
+				emit(plugin_available_added(info.name_));
 			}
 		}
+
+		plugin_manifest_->save();
 	}
 }
 
@@ -172,53 +400,185 @@ Plugin* SCHNApps::enable_plugin(const QString& plugin_name)
 	if (plugins_.contains(plugin_name))
 		return plugins_[plugin_name];
 
-	if (available_plugins_.contains(plugin_name))
+	enable_plugins(plugin_name);
+	return get_plugin(plugin_name);
+}
+
+bool SCHNApps::enable_plugins(const QString& plugin_names)
+{
+	StartupProfiler::Scope profile("enable plugins " + plugin_names);
+
+	// plugins to enable, dependencies first, with their depth in the dependency graph
+	QStringList order;
+	QMap<QString, int> levels;
+	bool res = true;
+	foreach (const QString& name, plugin_names.split(";", QString::SkipEmptyParts))
 	{
-		QString plugin_file_path = available_plugins_[plugin_name];
+		QStringList visiting;
+		if (!sort_plugin_dependencies(name, order, levels, visiting))
+			res = false;
+	}
 
-		std::cout << plugin_file_path.toStdString() << std::endl;
-		QPluginLoader loader(plugin_file_path);
+	if (order.empty())
+		return res;
 
-		// if the loader loads a plugin instance
-		if (QObject* plugin_object = loader.instance())
+	// load the libraries (dlopen is serialized by the dynamic linker anyway)
+	QMap<QString, Plugin*> loaded;
+	int max_level = 0;
+	foreach (const QString& name, order)
+	{
+		Plugin* plugin = instantiate_plugin(name);
+		if (plugin)
 		{
-			Plugin* plugin = qobject_cast<Plugin*>(plugin_object);
-
-			// set the plugin with correct parameters (name, filepath, SCHNApps)
-			plugin->set_name(plugin_name);
-			plugin->set_file_path(plugin_file_path);
-			plugin->set_schnapps(this);
+			loaded.insert(name, plugin);
+			max_level = std::max(max_level, levels[name]);
+		}
+		else
+			res = false;
+	}
 
-			// then we call its enable() methods
-			if (plugin->enable())
+	// prepare the plugins in parallel: plugins of the same level do not depend on each other
+	std::vector<char> prepared(order.size(), 0);
+	{
+		StartupProfiler::Scope profile_prepare("prepare plugins");
+		for (int level = 0; level <= max_level; ++level)
+		{
+			std::vector<int> indices;
+			for (int i = 0; i < order.size(); ++i)
 			{
-				// if it succeeded we reference this plugin
-				plugins_.insert(plugin_name, plugin);
-
-				status_bar_message(plugin_name + QString(" successfully loaded."), 2000);
-				emit(plugin_enabled(plugin));
-//				menubar->repaint();
-				return plugin;
+				if (levels[order[i]] == level && loaded.contains(order[i]))
+					indices.push_back(i);
 			}
-			else
+			ThreadPool::instance().parallel_for(0, indices.size(), [&] (std::size_t first, std::size_t last)
 			{
-				delete plugin;
-				return nullptr;
-			}
+				for (std::size_t j = first; j < last; ++j)
+				{
+					Plugin* plugin = loaded.value(order.at(indices[j]));
+					QElapsedTimer timer;
+					timer.start();
+					prepared[indices[j]] = plugin->prepare() ? 1 : 0;
+					StartupProfiler::instance().record("prepare " + plugin->get_name(), timer.nsecsElapsed());
+				}
+			}, 1);
+		}
+	}
+
+	// enable the plugins in dependency order (OpenGL and widgets initialization)
+	for (int i = 0; i < order.size(); ++i)
+	{
+		const QString& name = order[i];
+		if (!loaded.contains(name))
+			continue;
+		Plugin* plugin = loaded[name];
+
+		bool dependencies_enabled = true;
+		foreach (const QString& dependency, plugin_infos_[name].dependencies_)
+			dependencies_enabled &= plugins_.contains(dependency);
+
+		if (!dependencies_enabled || !prepared[i])
+		{
+			std::cerr << "SCHNApps::enable_plugins: unable to enable plugin " << name.toStdString() << std::endl;
+			delete plugin;
+			res = false;
 		}
-		// if loading fails
 		else
+			res &= activate_plugin(plugin);
+	}
+
+	return res;
+}
+
+bool SCHNApps::sort_plugin_dependencies(const QString& plugin_name, QStringList& order, QMap<QString, int>& levels, QStringList& visiting) const
+{
+	if (plugins_.contains(plugin_name) || levels.contains(plugin_name))
+		return true;
+
+	if (!available_plugins_.contains(plugin_name))
+	{
+		std::cerr << "SCHNApps: plugin " << plugin_name.toStdString() << " is not available" << std::endl;
+		return false;
+	}
+
+	if (visiting.contains(plugin_name))
+	{
+		std::cerr << "SCHNApps: dependency cycle on plugin " << plugin_name.toStdString() << std::endl;
+		return false;
+	}
+
+	// the level of a plugin is the length of its longest chain of dependencies to enable
+	visiting.append(plugin_name);
+	int level = 0;
+	foreach (const QString& dependency, plugin_infos_[plugin_name].dependencies_)
+	{
+		if (!sort_plugin_dependencies(dependency, order, levels, visiting))
 		{
-			std::cout << "loader.instance() failed.." << std::endl;
-			return nullptr;
+			visiting.removeOne(plugin_name);
+			return false;
 		}
+		if (levels.contains(dependency))
+			level = std::max(level, levels[dependency] + 1);
+	}
+	visiting.removeOne(plugin_name);
+
+	levels.insert(plugin_name, level);
+	order.append(plugin_name);
+	return true;
+}
+
+Plugin* SCHNApps::instantiate_plugin(const QString& plugin_name)
+{
+	StartupProfiler::Scope profile("load " + plugin_name);
+
+	QString plugin_file_path = available_plugins_[plugin_name];
+
+	QPluginLoader loader(plugin_file_path);
+
+	// if the loader loads a plugin instance
+	if (QObject* plugin_object = loader.instance())
+	{
+		Plugin* plugin = qobject_cast<Plugin*>(plugin_object);
+
+		// set the plugin with correct parameters (name, filepath, SCHNApps)
+		plugin->set_name(plugin_name);
+		plugin->set_file_path(plugin_file_path);
+		plugin->set_schnapps(this);
+
+		return plugin;
 	}
+	// if loading fails
 	else
 	{
+		std::cerr << "SCHNApps: " << loader.errorString().toStdString() << std::endl;
 		return nullptr;
 	}
 }
 
+bool SCHNApps::activate_plugin(Plugin* plugin)
+{
+	StartupProfiler::Scope profile("enable " + plugin->get_name());
+
+	const QString& plugin_name = plugin->get_name();
+
+	// then we call its enable() methods
+	if (plugin->enable())
+	{
+		// if it succeeded we reference this plugin
+		plugins_.insert(plugin_name, plugin);
+
+		// the plugin now provides its own menu actions
+		remove_plugin_placeholder_actions(plugin_name);
+
+		status_bar_message(plugin_name + QString(" successfully loaded."), 2000);
+		emit(plugin_enabled(plugin));
+		return true;
+	}
+	else
+	{
+		delete plugin;
+		return false;
+	}
+}
+
 void SCHNApps::disable_plugin(const QString& plugin_name)
 {
 	if (plugins_.contains(plugin_name))
@@ -244,6 +604,10 @@ void SCHNApps::disable_plugin(const QString& plugin_name)
 		foreach (QAction* action, plugin_menu_actions_[plugin])
 			remove_menu_action(plugin, action);
 
+		// the declared menu entries stay available (they load the plugin again)
+		if (plugin_infos_.contains(plugin_name))
+			add_plugin_placeholder_actions(plugin_infos_[plugin_name]);
+
 		QPluginLoader loader(plugin->get_file_path());
 		loader.unload();
 
@@ -262,8 +626,63 @@ Plugin* SCHNApps::get_plugin(const QString& name) const
 		return nullptr;
 }
 
+const PluginInfo* SCHNApps::get_plugin_info(const QString& name) const
+{
+	auto it = plugin_infos_.find(name);
+	if (it != plugin_infos_.end())
+		return &(*it);
+	return nullptr;
+}
+
+void SCHNApps::add_plugin_placeholder_actions(const PluginInfo& info)
+{
+	foreach (const PluginMenuEntry& entry, info.menu_entries_)
+	{
+		QAction* action = new QAction(this);
+		action->setProperty("schnapps_plugin", info.name_);
+		action->setProperty("schnapps_slot", entry.slot_);
+		connect(action, SIGNAL(triggered()), this, SLOT(placeholder_action_triggered()));
+		add_menu_action(nullptr, entry.menu_path_, action);
+		plugin_placeholder_actions_[info.name_].append(action);
+	}
+}
+
+void SCHNApps::remove_plugin_placeholder_actions(const QString& plugin_name)
+{
+	foreach (QAction* action, plugin_placeholder_actions_[plugin_name])
+		remove_menu_action(nullptr, action);
+	plugin_placeholder_actions_.remove(plugin_name);
+}
+
+void SCHNApps::placeholder_action_triggered()
+{
+	QAction* action = qobject_cast<QAction*>(sender());
+	if (!action)
+		return;
+
+	// the placeholder is deleted when the plugin is loaded: do it after the end of the signal emission
+	QMetaObject::invokeMethod(
+		this, "trigger_plugin_slot", Qt::QueuedConnection,
+		Q_ARG(QString, action->property("schnapps_plugin").toString()),
+		Q_ARG(QString, action->property("schnapps_slot").toString())
+	);
+}
+
+void SCHNApps::trigger_plugin_slot(const QString& plugin_name, const QString& slot_name)
+{
+	Plugin* plugin = enable_plugin(plugin_name);
+	if (!plugin)
+		return;
+
+	if (!QMetaObject::invokeMethod(plugin, slot_name.toUtf8().constData(), Qt::DirectConnection))
+		std::cerr << "SCHNApps: plugin " << plugin_name.toStdString() << " has no slot " << slot_name.toStdString() << "()" << std::endl;
+}
+
 void SCHNApps::add_plugin_dock_tab(Plugin* plugin, QWidget* tab_widget, const QString& tab_text)
 {
+	if (!window_)
+		return;
+
 	if(plugin && tab_widget && !plugin_dock_tabs_[plugin].contains(tab_widget))
 	{
 		int current_tab = window_->plugin_dock_tab_widget_->currentIndex();
@@ -298,7 +717,7 @@ void SCHNApps::remove_plugin_dock_tab(Plugin* plugin, QWidget *tab_widget)
 
 void SCHNApps::enable_plugin_tab_widgets(PluginInteraction* plugin)
 {
-	if(plugin_dock_tabs_.contains(plugin))
+	if(window_ && plugin_dock_tabs_.contains(plugin))
 	{
 		foreach (QWidget* w, plugin_dock_tabs_[plugin])
 			window_->plugin_dock_tab_widget_->setTabEnabled(window_->plugin_dock_tab_widget_->indexOf(w), true);
@@ -307,7 +726,7 @@ void SCHNApps::enable_plugin_tab_widgets(PluginInteraction* plugin)
 
 void SCHNApps::disable_plugin_tab_widgets(PluginInteraction* plugin)
 {
-	if(plugin_dock_tabs_.contains(plugin))
+	if(window_ && plugin_dock_tabs_.contains(plugin))
 	{
 		foreach (QWidget* w, plugin_dock_tabs_[plugin])
 			window_->plugin_dock_tab_widget_->setTabEnabled(window_->plugin_dock_tab_widget_->indexOf(w), false);
@@ -320,16 +739,7 @@ void SCHNApps::disable_plugin_tab_widgets(PluginInteraction* plugin)
 
 MapHandlerGen* SCHNApps::add_map(const QString &name, unsigned int dimension)
 {
-	QString final_name = name;
-	if (maps_.contains(name))
-	{
-		int i = 1;
-		do
-		{
-			final_name = name + QString("_") + QString::number(i);
-			++i;
-		} while (maps_.contains(final_name));
-	}
+	const QString final_name = get_unique_map_name(name);
 
 	MapHandlerGen* mh = nullptr;
 	switch(dimension)
@@ -346,12 +756,53 @@ MapHandlerGen* SCHNApps::add_map(const QString &name, unsigned int dimension)
 		}
 	}
 
+	if (undo_memory_limit_mb_ > 0u)
+		mh->set_undo_memory_limit(undo_memory_limit_mb_);
+
+	maps_.insert(final_name, mh);
+	emit(map_added(mh));
+
+	return mh;
+}
+
+MapHandlerGen* SCHNApps::duplicate_map(const QString& name, bool properties)
+{
+	MapHandler<CMap2>* source = dynamic_cast<MapHandler<CMap2>*>(get_map(name));
+	if (!source)
+	{
+		std::cerr << "SCHNApps::duplicate_map: " << name.toStdString() << " is not a surface map" << std::endl;
+		return nullptr;
+	}
+
+	const QString final_name = get_unique_map_name(name + QString("_copy"));
+
+	MapHandler<CMap2>* mh = new MapHandler<CMap2>(final_name, this, nullptr);
+	mh->share_map_data(source, properties);
+
+	if (undo_memory_limit_mb_ > 0u)
+		mh->set_undo_memory_limit(undo_memory_limit_mb_);
+
 	maps_.insert(final_name, mh);
 	emit(map_added(mh));
 
 	return mh;
 }
 
+QString SCHNApps::get_unique_map_name(const QString& name) const
+{
+	QString final_name = name;
+	if (maps_.contains(name))
+	{
+		int i = 1;
+		do
+		{
+			final_name = name + QString("_") + QString::number(i);
+			++i;
+		} while (maps_.contains(final_name));
+	}
+	return final_name;
+}
+
 void SCHNApps::remove_map(const QString &name)
 {
 	if (maps_.contains(name))
@@ -363,6 +814,16 @@ void SCHNApps::remove_map(const QString &name)
 		maps_.remove(name);
 		emit(map_removed(map));
 
+		// the tasks using the map end before it is deleted (a task not started yet is skipped)
+		foreach (Job* job, jobs_)
+		{
+			if (job->get_map() == map)
+			{
+				job->cancel();
+				job->wait();
+			}
+		}
+
 		delete map;
 	}
 }
@@ -377,12 +838,106 @@ MapHandlerGen* SCHNApps::get_map(const QString& name) const
 
 MapHandlerGen* SCHNApps::get_selected_map() const
 {
-	return control_map_tab_->get_selected_map();
+	if (control_map_tab_)
+		return control_map_tab_->get_selected_map();
+	else
+		return nullptr;
 }
 
 void SCHNApps::set_selected_map(const QString& name)
 {
-	control_map_tab_->set_selected_map(name);
+	if (control_map_tab_)
+		control_map_tab_->set_selected_map(name);
+}
+
+QString SCHNApps::get_memory_summary() const
+{
+	QString res;
+	uint64 used = 0u;
+	uint64 allocated = 0u;
+	uint64 gpu = 0u;
+	QSet<const MapBaseData*> counted_maps;
+
+	foreach (MapHandlerGen* mhg, maps_)
+	{
+		MapMemoryReport report;
+		if (!mhg->get_memory_report(report))
+		{
+			res += QString("%1: being modified\n").arg(mhg->get_name());
+			continue;
+		}
+		// the data of copy-on-write duplicates are only counted once
+		const bool shared = mhg->is_shared();
+		res += QString("%1: %2 used, %3 allocated (%4 wasted), %5 on GPU%6%7\n")
+			.arg(mhg->get_name())
+			.arg(format_bytes(report.used())).arg(format_bytes(report.allocated()))
+			.arg(format_bytes(report.wasted())).arg(format_bytes(report.gpu()))
+			.arg(report.needs_compaction() ? " [compaction advised]" : "")
+			.arg(shared ? " [shared]" : "");
+		if (!shared || !counted_maps.contains(mhg->get_map()))
+		{
+			used += report.used();
+			allocated += report.allocated();
+			counted_maps.insert(mhg->get_map());
+		}
+		gpu += report.gpu();
+	}
+
+	res += QString("total: %1 used, %2 allocated (%3 wasted), %4 on GPU\n")
+		.arg(format_bytes(used)).arg(format_bytes(allocated))
+		.arg(format_bytes(allocated - used)).arg(format_bytes(gpu));
+
+	return res;
+}
+
+void SCHNApps::set_memory_monitor(bool enabled, double min_free_ratio, unsigned int cold_delay_s)
+{
+	memory_min_free_ratio_ = min_free_ratio;
+	memory_cold_delay_s_ = cold_delay_s;
+
+	if (!enabled)
+	{
+		delete memory_monitor_;
+		memory_monitor_ = nullptr;
+		return;
+	}
+
+	if (!memory_monitor_)
+	{
+		memory_monitor_ = new QTimer(this);
+		connect(memory_monitor_, SIGNAL(timeout()), this, SLOT(check_memory_pressure()));
+		memory_monitor_->start(5000);
+	}
+}
+
+void SCHNApps::check_memory_pressure()
+{
+	// free and total physical memory
+	double free_memory = 0.0;
+	double total_memory = 0.0;
+#ifdef _WIN32
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (GlobalMemoryStatusEx(&status))
+	{
+		free_memory = double(status.ullAvailPhys);
+		total_memory = double(status.ullTotalPhys);
+	}
+#elif defined(_SC_AVPHYS_PAGES) && defined(_SC_PHYS_PAGES)
+	const long page_size = sysconf(_SC_PAGESIZE);
+	free_memory = double(sysconf(_SC_AVPHYS_PAGES)) * page_size;
+	total_memory = double(sysconf(_SC_PHYS_PAGES)) * page_size;
+#endif
+
+	if (total_memory <= 0.0 || free_memory / total_memory >= memory_min_free_ratio_)
+		return;
+
+	unsigned int nb_compressed = 0u;
+	foreach (MapHandlerGen* mhg, maps_)
+		nb_compressed += mhg->compress_cold_attributes(memory_cold_delay_s_ * 1000u);
+
+	if (nb_compressed > 0u)
+		status_bar_message(QString("low memory: %1 cold attribute(s) compressed").arg(nb_compressed), 2000);
 }
 
 /*********************************************************
@@ -397,6 +952,14 @@ View* SCHNApps::add_view(const QString& name)
 	View* view = new View(name, this);
 	views_.insert(name, view);
 	emit(view_added(view));
+
+	// without window, the first view is selected as soon as it is created
+	if (!window_ && !selected_view_)
+	{
+		first_view_ = view;
+		set_selected_view(view);
+	}
+
 	return view;
 }
 
@@ -446,7 +1009,10 @@ View* SCHNApps::get_view(const QString& name) const
 
 void SCHNApps::set_selected_view(View* view)
 {
-	int current_tab = window_->plugin_dock_tab_widget_->currentIndex();
+	if (!view)
+		return;
+
+	int current_tab = window_ ? window_->plugin_dock_tab_widget_->currentIndex() : -1;
 
 	if(selected_view_)
 	{
@@ -466,7 +1032,8 @@ void SCHNApps::set_selected_view(View* view)
 	connect(selected_view_, SIGNAL(plugin_linked(PluginInteraction*)), this, SLOT(enable_plugin_tab_widgets(PluginInteraction*)));
 	connect(selected_view_, SIGNAL(plugin_unlinked(PluginInteraction*)), this, SLOT(disable_plugin_tab_widgets(PluginInteraction*)));
 
-	window_->plugin_dock_tab_widget_->setCurrentIndex(current_tab);
+	if (window_)
+		window_->plugin_dock_tab_widget_->setCurrentIndex(current_tab);
 
 	emit(selected_view_changed(old_selected, selected_view_));
 
@@ -483,6 +1050,9 @@ void SCHNApps::set_selected_view(const QString& name)
 
 View* SCHNApps::split_view(const QString& name, Qt::Orientation orientation)
 {
+	if (!window_ || !views_.contains(name))
+		return nullptr;
+
 	View* new_view = add_view();
 
 	View* view = views_[name];
@@ -527,6 +1097,9 @@ View* SCHNApps::split_view(const QString& name, Qt::Orientation orientation)
 
 QString SCHNApps::get_split_view_positions()
 {
+	if (!window_)
+		return QString();
+
 	QList<QSplitter*> liste;
 	liste.push_back(root_splitter_);
 
@@ -553,6 +1126,9 @@ QString SCHNApps::get_split_view_positions()
 
 void SCHNApps::set_split_view_positions(QString positions)
 {
+	if (!window_)
+		return;
+
 	QList<QSplitter*> liste;
 	liste.push_back(root_splitter_);
 
@@ -587,6 +1163,43 @@ void SCHNApps::set_split_view_positions(QString positions)
 	}
 }
 
+bool SCHNApps::render_camera_paths(const QString& directory, const QString& view_names, int nb_frames, int width, int height)
+{
+	if (nb_frames <= 0 || width <= 0 || height <= 0 || !QDir().mkpath(directory))
+		return false;
+
+	QList<View*> views;
+	if (view_names.isEmpty())
+		views = views_.values();
+	else
+	{
+		foreach (const QString& name, view_names.split(";", QString::SkipEmptyParts))
+		{
+			View* view = get_view(name);
+			if (!view)
+			{
+				std::cerr << "SCHNApps::render_camera_paths: view \"" << name.toStdString() << "\" not found" << std::endl;
+				return false;
+			}
+			views.append(view);
+		}
+	}
+
+	// one recorder per view: the OpenGL objects of a recorder belong to the context of its view
+	// and the recorders are kept alive until the end so that encoding overlaps the rendering of the next views
+	std::vector<std::unique_ptr<FrameRecorder>> recorders;
+	bool res = true;
+	foreach (View* view, views)
+	{
+		recorders.emplace_back(new FrameRecorder());
+		res &= view->render_camera_path(*recorders.back(), (unsigned int)(nb_frames), width, height, QDir(directory).filePath(view->get_name()));
+	}
+	recorders.clear(); // waits for the images being encoded
+
+	status_bar_message(QString("Camera paths of %1 view(s) rendered in %2").arg(views.size()).arg(directory), 2000);
+	return res;
+}
+
 /*********************************************************
  * MANAGE MENU ACTIONS
  *********************************************************/
@@ -595,6 +1208,13 @@ void SCHNApps::add_menu_action(Plugin* plugin, const QString& menu_path, QAction
 {
 	if(action && !menu_path.isEmpty() && !plugin_menu_actions_[plugin].contains(action))
 	{
+		// without window, actions are only referenced (they can still be triggered from a script)
+		if (!window_)
+		{
+			plugin_menu_actions_[plugin].append(action);
+			return;
+		}
+
 		// extracting all the substring separated by ';'
 		QStringList step_names = menu_path.split(";");
 		step_names.removeAll("");
@@ -689,28 +1309,82 @@ void SCHNApps::remove_menu_action(Plugin* plugin, QAction* action)
 	}
 }
 
+/*********************************************************
+ * MANAGE JOBS
+ *********************************************************/
+
+Job* SCHNApps::submit_job(const QString& name, const Job::Task& task, const Job::Continuation& continuation, MapHandlerGen* map)
+{
+	Job* job = new Job(name, task, continuation, map);
+	jobs_.append(job);
+	connect(job, SIGNAL(progress_changed(double)), this, SLOT(job_progress_changed(double)));
+	connect(job, SIGNAL(finished(Job*)), this, SLOT(job_finished(Job*)));
+	emit(job_submitted(job));
+	job->start(ThreadPool::instance());
+	return job;
+}
+
+void SCHNApps::cancel_jobs()
+{
+	foreach (Job* job, jobs_)
+		job->cancel();
+}
+
+void SCHNApps::wait_for_jobs()
+{
+	// the continuations and the publications of the maps are queued events
+	while (!jobs_.isEmpty())
+		QCoreApplication::processEvents(QEventLoop::AllEvents | QEventLoop::WaitForMoreEvents, 50);
+	QCoreApplication::processEvents();
+}
+
+void SCHNApps::job_progress_changed(double progress)
+{
+	// without window, only the end of the jobs is reported
+	Job* job = qobject_cast<Job*>(sender());
+	if (window_ && job && jobs_.contains(job))
+		status_bar_message(QString("%1: %2%").arg(job->get_name()).arg(int(progress * 100.0)), 0);
+}
+
+void SCHNApps::job_finished(Job* job)
+{
+	jobs_.removeOne(job);
+	if (job->is_canceled())
+		status_bar_message(QString("%1 canceled").arg(job->get_name()), 2000);
+	else
+		status_bar_message(QString("%1 done in %2 ms").arg(job->get_name()).arg(job->get_elapsed()), 2000);
+}
+
 /*********************************************************
  * MANAGE WINDOW
  *********************************************************/
 
 void SCHNApps::close_window()
 {
-	window_->close();
+	if (window_)
+		window_->close();
+	else
+		emit(schnapps_closing());
 }
 
 void SCHNApps::schnapps_window_closing()
 {
+	cancel_jobs();
 	emit(schnapps_closing());
 }
 
 void SCHNApps::status_bar_message(const QString& msg, int msec)
 {
-	window_->statusbar->showMessage(msg, msec);
+	if (window_)
+		window_->statusbar->showMessage(msg, msec);
+	else
+		std::cerr << msg.toStdString() << std::endl;
 }
 
 void SCHNApps::set_window_size(int w, int h)
 {
-	window_->resize(w, h);
+	if (window_)
+		window_->resize(w, h);
 }
 
 } // namespace schnapps
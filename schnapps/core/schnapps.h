@@ -25,6 +25,8 @@
 #define SCHNAPPS_CORE_SCHNAPPS_H_
 
 #include <schnapps/core/dll.h>
+#include <schnapps/core/plugin_manifest.h>
+#include <schnapps/core/job.h>
 
 #include <QObject>
 #include <QMap>
@@ -32,6 +34,9 @@
 
 class QSplitter;
 class QAction;
+class QTimer;
+class QOpenGLContext;
+class QOffscreenSurface;
 
 namespace schnapps
 {
@@ -57,6 +62,11 @@ class SCHNAPPS_CORE_API SCHNApps : public QObject
 
 public:
 
+	/**
+	 * @brief SCHNApps constructor
+	 * @param app_path path of the application
+	 * @param window the main window, or nullptr to run headless (no widget is created)
+	 */
 	SCHNApps(const QString& app_path, SCHNAppsWindow* window);
 	~SCHNApps();
 
@@ -68,6 +78,38 @@ public slots:
 	 */
 	inline const QString& get_app_path() { return app_path_; }
 
+	/**
+	 * @brief test if SCHNApps runs without window
+	 * @return headless / with window
+	 */
+	inline bool is_headless() const { return window_ == nullptr; }
+
+	/**
+	 * @brief make the offscreen OpenGL context current (headless mode only)
+	 * @return true if the context is current
+	 */
+	bool make_offscreen_context_current();
+
+	/*********************************************************
+	 * MANAGE SCRIPTS
+	 *********************************************************/
+
+	/**
+	 * @brief execute a command: "<object> <slot> [args...]"
+	 * object is "schnapps" or the name of a plugin, map, view or camera
+	 * arguments containing spaces can be enclosed in double quotes
+	 * @param command the command line
+	 * @return true if the command has been executed
+	 */
+	bool execute_command(const QString& command);
+
+	/**
+	 * @brief execute a script file (one command per line, lines starting with # are ignored)
+	 * @param filename path of the script file
+	 * @return true if all the commands have been executed
+	 */
+	bool execute_script(const QString& filename);
+
 	/*********************************************************
 	 * MANAGE CAMERAS
 	 *********************************************************/
@@ -105,16 +147,27 @@ public slots:
 
 	/**
 	* @brief Add a directory for searching available plugins
+	* The libraries are not loaded: their metadata are read from the plugin manifest
+	* and the menu entries they declare are added, the plugin being loaded when one is triggered.
 	* @param path path to directory
 	*/
 	void register_plugins_directory(const QString& path);
 
 	/**
-	* @brief Load and enable a plugin
+	* @brief Load and enable a plugin (and the plugins it depends on)
 	* @param plugin_name plugin name
 	*/
 	Plugin* enable_plugin(const QString& plugin_name);
 
+	/**
+	* @brief Load and enable a set of plugins (and the plugins they depend on)
+	* The libraries are loaded and the plugins enabled in dependency order on the GUI thread,
+	* while the non-OpenGL preparation (Plugin::prepare) of independent plugins runs in parallel on the ThreadPool.
+	* @param plugin_names names of the plugins separated by ';'
+	* @return true if all the plugins have been enabled
+	*/
+	bool enable_plugins(const QString& plugin_names);
+
 	/**
 	* @brief Disable and unload a plugin
 	* @param plugin_name plugin name
@@ -133,6 +186,13 @@ public slots:
 	// get a set of available plugins
 	inline const QMap<QString, QString>& get_available_plugins() const { return available_plugins_; }
 
+	/**
+	* @brief Get the description of an available plugin (loaded or not)
+	* @param name name of plugin
+	* @return nullptr if the plugin is not available
+	*/
+	const PluginInfo* get_plugin_info(const QString& name) const;
+
 public:
 
 	void add_plugin_dock_tab(Plugin* plugin, QWidget* tab_widget, const QString& tab_text);
@@ -141,8 +201,21 @@ private:
 
 	void remove_plugin_dock_tab(Plugin* plugin, QWidget* tab_widget);
 
+	QObject* get_script_object(const QString& name);
+	bool invoke_slot(QObject* object, const QString& slot_name, const QStringList& args);
+
+	bool sort_plugin_dependencies(const QString& plugin_name, QStringList& order, QMap<QString, int>& levels, QStringList& visiting) const;
+	Plugin* instantiate_plugin(const QString& plugin_name);
+	bool activate_plugin(Plugin* plugin);
+
+	void add_plugin_placeholder_actions(const PluginInfo& info);
+	void remove_plugin_placeholder_actions(const QString& plugin_name);
+
 private slots:
 
+	void placeholder_action_triggered();
+	void trigger_plugin_slot(const QString& plugin_name, const QString& slot_name);
+
 	void enable_plugin_tab_widgets(PluginInteraction* plugin);
 
 	void disable_plugin_tab_widgets(PluginInteraction* plugin);
@@ -168,10 +241,12 @@ public slots:
 
 	/**
 	* @brief Duplicate (copy) a map
+	* The duplicate shares the data of the map until one of them is modified (see MapHandlerGen::share_map_data).
+	* Only surface maps can be duplicated.
 	* @param name of map to copy
 	* @param properties copy BB & VBO
 	*/
-//	MapHandlerGen* duplicate_map(const QString& name, bool properties);
+	MapHandlerGen* duplicate_map(const QString& name, bool properties);
 
 	/**
 	* @brief Get a map object from its name
@@ -197,6 +272,33 @@ public slots:
 	// notify that current selected map has changed
 	inline void notify_selected_map_changed(MapHandlerGen* old, MapHandlerGen* cur) { emit(selected_map_changed(old, cur)); }
 
+	/**
+	* @brief Get a summary of the memory used by all the maps
+	* One line per map (CPU used / allocated / wasted, GPU), maps worth compacting are flagged.
+	*/
+	QString get_memory_summary() const;
+
+	/**
+	* @brief Enable the memory pressure monitor
+	* When the free physical memory falls below a ratio of the total memory, the compressible attributes
+	* of the maps (see MapHandlerGen::set_attribute_compressible) that have not been accessed for a while are compressed.
+	* @param enabled enable or disable the monitor
+	* @param min_free_ratio ratio of free physical memory under which cold attributes are compressed
+	* @param cold_delay_s duration without access (in seconds) after which an attribute is cold
+	*/
+	void set_memory_monitor(bool enabled, double min_free_ratio = 0.1, unsigned int cold_delay_s = 300u);
+
+private slots:
+
+	void check_memory_pressure();
+
+private:
+
+	// get a name not used by any map (suffixed by _1, _2... if needed)
+	QString get_unique_map_name(const QString& name) const;
+
+public slots:
+
 //	/**
 //	* @brief Get the current selected tab orbit in control dock map tab interface
 //	* @return 0:Dart / 1:Vertex / 2:Edge / 3:Face / 4:Volume
@@ -286,6 +388,18 @@ public slots:
 	*/
 	void set_split_view_positions(QString positions);
 
+	/**
+	* @brief render the camera paths of several views offscreen (see View::render_camera_path)
+	* The images of a view are encoded while the next views are rendered.
+	* @param directory directory of the images "<view name>_<frame>.png"
+	* @param view_names names of the views separated by ';' (all views if empty)
+	* @param nb_frames number of frames sampled along each path
+	* @param width width of the images
+	* @param height height of the images
+	* @return true if the paths of all the views have been rendered
+	*/
+	bool render_camera_paths(const QString& directory, const QString& view_names, int nb_frames, int width, int height);
+
 	/*********************************************************
 	 * MANAGE MENU ACTIONS
 	 *********************************************************/
@@ -305,12 +419,52 @@ public slots:
 	 */
 	void remove_menu_action(Plugin* plugin, QAction* action);
 
+	/*********************************************************
+	 * MANAGE JOBS
+	 *********************************************************/
+
+public:
+
+	/**
+	* @brief run a task on the shared work-stealing thread pool
+	* Progress and completion are reported in the status bar.
+	* @param name name of the job
+	* @param task function executed by a worker thread (it can use ThreadPool::instance().parallel_for)
+	* @param continuation function executed by the GUI thread once the task has ended without being canceled
+	* @param map map used by the task: the removal of the map cancels the job and waits for its end
+	* @return the job (valid until its finished signal)
+	*/
+	Job* submit_job(const QString& name, const Job::Task& task, const Job::Continuation& continuation = Job::Continuation(), MapHandlerGen* map = nullptr);
+
+	// get the list of running jobs
+	inline const QList<Job*>& get_jobs() const { return jobs_; }
+
+public slots:
+
+	/**
+	* @brief cancel all the running jobs
+	*/
+	void cancel_jobs();
+
+	/**
+	* @brief block until all the jobs have ended and their continuations have been called
+	* The events are processed while waiting (used when there is no event loop, e.g. headless mode).
+	*/
+	void wait_for_jobs();
+
+private slots:
+
+	void job_progress_changed(double progress);
+	void job_finished(Job* job);
+
 	/*********************************************************
 	 * MANAGE WINDOW
 	 *********************************************************/
 
+public slots:
+
 	/**
-	* @brief Print a message in the status bar
+	* @brief Print a message in the status bar (on the error output without window)
 	* @param msg the message
 	* @param msec number of milli-second that message stay printed
 	*/
@@ -344,6 +498,8 @@ signals:
 	void view_removed(View*);
 	void selected_view_changed(View*, View*);
 
+	void job_submitted(Job*);
+
 	void schnapps_closing();
 
 protected:
@@ -354,17 +510,33 @@ protected:
 
 	QMap<QString, Plugin*> plugins_;
 	QMap<QString, QString> available_plugins_;
+	QMap<QString, PluginInfo> plugin_infos_;
+	PluginManifest* plugin_manifest_;
+	// menu actions declared by the metadata of plugins that are not loaded yet
+	QMap<QString, QList<QAction*>> plugin_placeholder_actions_;
 	QMap<Plugin*, QList<QAction*>> plugin_menu_actions_;
 	QMap<Plugin*, QList<QWidget*>> plugin_dock_tabs_;
 
 	QMap<QString, MapHandlerGen*> maps_;
 
+	QTimer* memory_monitor_;
+	double memory_min_free_ratio_;
+	unsigned int memory_cold_delay_s_;
+	// default undo memory limit of the maps in MB (0: no limit)
+	unsigned int undo_memory_limit_mb_;
+
+	QList<Job*> jobs_;
+
 	QMap<QString, View*> views_;
 	View* first_view_;
 	View* selected_view_;
 
 	SCHNAppsWindow* window_;
 
+	// offscreen rendering context used when running headless
+	QOffscreenSurface* offscreen_surface_;
+	QOpenGLContext* offscreen_context_;
+
 	ControlDock_CameraTab* control_camera_tab_;
 	ControlDock_PluginTab* control_plugin_tab_;
 	ControlDock_MapTab* control_map_tab_;
@@ -101,6 +101,8 @@ public:
 	~SCHNAppsWindow()
 	{}
 
+	inline SCHNApps* get_schnapps() const { return schnapps_; }
+
 private slots:
 
 	void about_SCHNApps()
@@ -0,0 +1,104 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/startup_profiler.h>
+
+#include <iomanip>
+
+namespace schnapps
+{
+
+StartupProfiler& StartupProfiler::instance()
+{
+	static StartupProfiler profiler;
+	return profiler;
+}
+
+StartupProfiler::StartupProfiler() :
+	enabled_(!qEnvironmentVariableIsEmpty("SCHNAPPS_PROFILE_STARTUP"))
+{
+	clock_.start();
+}
+
+void StartupProfiler::begin(const QString& phase)
+{
+	if (!enabled_)
+		return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	Phase p;
+	p.name_ = phase;
+	p.depth_ = (unsigned int)(running_.size());
+	p.start_ = clock_.nsecsElapsed();
+	p.duration_ = -1;
+	running_.push_back(phases_.size());
+	phases_.push_back(p);
+}
+
+void StartupProfiler::end()
+{
+	if (!enabled_)
+		return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (running_.empty())
+		return;
+	Phase& p = phases_[running_.back()];
+	p.duration_ = clock_.nsecsElapsed() - p.start_;
+	running_.pop_back();
+}
+
+void StartupProfiler::record(const QString& phase, qint64 nsecs)
+{
+	if (!enabled_)
+		return;
+	std::lock_guard<std::mutex> lock(mutex_);
+	Phase p;
+	p.name_ = phase;
+	p.depth_ = (unsigned int)(running_.size());
+	p.duration_ = nsecs;
+	p.start_ = clock_.nsecsElapsed() - nsecs;
+	phases_.push_back(p);
+}
+
+double StartupProfiler::elapsed() const
+{
+	return double(clock_.nsecsElapsed()) * 1e-6;
+}
+
+void StartupProfiler::report(std::ostream& out) const
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	out << "SCHNApps startup (ms: duration @ start):" << std::endl;
+	for (const Phase& p : phases_)
+	{
+		out << std::setw(10) << std::fixed << std::setprecision(2);
+		if (p.duration_ >= 0)
+			out << double(p.duration_) * 1e-6;
+		else
+			out << "...";
+		out << " @ " << std::setw(9) << double(p.start_) * 1e-6 << "  ";
+		out << std::string(2 * p.depth_, ' ') << p.name_.toStdString() << std::endl;
+	}
+	out << std::setw(10) << std::fixed << std::setprecision(2) << double(clock_.nsecsElapsed()) * 1e-6 << " total" << std::endl;
+}
+
+} // namespace schnapps
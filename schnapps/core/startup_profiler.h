@@ -0,0 +1,113 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_STARTUP_PROFILER_H_
+#define SCHNAPPS_CORE_STARTUP_PROFILER_H_
+
+#include <schnapps/core/dll.h>
+
+#include <QString>
+#include <QElapsedTimer>
+
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief The StartupProfiler measures the phases of the application startup
+* (Qt initialization, OpenGL context, docks, plugin scans, plugin loading and enabling).
+* Phases are nested: a phase started while another one is running is reported as its child.
+* Nothing is recorded while the profiler is disabled.
+* The report is printed when the profiler is enabled (--profile-startup or SCHNAPPS_PROFILE_STARTUP).
+*/
+class SCHNAPPS_CORE_API StartupProfiler
+{
+public:
+
+	/**
+	 * @brief RAII helper timing the phase of its scope
+	 */
+	class Scope
+	{
+	public:
+		inline Scope(const QString& phase) { StartupProfiler::instance().begin(phase); }
+		inline ~Scope() { StartupProfiler::instance().end(); }
+	};
+
+	static StartupProfiler& instance();
+
+	inline bool is_enabled() const { return enabled_; }
+	inline void set_enabled(bool b) { enabled_ = b; }
+
+	/**
+	 * @brief start a phase, child of the running phase (GUI thread only)
+	 */
+	void begin(const QString& phase);
+
+	/**
+	 * @brief end the last started phase (GUI thread only)
+	 */
+	void end();
+
+	/**
+	 * @brief record a phase measured elsewhere (e.g. by a worker thread) as a child of the running phase
+	 * @param phase name of the phase
+	 * @param nsecs duration in nanoseconds
+	 */
+	void record(const QString& phase, qint64 nsecs);
+
+	/**
+	 * @brief elapsed time since the start of the application in milliseconds
+	 */
+	double elapsed() const;
+
+	/**
+	 * @brief print the phases (duration and start time) and the total elapsed time
+	 */
+	void report(std::ostream& out) const;
+
+private:
+
+	StartupProfiler();
+
+	struct Phase
+	{
+		QString name_;
+		unsigned int depth_;
+		qint64 start_;
+		qint64 duration_;
+	};
+
+	bool enabled_;
+	QElapsedTimer clock_;
+	std::vector<Phase> phases_;
+	std::vector<std::size_t> running_;
+	mutable std::mutex mutex_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_STARTUP_PROFILER_H_
@@ -0,0 +1,172 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/stored_attribute.h>
+
+#include <QDir>
+
+#include <cstring>
+#include <iostream>
+
+namespace schnapps
+{
+
+/*********************************************************
+ * StoredAttribute
+ *********************************************************/
+
+StoredAttribute::StoredAttribute(const QString& type_name) :
+	type_name_(type_name),
+	nb_chunks_(0),
+	chunk_bytes_(0),
+	nb_lines_(0)
+{}
+
+StoredAttribute::~StoredAttribute()
+{}
+
+bool StoredAttribute::read(ChunkArrayGen* cag) const
+{
+	std::vector<void*> chunks;
+	uint32 chunk_bytes = 0u;
+	const uint32 nb_chunks = cag->get_chunks_pointers(chunks, chunk_bytes);
+	if (chunk_bytes != chunk_bytes_ || nb_chunks < nb_chunks_)
+		return false;
+
+	for (uint32 i = 0u; i < nb_chunks_; ++i)
+		read_chunk(i, static_cast<uint8*>(chunks[i]));
+
+	return true;
+}
+
+/*********************************************************
+ * MappedAttribute
+ *********************************************************/
+
+MappedAttribute::MappedAttribute(const QString& type_name) :
+	StoredAttribute(type_name),
+	file_(QDir::tempPath() + QString("/schnapps_attribute_XXXXXX")),
+	data_(nullptr)
+{}
+
+MappedAttribute::~MappedAttribute()
+{
+	if (data_)
+		file_.unmap(const_cast<uchar*>(data_));
+}
+
+bool MappedAttribute::write(const ChunkArrayGen* cag, uint32 nb_lines)
+{
+	if (data_ || !file_.open())
+		return false;
+
+	std::vector<void*> chunks;
+	nb_chunks_ = cag->get_chunks_pointers(chunks, chunk_bytes_);
+	nb_lines_ = nb_lines;
+
+	for (uint32 i = 0u; i < nb_chunks_; ++i)
+	{
+		if (file_.write(static_cast<const char*>(chunks[i]), chunk_bytes_) != qint64(chunk_bytes_))
+		{
+			std::cerr << "MappedAttribute::write: cannot write " << file_.fileName().toStdString() << std::endl;
+			return false;
+		}
+	}
+	file_.flush();
+
+	if (get_stored_size() > 0u)
+	{
+		data_ = file_.map(0, qint64(get_stored_size()));
+		if (!data_)
+		{
+			std::cerr << "MappedAttribute::write: cannot map " << file_.fileName().toStdString() << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MappedAttribute::read_chunk(uint32 i, uint8* dst) const
+{
+	std::memcpy(dst, get_chunk(i), chunk_bytes_);
+}
+
+/*********************************************************
+ * CompressedAttribute
+ *********************************************************/
+
+CompressedAttribute::CompressedAttribute(const QString& type_name, bool lossy) :
+	StoredAttribute(type_name),
+	lossy_(lossy)
+{}
+
+bool CompressedAttribute::write(const ChunkArrayGen* cag, uint32 nb_lines)
+{
+	std::vector<void*> chunks;
+	nb_chunks_ = cag->get_chunks_pointers(chunks, chunk_bytes_);
+	nb_lines_ = nb_lines;
+
+	chunks_.clear();
+	chunks_.reserve(nb_chunks_);
+	std::vector<float32> narrowed(lossy_ ? chunk_bytes_ / sizeof(float64) : 0u);
+	for (uint32 i = 0u; i < nb_chunks_; ++i)
+	{
+		if (lossy_)
+		{
+			const float64* src = static_cast<const float64*>(chunks[i]);
+			for (std::size_t j = 0u; j < narrowed.size(); ++j)
+				narrowed[j] = float32(src[j]);
+			chunks_.push_back(qCompress(reinterpret_cast<const uchar*>(narrowed.data()), int(narrowed.size() * sizeof(float32))));
+		}
+		else
+			chunks_.push_back(qCompress(static_cast<const uchar*>(chunks[i]), int(chunk_bytes_)));
+	}
+
+	return true;
+}
+
+void CompressedAttribute::read_chunk(uint32 i, uint8* dst) const
+{
+	const QByteArray data = qUncompress(chunks_[i]);
+	if (lossy_)
+	{
+		const float32* src = reinterpret_cast<const float32*>(data.constData());
+		float64* values = reinterpret_cast<float64*>(dst);
+		const std::size_t nb_values = chunk_bytes_ / sizeof(float64);
+		for (std::size_t j = 0u; j < nb_values; ++j)
+			values[j] = float64(src[j]);
+	}
+	else
+		std::memcpy(dst, data.constData(), chunk_bytes_);
+}
+
+uint64 CompressedAttribute::get_stored_size() const
+{
+	uint64 res = 0u;
+	for (const QByteArray& c : chunks_)
+		res += uint64(c.size());
+	return res;
+}
+
+} // namespace schnapps
@@ -0,0 +1,160 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_STORED_ATTRIBUTE_H_
+#define SCHNAPPS_CORE_STORED_ATTRIBUTE_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+
+#include <cgogn/core/cmap/map_base_data.h>
+
+#include <QTemporaryFile>
+#include <QByteArray>
+#include <QString>
+
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Copy of the chunks of an attribute stored out of the map (see MapHandlerGen::evict_attribute
+* and MapHandlerGen::compress_attribute). Only arrays of trivially copyable types can be stored.
+*/
+class SCHNAPPS_CORE_API StoredAttribute
+{
+public:
+
+	using ChunkArrayGen = cgogn::MapBaseData<cgogn::DefaultMapTraits>::ChunkArrayGen;
+
+	/**
+	 * @param type_name name of the type of the attribute
+	 */
+	StoredAttribute(const QString& type_name);
+	virtual ~StoredAttribute();
+
+	StoredAttribute(const StoredAttribute&) = delete;
+	StoredAttribute& operator=(const StoredAttribute&) = delete;
+
+	/**
+	 * @brief store the chunks of an array
+	 * @param cag the array
+	 * @param nb_lines number of lines used in the container of the array
+	 * @return false if the chunks cannot be stored
+	 */
+	virtual bool write(const ChunkArrayGen* cag, uint32 nb_lines) = 0;
+
+	/**
+	 * @brief copy the content of a stored chunk
+	 * @param i index of the chunk
+	 * @param dst destination of get_chunk_bytes() bytes
+	 */
+	virtual void read_chunk(uint32 i, uint8* dst) const = 0;
+
+	/**
+	 * @brief number of bytes used by the storage
+	 */
+	virtual uint64 get_stored_size() const = 0;
+
+	/**
+	 * @brief name of the storage ("mapped", "compressed")
+	 */
+	virtual QString get_storage_name() const = 0;
+
+	/**
+	 * @brief copy the stored chunks in an array of the same type
+	 * @return false if the array has not enough chunks
+	 */
+	bool read(ChunkArrayGen* cag) const;
+
+	inline const QString& get_type_name() const { return type_name_; }
+	inline uint32 get_nb_chunks() const { return nb_chunks_; }
+	inline uint32 get_chunk_bytes() const { return chunk_bytes_; }
+	inline uint32 get_nb_lines() const { return nb_lines_; }
+
+protected:
+
+	QString type_name_;
+	uint32 nb_chunks_;
+	uint32 chunk_bytes_;
+	uint32 nb_lines_;
+};
+
+/**
+* @brief Chunks stored in a memory-mapped temporary file.
+* The file is mapped read-only once written: the OS pages its content in and out on demand.
+* The file is removed when the MappedAttribute is destroyed.
+*/
+class SCHNAPPS_CORE_API MappedAttribute : public StoredAttribute
+{
+public:
+
+	MappedAttribute(const QString& type_name);
+	~MappedAttribute() override;
+
+	bool write(const ChunkArrayGen* cag, uint32 nb_lines) override;
+	void read_chunk(uint32 i, uint8* dst) const override;
+	inline uint64 get_stored_size() const override { return uint64(nb_chunks_) * chunk_bytes_; }
+	inline QString get_storage_name() const override { return QString("mapped"); }
+
+	/**
+	 * @brief get the mapped content of a chunk
+	 */
+	inline const uint8* get_chunk(uint32 i) const { return data_ + uint64(i) * chunk_bytes_; }
+
+private:
+
+	QTemporaryFile file_;
+	const uint8* data_;
+};
+
+/**
+* @brief Chunks compressed in memory (zlib, one block per chunk).
+* With lossy compression, the float64 values of the chunks are stored as float32 before being compressed
+* (attributes of type VEC2/3/4 and SCALAR only).
+*/
+class SCHNAPPS_CORE_API CompressedAttribute : public StoredAttribute
+{
+public:
+
+	/**
+	 * @param type_name name of the type of the attribute
+	 * @param lossy store float64 values as float32
+	 */
+	CompressedAttribute(const QString& type_name, bool lossy);
+
+	bool write(const ChunkArrayGen* cag, uint32 nb_lines) override;
+	void read_chunk(uint32 i, uint8* dst) const override;
+	uint64 get_stored_size() const override;
+	inline QString get_storage_name() const override { return lossy_ ? QString("compressed, float32") : QString("compressed"); }
+
+private:
+
+	bool lossy_;
+	std::vector<QByteArray> chunks_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_STORED_ATTRIBUTE_H_
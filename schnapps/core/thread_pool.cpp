@@ -0,0 +1,211 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/thread_pool.h>
+
+namespace schnapps
+{
+
+namespace
+{
+
+// index of the worker running on the current thread (-1 outside of the workers)
+// only one pool is expected to be used by a given worker thread
+thread_local int current_worker_index = -1;
+thread_local const ThreadPool* current_worker_pool = nullptr;
+
+} // namespace
+
+TaskGroup::TaskGroup(std::size_t begin, std::size_t end, std::size_t grain, const RangeFunction& f) :
+	begin_(begin),
+	end_(end),
+	grain_(grain),
+	nb_ranges_((end - begin + grain - 1) / grain),
+	f_(f),
+	next_(0),
+	nb_done_(0)
+{}
+
+void TaskGroup::run()
+{
+	std::size_t nb = 0;
+	while (true)
+	{
+		const std::size_t i = next_++;
+		if (i >= nb_ranges_)
+			break;
+		const std::size_t first = begin_ + i * grain_;
+		f_(first, std::min(first + grain_, end_));
+		++nb;
+	}
+
+	if (nb > 0)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		nb_done_ += nb;
+		if (nb_done_ == nb_ranges_)
+			done_.notify_all();
+	}
+}
+
+void TaskGroup::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_.wait(lock, [this] () { return nb_done_ == nb_ranges_; });
+}
+
+ThreadPool& ThreadPool::instance()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+ThreadPool::ThreadPool(unsigned int nb_threads) :
+	stop_(false),
+	nb_pending_(0),
+	next_queue_(0)
+{
+	if (nb_threads == 0)
+		nb_threads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < nb_threads; ++i)
+		queues_.emplace_back(new WorkQueue());
+	for (unsigned int i = 0; i < nb_threads; ++i)
+		threads_.emplace_back(&ThreadPool::worker, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread& t : threads_)
+		t.join();
+}
+
+void ThreadPool::submit(const Task& task)
+{
+	unsigned int index;
+	if (current_worker_pool == this)
+		index = (unsigned int)(current_worker_index);
+	else
+		index = next_queue_++ % nb_threads();
+
+	{
+		std::lock_guard<std::mutex> lock(queues_[index]->mutex_);
+		queues_[index]->tasks_.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		++nb_pending_;
+	}
+	wake_.notify_one();
+}
+
+void ThreadPool::submit_job(const Task& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(jobs_mutex_);
+		jobs_.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex_);
+		++nb_pending_;
+	}
+	wake_.notify_one();
+}
+
+bool ThreadPool::pop_task(int index, Task& task)
+{
+	// own queue first (most recent task, still in cache)
+	if (index >= 0)
+	{
+		WorkQueue& q = *queues_[index];
+		std::lock_guard<std::mutex> lock(q.mutex_);
+		if (!q.tasks_.empty())
+		{
+			task = std::move(q.tasks_.back());
+			q.tasks_.pop_back();
+			--nb_pending_;
+			return true;
+		}
+	}
+
+	// steal the oldest task of another queue
+	const unsigned int n = nb_threads();
+	const unsigned int start = index >= 0 ? (unsigned int)(index) + 1 : next_queue_.load();
+	for (unsigned int i = 0; i < n; ++i)
+	{
+		const unsigned int victim = (start + i) % n;
+		if (int(victim) == index)
+			continue;
+		WorkQueue& q = *queues_[victim];
+		std::lock_guard<std::mutex> lock(q.mutex_);
+		if (!q.tasks_.empty())
+		{
+			task = std::move(q.tasks_.front());
+			q.tasks_.pop_front();
+			--nb_pending_;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ThreadPool::pop_job(Task& task)
+{
+	std::lock_guard<std::mutex> lock(jobs_mutex_);
+	if (jobs_.empty())
+		return false;
+	task = std::move(jobs_.front());
+	jobs_.pop_front();
+	--nb_pending_;
+	return true;
+}
+
+void ThreadPool::worker(unsigned int index)
+{
+	current_worker_index = int(index);
+	current_worker_pool = this;
+
+	while (true)
+	{
+		Task task;
+		// the short tasks (sub-ranges awaited by other threads) come before the jobs
+		if (pop_task(int(index), task) || pop_job(task))
+		{
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex_);
+		wake_.wait(lock, [this] () { return stop_.load() || nb_pending_.load() > 0; });
+		if (stop_)
+			return;
+	}
+}
+
+} // namespace schnapps
@@ -0,0 +1,208 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_THREAD_POOL_H_
+#define SCHNAPPS_CORE_THREAD_POOL_H_
+
+#include <schnapps/core/dll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Sub-ranges of a ThreadPool::parallel_for.
+* The threads taking part in the loop (the calling thread and the helper tasks queued in the pool)
+* take the sub-ranges in turn until there is none left: the calling thread only executes the
+* sub-ranges of its own loop, never other tasks, so it can wait while holding locks.
+*/
+class SCHNAPPS_CORE_API TaskGroup
+{
+public:
+
+	using RangeFunction = std::function<void(std::size_t, std::size_t)>;
+
+	TaskGroup(std::size_t begin, std::size_t end, std::size_t grain, const RangeFunction& f);
+
+	inline std::size_t nb_ranges() const { return nb_ranges_; }
+
+	/**
+	 * @brief execute sub-ranges until there is none left
+	 */
+	void run();
+
+	/**
+	 * @brief block until all the sub-ranges have been executed
+	 */
+	void wait();
+
+private:
+
+	std::size_t begin_;
+	std::size_t end_;
+	std::size_t grain_;
+	std::size_t nb_ranges_;
+	RangeFunction f_;
+
+	std::atomic<std::size_t> next_;
+	std::size_t nb_done_;
+	std::mutex mutex_;
+	std::condition_variable done_;
+};
+
+/**
+* @brief Work-stealing thread pool shared by the application (see ThreadPool::instance).
+* Each worker owns a queue: it pops its own tasks in LIFO order and steals the oldest
+* tasks of the other workers when its queue is empty. Tasks submitted from a worker go
+* in its own queue (nested parallelism), tasks submitted from other threads are distributed
+* among the workers.
+* Jobs (long tasks, see SCHNApps::submit_job) are kept in a separate FIFO queue, only popped
+* by idle workers: a thread waiting for a parallel_for never runs a job.
+*/
+class SCHNAPPS_CORE_API ThreadPool
+{
+public:
+
+	using Task = std::function<void()>;
+
+	/**
+	 * @brief the pool shared by the application, one worker per hardware thread
+	 */
+	static ThreadPool& instance();
+
+	/**
+	 * @brief ThreadPool constructor
+	 * @param nb_threads number of workers (number of hardware threads if 0)
+	 */
+	explicit ThreadPool(unsigned int nb_threads = 0);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	inline unsigned int nb_threads() const { return (unsigned int)(queues_.size()); }
+
+	/**
+	 * @brief queue a short task
+	 */
+	void submit(const Task& task);
+
+	/**
+	 * @brief queue a long task in the job queue (executed by an idle worker)
+	 */
+	void submit_job(const Task& task);
+
+	/**
+	 * @brief apply a function on the ranges of [begin, end[ in parallel and wait for the end
+	 * The calling thread (it can be a worker of the pool) executes sub-ranges of this loop,
+	 * then blocks until the sub-ranges taken by the workers are done.
+	 * @param f function called with sub-ranges (first, last)
+	 * @param grain size of the sub-ranges (chosen from the number of workers if 0)
+	 */
+	template <typename FUNC>
+	void parallel_for(std::size_t begin, std::size_t end, const FUNC& f, std::size_t grain = 0)
+	{
+		if (end <= begin)
+			return;
+
+		const std::size_t n = end - begin;
+		if (grain == 0)
+			grain = std::max(std::size_t(1), n / (4 * (std::size_t(nb_threads()) + 1)));
+
+		if (n <= grain)
+		{
+			f(begin, end);
+			return;
+		}
+
+		// the helpers may start after the end of the loop: they find no sub-range left and f is not called
+		std::shared_ptr<TaskGroup> group = std::make_shared<TaskGroup>(
+			begin, end, grain,
+			[&f] (std::size_t first, std::size_t last) { f(first, last); }
+		);
+		const std::size_t nb_helpers = std::min(group->nb_ranges() - 1, std::size_t(nb_threads()));
+		for (std::size_t i = 0; i < nb_helpers; ++i)
+			submit([group] () { group->run(); });
+
+		group->run();
+		group->wait();
+	}
+
+	/**
+	 * @brief reduce the ranges of [begin, end[ in parallel and wait for the end
+	 * @param init neutral element of the reduction
+	 * @param f function called with sub-ranges (first, last), returning their partial result
+	 * @param join function combining two partial results
+	 * @param grain size of the sub-ranges (chosen from the number of workers if 0)
+	 */
+	template <typename T, typename FUNC, typename JOIN>
+	T parallel_reduce(std::size_t begin, std::size_t end, const T& init, const FUNC& f, const JOIN& join, std::size_t grain = 0)
+	{
+		std::mutex mutex;
+		T result = init;
+		parallel_for(begin, end, [&] (std::size_t first, std::size_t last)
+		{
+			const T partial = f(first, last);
+			std::lock_guard<std::mutex> lock(mutex);
+			result = join(result, partial);
+		}, grain);
+		return result;
+	}
+
+private:
+
+	struct WorkQueue
+	{
+		std::mutex mutex_;
+		std::deque<Task> tasks_;
+	};
+
+	void worker(unsigned int index);
+	bool pop_task(int index, Task& task);
+	bool pop_job(Task& task);
+
+	std::vector<std::unique_ptr<WorkQueue>> queues_;
+	std::vector<std::thread> threads_;
+
+	std::mutex jobs_mutex_;
+	std::deque<Task> jobs_;
+
+	std::mutex sleep_mutex_;
+	std::condition_variable wake_;
+	std::atomic<bool> stop_;
+	std::atomic<unsigned int> nb_pending_;
+	std::atomic<unsigned int> next_queue_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_THREAD_POOL_H_
@@ -33,10 +33,19 @@ namespace schnapps
 
 using namespace cgogn::numerics;
 
+// the geometry is stored in float32 when SCHNApps is built with SCHNAPPS_USE_FLOAT32:
+// attributes take half the memory and VBOs are filled without conversion
+#ifdef SCHNAPPS_USE_FLOAT32
+using VEC4 = Eigen::Vector4f;
+using VEC3 = Eigen::Vector3f;
+using VEC2 = Eigen::Vector2f;
+using SCALAR = float32;
+#else
 using VEC4 = Eigen::Vector4d;
 using VEC3 = Eigen::Vector3d;
 using VEC2 = Eigen::Vector2d;
 using SCALAR = float64;
+#endif
 
 } // namespace schnapps
 
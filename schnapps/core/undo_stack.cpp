@@ -0,0 +1,281 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <schnapps/core/undo_stack.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+namespace schnapps
+{
+
+UndoStack::UndoStack() :
+	current_(0u),
+	recording_(false),
+	memory_limit_(0u),
+	memory_usage_(0u)
+{}
+
+uint64 UndoStack::Operation::bytes() const
+{
+	uint64 res = 0u;
+	for (const Chunk& c : chunks_)
+		res += c.data_.size();
+	return res;
+}
+
+void UndoStack::begin(const QString& name)
+{
+	recorded_ = Operation();
+	recorded_.name_ = name;
+	recorded_arrays_.clear();
+	recording_ = true;
+}
+
+bool UndoStack::record(MapAccess& map, int32 container, const std::string& name)
+{
+	if (!recording_)
+		return false;
+
+	const ArrayId id(container, name);
+	for (const RecordedArray& a : recorded_arrays_)
+	{
+		if (a.array_ == id)
+			return true;
+	}
+
+	if (!map.get_chunk_array(container, name))
+		return false;
+
+	// the chunks are saved on first write
+	recorded_arrays_.push_back(RecordedArray{ id, std::vector<bool>() });
+
+	auto it = std::find_if(recorded_.nb_lines_.begin(), recorded_.nb_lines_.end(), [&] (const std::pair<int32, uint32>& p) { return p.first == container; });
+	if (it == recorded_.nb_lines_.end())
+		recorded_.nb_lines_.push_back(std::make_pair(container, map.get_nb_lines(container)));
+
+	return true;
+}
+
+bool UndoStack::save(MapAccess& map, int32 container, const std::string& name, uint32 first_line, uint32 last_line)
+{
+	if (!recording_ || first_line >= last_line)
+		return recording_;
+
+	std::lock_guard<std::mutex> lock(record_mutex_);
+
+	const ArrayId id(container, name);
+	auto it = std::find_if(recorded_arrays_.begin(), recorded_arrays_.end(), [&] (const RecordedArray& a) { return a.array_ == id; });
+	if (it == recorded_arrays_.end())
+		return false;
+
+	ChunkArrayGen* cag = map.get_chunk_array(container, name);
+	if (!cag)
+		return false;
+
+	std::vector<void*> chunks;
+	uint32 block_size = 0u;
+	const uint32 nb_chunks = cag->get_chunks_pointers(chunks, block_size);
+	if (it->saved_.size() < nb_chunks)
+		it->saved_.resize(nb_chunks, false);
+
+	const uint32 first_chunk = first_line / cgogn::DefaultMapTraits::CHUNK_SIZE;
+	const uint32 last_chunk = std::min(nb_chunks, (last_line - 1u) / cgogn::DefaultMapTraits::CHUNK_SIZE + 1u);
+	for (uint32 i = first_chunk; i < last_chunk; ++i)
+	{
+		if (it->saved_[i])
+			continue;
+		it->saved_[i] = true;
+		const uint8* data = static_cast<const uint8*>(chunks[i]);
+		recorded_.chunks_.push_back(Chunk{ id, i, std::vector<uint8>(data, data + block_size) });
+	}
+
+	return true;
+}
+
+void UndoStack::abort()
+{
+	recording_ = false;
+	recorded_ = Operation();
+	recorded_arrays_.clear();
+}
+
+bool UndoStack::end(MapAccess& map)
+{
+	if (!recording_)
+		return false;
+	recording_ = false;
+
+	Operation op;
+	std::swap(op, recorded_);
+	recorded_arrays_.clear();
+
+	for (const auto& p : op.nb_lines_)
+	{
+		if (map.get_nb_lines(p.first) != p.second)
+		{
+			std::cerr << "UndoStack: operation " << op.name_.toStdString() << " added or removed cells, the undo stack is cleared" << std::endl;
+			clear();
+			return false;
+		}
+	}
+
+	// keep only the modified chunks
+	std::vector<Chunk> modified;
+	std::vector<void*> chunks;
+	ChunkArrayGen* cag = nullptr;
+	ArrayId current_id(TOPOLOGY - 1, std::string());
+	uint32 nb_chunks = 0u;
+	uint32 block_size = 0u;
+	for (Chunk& c : op.chunks_)
+	{
+		if (c.array_ != current_id)
+		{
+			current_id = c.array_;
+			cag = map.get_chunk_array(c.array_.first, c.array_.second);
+			nb_chunks = cag ? cag->get_chunks_pointers(chunks, block_size) : 0u;
+		}
+		if (c.index_ < nb_chunks && block_size == c.data_.size() &&
+			std::memcmp(chunks[c.index_], c.data_.data(), block_size) != 0)
+			modified.push_back(std::move(c));
+	}
+	op.chunks_.swap(modified);
+	op.nb_lines_.clear();
+
+	if (op.chunks_.empty())
+		return true;
+
+	// the redo part is discarded
+	while (operations_.size() > current_)
+	{
+		memory_usage_ -= operations_.back().bytes();
+		operations_.pop_back();
+	}
+
+	memory_usage_ += op.bytes();
+	operations_.push_back(std::move(op));
+	++current_;
+
+	enforce_memory_limit();
+
+	return true;
+}
+
+bool UndoStack::undo(MapAccess& map, std::vector<ArrayId>& modified)
+{
+	if (recording_ || !can_undo())
+		return false;
+	if (!swap_chunks(map, operations_[current_ - 1u], modified))
+		return false;
+	--current_;
+	return true;
+}
+
+bool UndoStack::redo(MapAccess& map, std::vector<ArrayId>& modified)
+{
+	if (recording_ || !can_redo())
+		return false;
+	if (!swap_chunks(map, operations_[current_], modified))
+		return false;
+	++current_;
+	return true;
+}
+
+bool UndoStack::swap_chunks(MapAccess& map, Operation& op, std::vector<ArrayId>& modified)
+{
+	// check that all the chunks still exist before modifying anything
+	std::vector<void*> chunks;
+	std::vector<uint8*> targets;
+	targets.reserve(op.chunks_.size());
+	for (const Chunk& c : op.chunks_)
+	{
+		ChunkArrayGen* cag = map.get_chunk_array(c.array_.first, c.array_.second);
+		uint32 block_size = 0u;
+		const uint32 nb_chunks = cag ? cag->get_chunks_pointers(chunks, block_size) : 0u;
+		if (c.index_ >= nb_chunks || block_size != c.data_.size())
+		{
+			std::cerr << "UndoStack: attribute " << c.array_.second << " of operation " << op.name_.toStdString() << " has changed, the undo stack is cleared" << std::endl;
+			clear();
+			return false;
+		}
+		targets.push_back(static_cast<uint8*>(chunks[c.index_]));
+	}
+
+	// the saved and current contents are exchanged: the same operation is used to undo and redo
+	for (std::size_t i = 0u; i < op.chunks_.size(); ++i)
+	{
+		Chunk& c = op.chunks_[i];
+		std::swap_ranges(c.data_.begin(), c.data_.end(), targets[i]);
+		if (std::find(modified.begin(), modified.end(), c.array_) == modified.end())
+			modified.push_back(c.array_);
+	}
+
+	return true;
+}
+
+void UndoStack::clear()
+{
+	abort();
+	operations_.clear();
+	current_ = 0u;
+	memory_usage_ = 0u;
+}
+
+QStringList UndoStack::get_names() const
+{
+	QStringList res;
+	for (const Operation& op : operations_)
+		res.append(op.name_);
+	return res;
+}
+
+void UndoStack::set_memory_limit(uint64 bytes)
+{
+	memory_limit_ = bytes;
+	enforce_memory_limit();
+}
+
+void UndoStack::enforce_memory_limit()
+{
+	if (memory_limit_ == 0u)
+		return;
+
+	// the oldest operations are dropped first
+	std::size_t nb_dropped = 0u;
+	while (memory_usage_ > memory_limit_ && nb_dropped < operations_.size())
+	{
+		memory_usage_ -= operations_[nb_dropped].bytes();
+		++nb_dropped;
+	}
+	// operations that can be redone are only valid after the previous ones
+	if (nb_dropped > current_)
+		clear();
+	else if (nb_dropped > 0u)
+	{
+		operations_.erase(operations_.begin(), operations_.begin() + nb_dropped);
+		current_ -= nb_dropped;
+	}
+}
+
+} // namespace schnapps
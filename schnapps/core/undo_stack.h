@@ -0,0 +1,196 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_CORE_UNDO_STACK_H_
+#define SCHNAPPS_CORE_UNDO_STACK_H_
+
+#include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
+
+#include <cgogn/core/cmap/map_base_data.h>
+
+#include <QString>
+#include <QStringList>
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Undo/redo stack of a map storing the chunks modified by each operation.
+* An operation declares the attributes it modifies when it begins, and the chunks of these attributes are saved
+* on first write (see save). When it ends, only the saved chunks that differ from the current ones are kept. Undo and redo swap these chunks with the current ones:
+* the memory used is proportional to what the operations changed, and no algorithm is replayed.
+* Chunks are copied byte per byte: only attributes of trivially copyable types can be recorded, and operations
+* must not add or remove cells. Attributes are identified by a container (orbit or TOPOLOGY) and a name.
+*/
+class SCHNAPPS_CORE_API UndoStack
+{
+public:
+
+	using ChunkArrayGen = cgogn::MapBaseData<cgogn::DefaultMapTraits>::ChunkArrayGen;
+
+	// container identifier of the topology of the darts
+	static const int32 TOPOLOGY = -1;
+
+	/**
+	 * @brief access to the chunk arrays of the map (implemented by the map handler)
+	 */
+	class MapAccess
+	{
+	public:
+		virtual ~MapAccess() {}
+		// get a chunk array that can be copied byte per byte (nullptr otherwise)
+		virtual ChunkArrayGen* get_chunk_array(int32 container, const std::string& name) = 0;
+		// get the number of lines used in a container
+		virtual uint32 get_nb_lines(int32 container) = 0;
+		// get the names of the arrays of a container
+		virtual std::vector<std::string> get_array_names(int32 container) = 0;
+	};
+
+	/**
+	 * @brief identifier of a chunk array (container and name)
+	 */
+	using ArrayId = std::pair<int32, std::string>;
+
+	UndoStack();
+
+	/**
+	 * @brief start recording an operation
+	 * @param name name of the operation
+	 */
+	void begin(const QString& name);
+
+	/**
+	 * @brief declare an array modified by the operation (its chunks are saved by save)
+	 * @return false if the array cannot be recorded
+	 */
+	bool record(MapAccess& map, int32 container, const std::string& name);
+
+	/**
+	 * @brief save the chunks of a recorded array that contain some lines, before their first write
+	 * The chunks already saved by the operation are skipped. Can be called concurrently by the tasks
+	 * of a parallel loop writing disjoint lines.
+	 * @param first_line first line to be written
+	 * @param last_line line after the last line to be written
+	 * @return false if the array is not recorded by the operation
+	 */
+	bool save(MapAccess& map, int32 container, const std::string& name, uint32 first_line, uint32 last_line);
+
+	/**
+	 * @brief end the recording of the operation and keep the modified chunks
+	 * The redo part of the stack is discarded. If cells have been added or removed, the operation cannot be
+	 * undone: the stack is cleared.
+	 * @return false if the operation is not undoable
+	 */
+	bool end(MapAccess& map);
+
+	inline bool is_recording() const { return recording_; }
+
+	/**
+	 * @brief stop the recording of the operation without keeping it
+	 */
+	void abort();
+
+	/**
+	 * @brief undo the last operation
+	 * @param modified filled with the arrays restored
+	 * @return false if there is nothing to undo
+	 */
+	bool undo(MapAccess& map, std::vector<ArrayId>& modified);
+
+	/**
+	 * @brief redo the last undone operation
+	 * @param modified filled with the arrays restored
+	 * @return false if there is nothing to redo
+	 */
+	bool redo(MapAccess& map, std::vector<ArrayId>& modified);
+
+	void clear();
+
+	inline bool can_undo() const { return current_ > 0u; }
+	inline bool can_redo() const { return current_ < operations_.size(); }
+
+	/**
+	 * @brief names of the operations (from the oldest), the first get_nb_done() have been done
+	 */
+	QStringList get_names() const;
+	inline std::size_t get_nb_done() const { return current_; }
+
+	/**
+	 * @brief set the maximal memory used by the stored chunks (the oldest operations are dropped)
+	 * @param bytes the limit in bytes (0: no limit)
+	 */
+	void set_memory_limit(uint64 bytes);
+	inline uint64 get_memory_limit() const { return memory_limit_; }
+	inline uint64 get_memory_usage() const { return memory_usage_; }
+
+private:
+
+	struct Chunk
+	{
+		ArrayId array_;
+		uint32 index_;
+		std::vector<uint8> data_;
+	};
+
+	struct Operation
+	{
+		QString name_;
+		std::vector<Chunk> chunks_;
+		// number of lines of the recorded containers
+		std::vector<std::pair<int32, uint32>> nb_lines_;
+		uint64 bytes() const;
+	};
+
+	// array recorded by the current operation and its chunks already saved
+	struct RecordedArray
+	{
+		ArrayId array_;
+		std::vector<bool> saved_;
+	};
+
+	bool swap_chunks(MapAccess& map, Operation& op, std::vector<ArrayId>& modified);
+	void enforce_memory_limit();
+
+	std::vector<Operation> operations_;
+	// number of operations done (the following ones can be redone)
+	std::size_t current_;
+
+	bool recording_;
+	Operation recorded_;
+	std::vector<RecordedArray> recorded_arrays_;
+	// protects recorded_ while chunks are saved by parallel tasks
+	std::mutex record_mutex_;
+
+	uint64 memory_limit_;
+	uint64 memory_usage_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_CORE_UNDO_STACK_H_
@@ -26,6 +26,7 @@
 #include <schnapps/core/camera.h>
 #include <schnapps/core/plugin_interaction.h>
 #include <schnapps/core/map_handler.h>
+#include <schnapps/core/frame_recorder.h>
 
 #include <QMatrix4x4>
 #include <QKeyEvent>
@@ -33,6 +34,13 @@
 #include <QWheelEvent>
 #include <QMessageBox>
 #include <QListWidgetItem>
+#include <QOpenGLFramebufferObject>
+#include <QDir>
+
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
 
 namespace schnapps
 {
@@ -61,6 +69,7 @@ View::View(const QString& name, SCHNApps* s) :
 	frame_drawer_(nullptr),
 	frame_drawer_renderer_(nullptr),
 	save_snapshots_(false),
+	frame_recorder_(nullptr),
 	updating_ui_(false)
 {
 	++view_count_;
@@ -82,10 +91,13 @@ View::View(const QString& name, SCHNApps* s) :
 	foreach (MapHandlerGen* map, schnapps_->get_map_set().values())
 		map_added(map);
 
+	connect(schnapps_, SIGNAL(plugin_available_added(QString)), this, SLOT(plugin_available_added(QString)));
 	connect(schnapps_, SIGNAL(plugin_enabled(Plugin*)), this, SLOT(plugin_enabled(Plugin*)));
 	connect(schnapps_, SIGNAL(plugin_disabled(Plugin*)), this, SLOT(plugin_disabled(Plugin*)));
 	connect(dialog_plugins_->list(), SIGNAL(itemChanged(QListWidgetItem*)), this, SLOT(plugin_check_state_changed(QListWidgetItem*)));
 
+	foreach (const QString& plugin_name, schnapps_->get_available_plugins().keys())
+		plugin_available_added(plugin_name);
 	foreach (Plugin* plugin, schnapps_->get_plugin_set().values())
 		plugin_enabled(plugin);
 
@@ -105,6 +117,9 @@ View::View(const QString& name, SCHNApps* s) :
 
 View::~View()
 {
+	if (frame_recorder_)
+		stop_recording();
+
 	qoglviewer::Camera* c = new qoglviewer::Camera();
 	this->setCamera(c);
 	current_camera_->unlink_view(this);
@@ -208,9 +223,20 @@ void View::link_plugin(PluginInteraction* plugin)
 
 void View::link_plugin(const QString& name)
 {
-	PluginInteraction* p = dynamic_cast<PluginInteraction*>(schnapps_->get_plugin(name));
+	// linking a plugin that is not loaded yet loads it
+	Plugin* plugin = schnapps_->get_plugin(name);
+	if (!plugin)
+		plugin = schnapps_->enable_plugin(name);
+
+	PluginInteraction* p = dynamic_cast<PluginInteraction*>(plugin);
 	if (p)
 		link_plugin(p);
+	else if (dialog_plugins_->find_item(name))
+	{
+		updating_ui_ = true;
+		dialog_plugins_->check(name, Qt::Unchecked);
+		updating_ui_ = false;
+	}
 }
 
 void View::unlink_plugin(PluginInteraction* plugin)
@@ -315,6 +341,175 @@ bool View::is_linked_to_map(const QString& name) const
 	return maps_.contains(m);
 }
 
+/*********************************************************
+ * MANAGE PICKING
+ *********************************************************/
+
+bool View::pick_face(int x, int y, MapHandlerGen*& map, uint32& face_dart, VEC3& point)
+{
+	qoglviewer::Vec origin, direction;
+	current_camera_->convertClickToLine(QPoint(x, y), origin, direction);
+	const QVector3D world_origin(origin.x, origin.y, origin.z);
+	const QVector3D world_direction(direction.x, direction.y, direction.z);
+
+	bool found = false;
+	float nearest = std::numeric_limits<float>::max();
+	foreach (MapHandlerGen* mh, maps_)
+	{
+		const QString position_name = mh->get_bb_vertex_attribute_name();
+		if (position_name.isEmpty() || !mh->ensure_attribute(position_name))
+			continue;
+
+		// the ray in the coordinates of the map
+		const QMatrix4x4 m = mh->get_frame_matrix() * mh->get_transformation_matrix();
+		bool invertible = false;
+		const QMatrix4x4 inv = m.inverted(&invertible);
+		if (!invertible)
+			continue;
+		const QVector3D o = inv.map(world_origin);
+		const QVector3D d = inv.mapVector(world_direction);
+
+		// the BVH is self-contained: the map does not need to be locked
+		std::shared_ptr<const BVH> bvh = mh->get_cached_bvh(position_name);
+		if (!bvh)
+		{
+			mh->prepare_bvh(position_name);
+			schnapps_->status_bar_message(QString("picking structure of %1 is being built").arg(mh->get_name()), 2000);
+			continue;
+		}
+		BVH::RayHit hit;
+		if (!bvh->intersect(VEC3(o.x(), o.y(), o.z()), VEC3(d.x(), d.y(), d.z()), hit))
+			continue;
+
+		// the maps are compared in world coordinates
+		const float distance = (m.map(QVector3D(float(hit.point_[0]), float(hit.point_[1]), float(hit.point_[2]))) - world_origin).length();
+		if (distance < nearest)
+		{
+			nearest = distance;
+			found = true;
+			map = mh;
+			face_dart = bvh->get_face_dart(hit.face_);
+			point = hit.point_;
+		}
+	}
+	return found;
+}
+
+/*********************************************************
+ * MANAGE SNAPSHOTS
+ *********************************************************/
+
+bool View::save_snapshot(const QString& filename, int width, int height)
+{
+	QImage image = render_offscreen(width, height);
+	if (image.isNull())
+		return false;
+	return image.save(filename);
+}
+
+bool View::save_snapshot(const QString& filename)
+{
+	return save_snapshot(filename, 0, 0);
+}
+
+QImage View::render_offscreen(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		width = this->width() * this->pixel_ratio();
+		height = this->height() * this->pixel_ratio();
+	}
+
+	if (!make_render_context_current())
+		return QImage();
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	QOpenGLFramebufferObject fbo(width, height, format);
+	if (!fbo.isValid() || !fbo.bind())
+		return QImage();
+
+	glViewport(0, 0, width, height);
+	glClearColor(0.1f, 0.1f, 0.2f, 0.0f);
+	current_camera_->setScreenWidthAndHeight(width, height);
+
+	draw_scene();
+
+	QImage image = fbo.toImage();
+	fbo.release();
+
+	// restore the state of the onscreen view
+	current_camera_->setScreenWidthAndHeight(this->width(), this->height());
+	glViewport(0, 0, this->width() * this->pixel_ratio(), this->height() * this->pixel_ratio());
+
+	return image;
+}
+
+bool View::render_camera_path(const QString& directory, int nb_frames, int width, int height)
+{
+	if (width <= 0 || height <= 0)
+	{
+		width = this->width() * this->pixel_ratio();
+		height = this->height() * this->pixel_ratio();
+	}
+
+	if (nb_frames <= 0 || !QDir().mkpath(directory))
+		return false;
+
+	FrameRecorder recorder;
+	return render_camera_path(recorder, (unsigned int)(nb_frames), width, height, QDir(directory).filePath(name_));
+}
+
+bool View::render_camera_path(FrameRecorder& recorder, unsigned int nb_frames, int width, int height, const QString& file_prefix)
+{
+	const CameraPath& path = current_camera_->get_path();
+	if (path.nb_keyframes() == 0)
+	{
+		std::cerr << "View::render_camera_path: camera \"" << current_camera_->get_name().toStdString() << "\" has no keyframe" << std::endl;
+		return false;
+	}
+
+	if (!make_render_context_current())
+		return false;
+
+	std::vector<CameraPath::KeyFrame> frames;
+	path.sample(nb_frames, frames);
+
+	const qoglviewer::Vec position = current_camera_->position();
+	const qoglviewer::Quaternion orientation = current_camera_->orientation();
+	current_camera_->setScreenWidthAndHeight(width, height);
+
+	bool res = true;
+	for (std::size_t i = 0; i < frames.size() && res; ++i)
+	{
+		current_camera_->setPosition(frames[i].position_);
+		current_camera_->setOrientation(frames[i].orientation_);
+		res = recorder.begin_frame(width, height);
+		if (res)
+		{
+			draw_scene();
+			recorder.end_frame(QString("%1_%2.png").arg(file_prefix).arg(i, 6, 10, QChar('0')), false);
+		}
+	}
+	recorder.release();
+
+	// restore the state of the onscreen view
+	current_camera_->setPosition(position);
+	current_camera_->setOrientation(orientation);
+	current_camera_->setScreenWidthAndHeight(this->width(), this->height());
+	glViewport(0, 0, this->width() * this->pixel_ratio(), this->height() * this->pixel_ratio());
+
+	return res;
+}
+
+bool View::make_render_context_current()
+{
+	if (schnapps_->is_headless())
+		return schnapps_->make_offscreen_context_current();
+	this->makeCurrent();
+	return true;
+}
+
 
 
 
@@ -383,6 +578,25 @@ void View::preDraw()
 }
 
 void View::draw()
+{
+	if (frame_recorder_)
+	{
+		// the scene is drawn in the offscreen framebuffer of the recorder then copied on screen
+		const int w = this->width() * this->pixel_ratio();
+		const int h = this->height() * this->pixel_ratio();
+		if (frame_recorder_->begin_frame(w, h))
+		{
+			draw_scene();
+			QString filename = QString("%1_%2.png").arg(this->snapshotFileName()).arg(frame_recorder_->nb_frames(), 6, 10, QChar('0'));
+			frame_recorder_->end_frame(filename, true);
+			return;
+		}
+	}
+
+	draw_scene();
+}
+
+void View::draw_scene()
 {
 	glEnable(GL_DEPTH_TEST);
 	glDepthFunc(GL_LESS);
@@ -444,6 +658,25 @@ void View::resizeGL(int width, int height)
 		button_area_left_->set_top_left_position(0, 0);
 }
 
+void View::start_recording()
+{
+	if (!frame_recorder_)
+		frame_recorder_ = new FrameRecorder();
+	this->update();
+}
+
+void View::stop_recording()
+{
+	if (frame_recorder_)
+	{
+		this->makeCurrent();
+		frame_recorder_->release();
+		delete frame_recorder_; // waits for the images being encoded
+		frame_recorder_ = nullptr;
+	}
+	save_snapshots_ = false;
+}
+
 void View::draw_buttons()
 {
 	button_area_->draw();
@@ -479,7 +712,7 @@ void View::keyPressEvent(QKeyEvent* event)
 				if (msg_box.exec() == QMessageBox::Ok)
 				{
 					schnapps_->status_bar_message("frame snapshot !!", 2000);
-					connect(this, SIGNAL(drawFinished(bool)), this, SLOT(saveSnapshot(bool)));
+					start_recording();
 				}
 				else
 				{
@@ -489,7 +722,7 @@ void View::keyPressEvent(QKeyEvent* event)
 			}
 			else
 			{
-				disconnect(this, SIGNAL(drawFinished(bool)), this, SLOT(saveSnapshot(bool)));
+				stop_recording();
 				schnapps_->status_bar_message("Stop frame snapshot", 2000);
 			}
 
@@ -546,7 +779,21 @@ void View::mousePressEvent(QMouseEvent* event)
 			foreach (PluginInteraction* plugin, plugins_)
 				plugin->mousePress(this, event);
 
-			QOGLViewer::mousePressEvent(event);
+			if (event->button() == Qt::LeftButton && event->modifiers() == Qt::ShiftModifier)
+			{
+				MapHandlerGen* map = nullptr;
+				uint32 face_dart = 0u;
+				VEC3 point;
+				if (pick_face(event->x(), event->y(), map, face_dart, point))
+				{
+					schnapps_->status_bar_message(QString("%1: face of dart %2 picked at (%3, %4, %5)")
+						.arg(map->get_name()).arg(face_dart)
+						.arg(double(point[0])).arg(double(point[1])).arg(double(point[2])), 2000);
+					emit(face_picked(map, face_dart, point));
+				}
+			}
+			else
+				QOGLViewer::mousePressEvent(event);
 		}
 	}
 }
@@ -622,16 +869,28 @@ void View::map_check_state_changed(QListWidgetItem* item)
 	}
 }
 
+void View::plugin_available_added(QString name)
+{
+	// interaction plugins declared in their metadata can be linked before being loaded
+	const PluginInfo* info = schnapps_->get_plugin_info(name);
+	if (info && info->interaction_ && !dialog_plugins_->find_item(name))
+		dialog_plugins_->add_item(name);
+}
+
 void View::plugin_enabled(Plugin *plugin)
 {
-	if (dynamic_cast<PluginInteraction*>(plugin))
+	if (dynamic_cast<PluginInteraction*>(plugin) && !dialog_plugins_->find_item(plugin->get_name()))
 		dialog_plugins_->add_item(plugin->get_name());
 }
 
 void View::plugin_disabled(Plugin *plugin)
 {
 	if (dynamic_cast<PluginInteraction*>(plugin))
-		dialog_plugins_->remove_item(plugin->get_name());
+	{
+		const PluginInfo* info = schnapps_->get_plugin_info(plugin->get_name());
+		if (!info || !info->interaction_)
+			dialog_plugins_->remove_item(plugin->get_name());
+	}
 }
 
 void View::plugin_check_state_changed(QListWidgetItem* item)
@@ -25,6 +25,7 @@
 #define SCHNAPPS_CORE_VIEW_H_
 
 #include <schnapps/core/dll.h>
+#include <schnapps/core/types.h>
 
 #include <schnapps/core/view_dialog_list.h>
 #include <schnapps/core/view_button_area.h>
@@ -34,6 +35,8 @@
 #include <QOGLViewer/qoglviewer.h>
 #include <QOGLViewer/manipulatedFrame.h>
 
+#include <QImage>
+
 namespace schnapps
 {
 
@@ -42,6 +45,7 @@ class Camera;
 class Plugin;
 class PluginInteraction;
 class MapHandlerGen;
+class FrameRecorder;
 
 /**
 * @brief View class inherit from QOGLViewer (http://libqglviewer.com/refManual/classQGLViewer.html)
@@ -184,17 +188,93 @@ public slots:
 	*/
 	bool is_linked_to_map(const QString& name) const;
 
+	/*********************************************************
+	 * MANAGE PICKING
+	 *********************************************************/
+
+	/**
+	* @brief cast the ray of a pixel on the faces of the linked maps (shift + left click)
+	* The cached BVH of the bounding box attribute of each map is used (see MapHandlerGen::get_cached_bvh):
+	* nothing is built on the GUI thread. The BVH is refitted in a background job after each modification
+	* of the positions (see MapHandlerGen::prepare_bvh): a map whose BVH is not ready yet is skipped.
+	* @param x x position of the pixel (as in mouse events)
+	* @param y y position of the pixel
+	* @param map the nearest hit map
+	* @param face_dart index of a dart of the hit face of the map
+	* @param point hit point, in the coordinates of the map
+	* @return false if no face is hit
+	*/
+	bool pick_face(int x, int y, MapHandlerGen*& map, uint32& face_dart, VEC3& point);
+
+	/*********************************************************
+	 * MANAGE SNAPSHOTS
+	 *********************************************************/
+
+	/**
+	* @brief render the view in an offscreen framebuffer and save the image
+	* @param filename name of the image file (format deduced from the suffix)
+	* @param width width of the image (size of the view if <= 0)
+	* @param height height of the image (size of the view if <= 0)
+	* @return true if the image has been saved
+	*/
+	bool save_snapshot(const QString& filename, int width, int height);
+
+	/**
+	* @brief render the view in an offscreen framebuffer and save the image (size of the view)
+	* @param filename name of the image file (format deduced from the suffix)
+	*/
+	bool save_snapshot(const QString& filename);
+
+	/**
+	* @brief render the path of the current camera offscreen and save the images "<directory>/<view name>_<frame>.png"
+	* @param directory directory of the images (created if needed)
+	* @param nb_frames number of frames sampled along the path
+	* @param width width of the images (size of the view if <= 0)
+	* @param height height of the images (size of the view if <= 0)
+	* @return true if all the frames have been rendered
+	*/
+	bool render_camera_path(const QString& directory, int nb_frames, int width, int height);
+
+public:
+
+	/**
+	 * @brief render the view in an offscreen framebuffer
+	 * @param width width of the framebuffer
+	 * @param height height of the framebuffer
+	 * @return the rendered image (null image if the rendering failed)
+	 */
+	QImage render_offscreen(int width, int height);
+
+	/**
+	 * @brief render the path of the current camera with the given recorder
+	 * The pose of the camera is restored afterwards. The OpenGL objects of the recorder are released
+	 * but the images may still be encoded when the function returns (see FrameRecorder::wait_for_done).
+	 * @param recorder the frame recorder (must not be used by another OpenGL context)
+	 * @param nb_frames number of frames sampled along the path
+	 * @param width width of the images
+	 * @param height height of the images
+	 * @param file_prefix path prefix of the images ("_<frame>.png" is appended)
+	 * @return true if all the frames have been rendered
+	 */
+	bool render_camera_path(FrameRecorder& recorder, unsigned int nb_frames, int width, int height, const QString& file_prefix);
+
 private:
 
+	bool make_render_context_current();
+
 	virtual void init() override;
 	virtual void preDraw() override;
 	virtual void draw() override;
 	virtual void postDraw() override;
 	virtual void resizeGL(int width, int height) override;
 
+	void draw_scene();
 	void draw_buttons();
 	void draw_frame();
 
+	void start_recording();
+	void stop_recording();
+
 	void keyPressEvent(QKeyEvent* event) override;
 	void keyReleaseEvent(QKeyEvent *event) override;
 	void mousePressEvent(QMouseEvent* event) override;
@@ -237,6 +317,7 @@ private slots:
 	void map_removed(MapHandlerGen* map);
 	void map_check_state_changed(QListWidgetItem* item);
 
+	void plugin_available_added(QString name);
 	void plugin_enabled(Plugin *plugin);
 	void plugin_disabled(Plugin *plugin);
 	void plugin_check_state_changed(QListWidgetItem* item);
@@ -267,6 +348,9 @@ signals:
 
 	void bb_changed();
 
+	// a face has been picked (see pick_face)
+	void face_picked(MapHandlerGen* map, uint32 face_dart, const VEC3& point);
+
 protected:
 
 	QString name_;
@@ -301,6 +385,7 @@ protected:
 	cgogn::rendering::DisplayListDrawer::Renderer* frame_drawer_renderer_;
 
 	bool save_snapshots_;
+	FrameRecorder* frame_recorder_;
 
 	bool updating_ui_;
 };
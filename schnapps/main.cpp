@@ -22,26 +22,151 @@
 *******************************************************************************/
 
 #include <schnapps/core/schnapps_window.h>
+#include <schnapps/core/startup_profiler.h>
 
 #include <QOGLViewer/qoglviewer.h>
 
 #include <QApplication>
 #include <QSplashScreen>
+#include <QTimer>
+
+#include <cstring>
+#include <iostream>
+
+namespace
+{
+
+void print_usage(const char* program)
+{
+	std::cout << "usage: " << program << " [--profile-startup] [--plugins names] [--headless [-c command]... [script_file]...]" << std::endl;
+	std::cout << "  --headless         run without window: execute the commands and scripts then exit" << std::endl;
+	std::cout << "  -c command         execute a single command (\"<object> <slot> [args...]\")" << std::endl;
+	std::cout << "  --plugins names    enable plugins at launch (names separated by ';')" << std::endl;
+	std::cout << "  --profile-startup  print the duration of the startup phases" << std::endl;
+}
+
+// options shared by the windowed and headless modes
+struct Options
+{
+	Options() : headless_(false), profile_startup_(false) {}
+	bool headless_;
+	bool profile_startup_;
+	QString plugins_;
+};
+
+void report_startup()
+{
+	schnapps::StartupProfiler& profiler = schnapps::StartupProfiler::instance();
+	if (profiler.is_enabled())
+		profiler.report(std::cout);
+}
+
+// run SCHNApps without any widget: no window, no splash screen, no event loop
+int run_headless(int argc, char* argv[], const Options& options)
+{
+	schnapps::StartupProfiler& profiler = schnapps::StartupProfiler::instance();
+
+	// the offscreen platform plugin does not need any display
+	if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+		qputenv("QT_QPA_PLATFORM", "offscreen");
+
+	profiler.begin("Qt initialization");
+	QApplication app(argc, argv);
+	profiler.end();
+
+	profiler.begin("init_ogl_context");
+	qoglviewer::init_ogl_context();
+	profiler.end();
+
+	schnapps::SCHNApps schnapps(app.applicationDirPath(), nullptr);
+
+	if (!options.plugins_.isEmpty() && !schnapps.enable_plugins(options.plugins_))
+		return EXIT_FAILURE;
+
+	report_startup();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--headless") == 0 || std::strcmp(argv[i], "--profile-startup") == 0)
+			continue;
+		if (std::strcmp(argv[i], "--plugins") == 0)
+		{
+			++i;
+			continue;
+		}
+
+		bool ok = false;
+		if (std::strcmp(argv[i], "-c") == 0 && i + 1 < argc)
+			ok = schnapps.execute_command(QString::fromLocal8Bit(argv[++i]));
+		else
+			ok = schnapps.execute_script(QString::fromLocal8Bit(argv[i]));
+
+		// there is no event loop: the continuations of the jobs are delivered here
+		schnapps.wait_for_jobs();
+
+		if (!ok)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+} // namespace
 
 int main(int argc, char* argv[])
 {
+	schnapps::StartupProfiler& profiler = schnapps::StartupProfiler::instance();
+
+	Options options;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (std::strcmp(argv[i], "--headless") == 0)
+			options.headless_ = true;
+		else if (std::strcmp(argv[i], "--profile-startup") == 0)
+			options.profile_startup_ = true;
+		else if (std::strcmp(argv[i], "--plugins") == 0 && i + 1 < argc)
+			options.plugins_ = QString::fromLocal8Bit(argv[++i]);
+		else if (std::strcmp(argv[i], "--help") == 0 || std::strcmp(argv[i], "-h") == 0)
+		{
+			print_usage(argv[0]);
+			return EXIT_SUCCESS;
+		}
+	}
+
+	if (options.profile_startup_)
+		profiler.set_enabled(true);
+
+	if (options.headless_)
+		return run_headless(argc, argv, options);
+
+	profiler.begin("Qt initialization");
 	QApplication app(argc, argv);
+	profiler.end();
 
+	profiler.begin("init_ogl_context");
 	qoglviewer::init_ogl_context();
+	profiler.end();
 
+	profiler.begin("splash screen");
 	QSplashScreen splash(QPixmap(":splash/cgogn/splash.png"));
 	splash.show();
 	splash.showMessage("Welcome to SCHNApps", Qt::AlignBottom | Qt::AlignCenter);
+	profiler.end();
 
+	profiler.begin("window");
 	schnapps::SCHNAppsWindow w(app.applicationDirPath());
-	w.show();
+	profiler.end();
+
+	if (!options.plugins_.isEmpty())
+		w.get_schnapps()->enable_plugins(options.plugins_);
 
+	profiler.begin("show window");
+	w.show();
 	splash.finish(&w);
+	profiler.end();
+
+	// the window is usable when the event loop starts processing events
+	QTimer::singleShot(0, &report_startup);
 
 	return app.exec();
 }
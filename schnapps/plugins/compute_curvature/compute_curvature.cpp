@@ -0,0 +1,220 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <compute_curvature.h>
+
+#include <schnapps/core/schnapps.h>
+#include <schnapps/core/map_handler.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <QPointer>
+
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace schnapps
+{
+
+using Vertex = CMap2::Vertex;
+
+namespace
+{
+
+/**
+ * @brief curvature of a vertex from its incident triangles
+ */
+SCALAR vertex_curvature(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Vertex v, Plugin_ComputeCurvature::Curvature curvature)
+{
+	const VEC3& p = position[v];
+	VEC3 laplacian = VEC3::Zero();
+	VEC3 normal = VEC3::Zero();
+	SCALAR area = 0;
+	SCALAR angles = 0;
+	bool boundary = false;
+
+	map.foreach_dart_of_orbit(v, [&] (cgogn::Dart d)
+	{
+		if (map.is_boundary(d))
+		{
+			boundary = true;
+			return;
+		}
+
+		// triangle (p, a, b) of the face of d
+		const VEC3& a = position[Vertex(map.phi1(d))];
+		const VEC3& b = position[Vertex(map.phi_1(d))];
+		const VEC3 pa = a - p;
+		const VEC3 pb = b - p;
+		const VEC3 n = pa.cross(pb);
+		const SCALAR double_area = n.norm();
+		if (double_area <= SCALAR(0))
+			return;
+
+		// cotangents of the angles at a and b
+		const SCALAR cot_a = (p - a).dot(b - a) / double_area;
+		const SCALAR cot_b = (p - b).dot(a - b) / double_area;
+		laplacian += cot_b * pa + cot_a * pb;
+
+		normal += n;
+		area += double_area / SCALAR(6);
+		angles += std::atan2(double_area, pa.dot(pb));
+	});
+
+	if (area <= SCALAR(0))
+		return SCALAR(0);
+
+	// the Laplacian points inwards on convex parts: the mean curvature of a sphere is positive
+	const SCALAR nl = normal.norm();
+	const SCALAR mean = nl > SCALAR(0) ? -laplacian.dot(normal / nl) / (SCALAR(4) * area) : SCALAR(0);
+	const SCALAR gaussian = ((boundary ? SCALAR(M_PI) : SCALAR(2 * M_PI)) - angles) / area;
+
+	switch (curvature)
+	{
+		case Plugin_ComputeCurvature::MEAN: return mean;
+		case Plugin_ComputeCurvature::GAUSSIAN: return gaussian;
+		case Plugin_ComputeCurvature::MAXIMUM: return mean + std::sqrt(std::max(mean * mean - gaussian, SCALAR(0)));
+		case Plugin_ComputeCurvature::MINIMUM: return mean - std::sqrt(std::max(mean * mean - gaussian, SCALAR(0)));
+	}
+	return SCALAR(0);
+}
+
+} // namespace
+
+bool Plugin_ComputeCurvature::enable()
+{
+	compute_curvature_action_ = new QAction("compute mean curvature", this);
+	schnapps_->add_menu_action(this, "Surface;Compute Mean Curvature", compute_curvature_action_);
+	connect(compute_curvature_action_, SIGNAL(triggered()), this, SLOT(compute_mean_curvature_of_selected_map()));
+
+	return true;
+}
+
+bool Plugin_ComputeCurvature::compute_curvature(
+	const QString& map_name,
+	const QString& position_name,
+	const QString& curvature_name,
+	int curvature,
+	bool create_vbo)
+{
+	MapHandler<CMap2>* mh = dynamic_cast<MapHandler<CMap2>*>(schnapps_->get_map(map_name));
+	if (!mh)
+	{
+		std::cerr << "Plugin_ComputeCurvature::compute_curvature: " << map_name.toStdString() << " is not a surface map" << std::endl;
+		return false;
+	}
+	if (curvature < MEAN || curvature > MINIMUM)
+	{
+		std::cerr << "Plugin_ComputeCurvature::compute_curvature: unknown curvature " << curvature << std::endl;
+		return false;
+	}
+
+	// attributes stored out of the map are put back first
+	mh->ensure_attribute(position_name);
+	mh->ensure_attribute(curvature_name);
+
+	QPointer<MapHandlerGen> guard(mh);
+	// 0: not computed, 1: computed, 2: computed in a new attribute
+	std::shared_ptr<int> result = std::make_shared<int>(0);
+
+	submit_job(
+		QString("curvature of %1").arg(map_name),
+		[mh, position_name, curvature_name, curvature, result] (Job& job)
+		{
+			MapHandlerGen::Writer writer(mh);
+			CMap2* map = mh->get_map();
+			const CMap2::VertexAttribute<VEC3> position = map->get_attribute<VEC3, Vertex::ORBIT>(position_name.toStdString());
+			if (!position.is_valid())
+				return;
+
+			std::vector<Vertex> vertices;
+			map->foreach_cell([&] (Vertex v) { vertices.push_back(v); });
+
+			// the values are computed aside: a canceled job leaves the map untouched
+			const CMap2& cmap = *map;
+			std::vector<SCALAR> computed(vertices.size());
+			std::atomic<std::size_t> done(0);
+			ThreadPool::instance().parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+			{
+				if (job.is_canceled())
+					return;
+				for (std::size_t i = first; i < last; ++i)
+					computed[i] = vertex_curvature(cmap, position, vertices[i], Curvature(curvature));
+				job.set_progress(double(done += last - first) / double(vertices.size()));
+			});
+			// once committed, the job cannot be canceled: the continuation announces the attribute
+			if (!job.commit())
+				return;
+
+			CMap2::VertexAttribute<SCALAR> values = map->get_attribute<SCALAR, Vertex::ORBIT>(curvature_name.toStdString());
+			if (!values.is_valid())
+			{
+				values = map->add_attribute<SCALAR, Vertex::ORBIT>(curvature_name.toStdString());
+				*result = 2;
+			}
+			else
+				*result = 1;
+
+			mh->begin_undoable(job.get_name(), QStringList() << curvature_name);
+			// all the values are written
+			mh->undoable_write(curvature_name);
+			ThreadPool::instance().parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+			{
+				for (std::size_t i = first; i < last; ++i)
+					values[vertices[i]] = computed[i];
+			});
+			mh->end_undoable();
+			writer.attribute_changed(curvature_name);
+		},
+		[guard, curvature_name, create_vbo, result] (Job&)
+		{
+			if (!guard)
+				return;
+			if (*result == 0)
+			{
+				std::cerr << "Plugin_ComputeCurvature: map " << guard->get_name().toStdString() << " has no VEC3 position attribute" << std::endl;
+				return;
+			}
+			if (*result == 2)
+				guard->notify_attribute_added(Vertex::ORBIT, curvature_name);
+			if (create_vbo)
+				guard->create_vbo(curvature_name);
+		},
+		mh
+	);
+
+	return true;
+}
+
+void Plugin_ComputeCurvature::compute_mean_curvature_of_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		compute_curvature(map->get_name(), "position", "mean_curvature", MEAN, true);
+}
+
+Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+
+} // namespace schnapps
@@ -0,0 +1,97 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_COMPUTE_CURVATURE_H_
+#define SCHNAPPS_PLUGIN_COMPUTE_CURVATURE_H_
+
+#include <schnapps/core/plugin_processing.h>
+
+#include <QAction>
+
+namespace schnapps
+{
+
+/**
+* @brief Plugin computing discrete curvatures of triangulated surface maps
+* The curvatures are computed in parallel in a background job and stored in a SCALAR vertex attribute,
+* that can be displayed through the colormap of the surface_render plugin.
+* Mean curvature: cotangent Laplacian of the positions, Gaussian curvature: angle defect,
+* both divided by the barycentric area of the vertex. The principal curvatures are derived from them.
+*/
+class Plugin_ComputeCurvature : public PluginProcessing
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "compute_curvature.json")
+	Q_INTERFACES(schnapps::Plugin)
+
+public:
+
+	enum Curvature
+	{
+		MEAN = 0,
+		GAUSSIAN,
+		MAXIMUM,
+		MINIMUM
+	};
+
+	inline Plugin_ComputeCurvature() {}
+
+	~Plugin_ComputeCurvature() {}
+
+private:
+
+	bool enable() override;
+	inline void disable() override {}
+
+public slots:
+
+	/**
+	 * @brief compute a curvature of a surface map in a background job
+	 * @param map_name name of the map
+	 * @param position_name name of the VEC3 position vertex attribute
+	 * @param curvature_name name of the SCALAR curvature vertex attribute (created if needed)
+	 * @param curvature 0: mean / 1: Gaussian / 2: maximum principal / 3: minimum principal
+	 * @param create_vbo create (or refresh) the VBO of the curvature
+	 * @return false if the map is not a surface map
+	 */
+	bool compute_curvature(
+		const QString& map_name,
+		const QString& position_name,
+		const QString& curvature_name,
+		int curvature,
+		bool create_vbo
+	);
+
+	/**
+	 * @brief compute the mean curvature ("mean_curvature") of the selected map from its "position" attribute
+	 */
+	void compute_mean_curvature_of_selected_map();
+
+private:
+
+	QAction* compute_curvature_action_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_COMPUTE_CURVATURE_H_
@@ -0,0 +1,455 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <compute_normal.h>
+
+#include <schnapps/core/schnapps.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <QPointer>
+
+#include <cmath>
+#include <iostream>
+
+namespace schnapps
+{
+
+using Vertex = CMap2::Vertex;
+using Face = CMap2::Face;
+
+namespace
+{
+
+/**
+ * @brief normal of a vertex from its incident faces
+ * AREA: sum of the (Newell) normals of the faces, whose norms are twice their areas
+ * ANGLE: sum of the unit normals of the faces weighted by their angles at the vertex
+ */
+VEC3 vertex_normal(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Vertex v, Plugin_ComputeNormal::Weighting weighting)
+{
+	VEC3 n = VEC3::Zero();
+	const VEC3& p = position[v];
+
+	map.foreach_dart_of_orbit(v, [&] (cgogn::Dart d)
+	{
+		if (map.is_boundary(d))
+			return;
+
+		if (weighting == Plugin_ComputeNormal::AREA)
+		{
+			cgogn::Dart it = d;
+			do
+			{
+				n += position[Vertex(it)].cross(position[Vertex(map.phi1(it))]);
+				it = map.phi1(it);
+			} while (it != d);
+		}
+		else
+		{
+			const VEC3 e1 = position[Vertex(map.phi1(d))] - p;
+			const VEC3 e2 = position[Vertex(map.phi_1(d))] - p;
+			const VEC3 c = e1.cross(e2);
+			const SCALAR l = c.norm();
+			if (l > SCALAR(0))
+				n += (std::atan2(l, e1.dot(e2)) / l) * c;
+		}
+	});
+
+	const SCALAR l = n.norm();
+	if (l > SCALAR(0))
+		n /= l;
+	return n;
+}
+
+} // namespace
+
+bool Plugin_ComputeNormal::enable()
+{
+	compute_normal_action_ = new QAction("compute normals", this);
+	schnapps_->add_menu_action(this, "Surface;Compute Normals", compute_normal_action_);
+	connect(compute_normal_action_, SIGNAL(triggered()), this, SLOT(compute_normal_of_selected_map()));
+
+	connect(schnapps_, SIGNAL(map_removed(MapHandlerGen*)), this, SLOT(map_removed(MapHandlerGen*)));
+
+	return true;
+}
+
+void Plugin_ComputeNormal::disable()
+{
+	disconnect(schnapps_, SIGNAL(map_removed(MapHandlerGen*)), this, SLOT(map_removed(MapHandlerGen*)));
+
+	foreach (MapHandlerGen* map, parameters_.keys())
+	{
+		disconnect(map, SIGNAL(attribute_changed(const QString&)), this, SLOT(attribute_changed(const QString&)));
+		disconnect(map, SIGNAL(connectivity_changed()), this, SLOT(connectivity_changed()));
+	}
+	parameters_.clear();
+}
+
+void Plugin_ComputeNormal::compute(CMap2& map, const NormalParameters& p, const std::vector<Vertex>& vertices, std::vector<VEC3>& normals, Job& job)
+{
+	const CMap2::VertexAttribute<VEC3> position = map.get_attribute<VEC3, Vertex::ORBIT>(p.position_name_.toStdString());
+	normals.resize(vertices.size());
+
+	// each vertex gathers its incident faces: the tasks write disjoint normals
+	ThreadPool::instance().parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+	{
+		if (job.is_canceled())
+			return;
+		for (std::size_t i = first; i < last; ++i)
+			normals[i] = vertex_normal(map, position, vertices[i], p.weighting_);
+	});
+}
+
+void Plugin_ComputeNormal::store(CMap2& map, const NormalParameters& p, const std::vector<Vertex>& vertices, const std::vector<VEC3>& normals)
+{
+	CMap2::VertexAttribute<VEC3> normal = map.get_attribute<VEC3, Vertex::ORBIT>(p.normal_name_.toStdString());
+
+	ThreadPool::instance().parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+			normal[vertices[i]] = normals[i];
+	});
+}
+
+bool Plugin_ComputeNormal::compute_all(CMap2& map, NormalParameters& p, Job& job)
+{
+	std::vector<VEC3> normals;
+	compute(map, p, p.vertices_, normals, job);
+	if (!job.commit())
+		return false;
+	store(map, p, p.vertices_, normals);
+	save_positions(map, p);
+	return true;
+}
+
+void Plugin_ComputeNormal::save_positions(CMap2& map, NormalParameters& p)
+{
+	const CMap2::VertexAttribute<VEC3> position = map.get_attribute<VEC3, Vertex::ORBIT>(p.position_name_.toStdString());
+	const CMap2& cmap = map;
+	p.positions_.resize(cmap.get_attribute_container<Vertex::ORBIT>().end());
+
+	ThreadPool::instance().parallel_for(0, p.vertices_.size(), [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+			p.positions_[cmap.embedding(p.vertices_[i])] = position[p.vertices_[i]];
+	});
+}
+
+bool Plugin_ComputeNormal::compute_normal(
+	const QString& map_name,
+	const QString& position_name,
+	const QString& normal_name,
+	int weighting,
+	bool create_vbo,
+	bool auto_update)
+{
+	MapHandler<CMap2>* mh = dynamic_cast<MapHandler<CMap2>*>(schnapps_->get_map(map_name));
+	if (!mh)
+	{
+		std::cerr << "Plugin_ComputeNormal::compute_normal: " << map_name.toStdString() << " is not a surface map" << std::endl;
+		return false;
+	}
+
+	// attributes stored out of the map are put back first
+	mh->ensure_attribute(position_name);
+	mh->ensure_attribute(normal_name);
+
+	std::shared_ptr<NormalParameters> p = std::make_shared<NormalParameters>();
+	p->position_name_ = position_name;
+	p->normal_name_ = normal_name;
+	p->weighting_ = weighting == AREA ? AREA : ANGLE;
+	p->auto_update_ = auto_update;
+
+	QPointer<Plugin_ComputeNormal> self(this);
+	QPointer<MapHandlerGen> guard(mh);
+	// 0: not computed, 1: computed, 2: computed in a new attribute
+	std::shared_ptr<int> result = std::make_shared<int>(0);
+
+	submit_job(
+		QString("normals of %1").arg(map_name),
+		[mh, p, result] (Job& job)
+		{
+			MapHandlerGen::Writer writer(mh);
+			CMap2* map = mh->get_map();
+			if (!map->get_attribute<VEC3, Vertex::ORBIT>(p->position_name_.toStdString()).is_valid())
+				return;
+
+			p->map_ = map;
+			map->foreach_cell([&] (Vertex v) { p->vertices_.push_back(v); });
+			std::vector<VEC3> normals;
+			compute(*map, *p, p->vertices_, normals, job);
+			// a canceled job leaves the map untouched
+			if (!job.commit())
+				return;
+
+			if (!map->get_attribute<VEC3, Vertex::ORBIT>(p->normal_name_.toStdString()).is_valid())
+			{
+				map->add_attribute<VEC3, Vertex::ORBIT>(p->normal_name_.toStdString());
+				*result = 2;
+			}
+			else
+				*result = 1;
+
+			// the automatic updates follow the positions and are not undoable
+			mh->begin_undoable(job.get_name(), QStringList() << p->normal_name_);
+			mh->undoable_write(p->normal_name_);
+			store(*map, *p, p->vertices_, normals);
+			mh->end_undoable();
+			save_positions(*map, *p);
+			writer.attribute_changed(p->normal_name_);
+		},
+		[self, guard, p, result, create_vbo] (Job&)
+		{
+			if (!guard)
+				return;
+			if (*result == 0)
+			{
+				std::cerr << "Plugin_ComputeNormal: map " << guard->get_name().toStdString() << " has no VEC3 vertex attribute " << p->position_name_.toStdString() << std::endl;
+				return;
+			}
+			if (*result == 2)
+				guard->notify_attribute_added(Vertex::ORBIT, p->normal_name_);
+			if (create_vbo)
+				guard->create_vbo(p->normal_name_);
+
+			if (!self)
+				return;
+			self->parameters_[guard.data()] = p;
+			QObject::connect(guard, SIGNAL(attribute_changed(const QString&)), self, SLOT(attribute_changed(const QString&)), Qt::UniqueConnection);
+			QObject::connect(guard, SIGNAL(connectivity_changed()), self, SLOT(connectivity_changed()), Qt::UniqueConnection);
+		},
+		mh
+	);
+
+	return true;
+}
+
+void Plugin_ComputeNormal::compute_normal_of_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		compute_normal(map->get_name(), "position", "normal", ANGLE, true, true);
+}
+
+void Plugin_ComputeNormal::stop_auto_update(const QString& map_name)
+{
+	MapHandlerGen* map = schnapps_->get_map(map_name);
+	if (map && parameters_.contains(map))
+		parameters_[map]->auto_update_ = false;
+}
+
+bool Plugin_ComputeNormal::compute_around(CMap2& map, NormalParameters& p, const std::vector<Vertex>& moved, Job& job)
+{
+	const CMap2& cmap = map;
+
+	// the normals of the vertices of the faces incident to the moved vertices change
+	std::vector<uint8> marked(cmap.get_attribute_container<Vertex::ORBIT>().end(), 0u);
+	std::vector<Vertex> ring;
+	for (Vertex v : moved)
+	{
+		map.foreach_incident_face(v, [&] (Face f)
+		{
+			map.foreach_incident_vertex(f, [&] (Vertex u)
+			{
+				const uint32 e = cmap.embedding(u);
+				if (!marked[e])
+				{
+					marked[e] = 1u;
+					ring.push_back(u);
+				}
+			});
+		});
+	}
+	std::vector<VEC3> normals;
+	compute(map, p, ring, normals, job);
+	if (!job.commit())
+		return false;
+	store(map, p, ring, normals);
+
+	const CMap2::VertexAttribute<VEC3> position = map.get_attribute<VEC3, Vertex::ORBIT>(p.position_name_.toStdString());
+	for (Vertex v : moved)
+	{
+		const uint32 e = cmap.embedding(v);
+		if (e < p.positions_.size())
+			p.positions_[e] = position[v];
+	}
+	return true;
+}
+
+bool Plugin_ComputeNormal::update_normal(MapHandlerGen* mhg, const std::vector<Vertex>& moved)
+{
+	MapHandler<CMap2>* mh = dynamic_cast<MapHandler<CMap2>*>(mhg);
+	if (!mh || !parameters_.contains(mh))
+		return false;
+
+	const std::shared_ptr<NormalParameters>& p = parameters_[mh];
+	if (moved.empty())
+		return true;
+	// the running job does not know these vertices: the next one compares all the positions
+	if (p->update_running_)
+		p->update_requested_ = true;
+	else
+		submit_update(mh, p, moved);
+
+	return true;
+}
+
+bool Plugin_ComputeNormal::update_around(MapHandler<CMap2>* mh, NormalParameters& p, const std::vector<Vertex>& moved, Job& job)
+{
+	mh->begin_write();
+	// a copy-on-write duplicate may have been detached: the vertices are not those of the map anymore
+	if (p.map_ != mh->get_map())
+	{
+		mh->end_write();
+		return update(mh, p, true, job);
+	}
+	if (compute_around(*mh->get_map(), p, moved, job))
+		mh->notify_attribute_change(p.normal_name_);
+	mh->end_write();
+
+	return true;
+}
+
+bool Plugin_ComputeNormal::update(MapHandler<CMap2>* mh, NormalParameters& p, bool connectivity, Job& job)
+{
+	mh->begin_write();
+	CMap2* map = mh->get_map();
+	const CMap2& cmap = *map;
+
+	const CMap2::VertexAttribute<VEC3> position = map->get_attribute<VEC3, Vertex::ORBIT>(p.position_name_.toStdString());
+	if (!position.is_valid() || !map->get_attribute<VEC3, Vertex::ORBIT>(p.normal_name_.toStdString()).is_valid())
+	{
+		mh->end_write();
+		return false;
+	}
+
+	// a copy-on-write duplicate may have been detached: the vertices are not those of the map anymore
+	if (connectivity || p.map_ != map || p.positions_.size() != cmap.get_attribute_container<Vertex::ORBIT>().end())
+	{
+		p.map_ = map;
+		p.vertices_.clear();
+		map->foreach_cell([&] (Vertex v) { p.vertices_.push_back(v); });
+		if (compute_all(*map, p, job))
+			mh->notify_attribute_change(p.normal_name_);
+		else
+			p.map_ = nullptr; // the saved positions are not those of the new vertices: the next update recomputes all
+		mh->end_write();
+		return true;
+	}
+
+	// find the moved vertices in parallel
+	std::vector<uint8> is_moved(p.vertices_.size(), 0u);
+	ThreadPool::instance().parallel_for(0, p.vertices_.size(), [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+			is_moved[i] = position[p.vertices_[i]] != p.positions_[cmap.embedding(p.vertices_[i])];
+	});
+	std::vector<Vertex> moved;
+	for (std::size_t i = 0; i < p.vertices_.size(); ++i)
+		if (is_moved[i])
+			moved.push_back(p.vertices_[i]);
+
+	if (!moved.empty())
+	{
+		// the whole map is recomputed when many vertices have moved
+		const bool computed = moved.size() > p.vertices_.size() / 4 ? compute_all(*map, p, job) : compute_around(*map, p, moved, job);
+		if (computed)
+			mh->notify_attribute_change(p.normal_name_);
+	}
+	mh->end_write();
+
+	return true;
+}
+
+void Plugin_ComputeNormal::request_update(MapHandler<CMap2>* mh, const std::shared_ptr<NormalParameters>& p, bool connectivity)
+{
+	p->connectivity_changed_ |= connectivity;
+	if (p->update_running_)
+		p->update_requested_ = true;
+	else
+		submit_update(mh, p, std::vector<Vertex>());
+}
+
+void Plugin_ComputeNormal::submit_update(MapHandler<CMap2>* mh, const std::shared_ptr<NormalParameters>& p, const std::vector<Vertex>& moved)
+{
+	const bool connectivity = p->connectivity_changed_;
+	p->connectivity_changed_ = false;
+	p->update_requested_ = false;
+	p->update_running_ = true;
+
+	QPointer<Plugin_ComputeNormal> self(this);
+	QPointer<MapHandlerGen> guard(mh);
+	std::shared_ptr<bool> valid = std::make_shared<bool>(true);
+
+	Job* update_job = submit_job(
+		QString("normals of %1").arg(mh->get_name()),
+		[mh, p, moved, connectivity, valid] (Job& job)
+		{
+			// the parameters are only used by this job while it runs
+			*valid = (moved.empty() || connectivity) ? update(mh, *p, connectivity, job) : update_around(mh, *p, moved, job);
+		},
+		[self, guard, p, valid] (Job&)
+		{
+			if (!guard)
+				return;
+			if (!*valid)
+			{
+				p->auto_update_ = false;
+				std::cerr << "Plugin_ComputeNormal: attributes of map " << guard->get_name().toStdString() << " removed, automatic update stopped" << std::endl;
+				return;
+			}
+			// the positions have changed again while the job was running
+			if (self && p->update_requested_ && self->parameters_.value(guard.data()) == p)
+				self->submit_update(static_cast<MapHandler<CMap2>*>(guard.data()), p, std::vector<Vertex>());
+		},
+		mh
+	);
+	// the continuation of a canceled job is not called
+	QObject::connect(update_job, &Job::finished, [p] (Job*) { p->update_running_ = false; });
+}
+
+void Plugin_ComputeNormal::map_removed(MapHandlerGen* map)
+{
+	parameters_.remove(map);
+}
+
+void Plugin_ComputeNormal::attribute_changed(const QString& name)
+{
+	MapHandlerGen* map = static_cast<MapHandlerGen*>(QObject::sender());
+	auto it = parameters_.find(map);
+	if (it != parameters_.end() && (*it)->auto_update_ && (*it)->position_name_ == name)
+		request_update(static_cast<MapHandler<CMap2>*>(map), *it, false);
+}
+
+void Plugin_ComputeNormal::connectivity_changed()
+{
+	MapHandlerGen* map = static_cast<MapHandlerGen*>(QObject::sender());
+	auto it = parameters_.find(map);
+	if (it != parameters_.end() && (*it)->auto_update_)
+		request_update(static_cast<MapHandler<CMap2>*>(map), *it, true);
+}
+
+Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+
+} // namespace schnapps
@@ -0,0 +1,180 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_COMPUTE_NORMAL_H_
+#define SCHNAPPS_PLUGIN_COMPUTE_NORMAL_H_
+
+#include <schnapps/core/plugin_processing.h>
+#include <schnapps/core/map_handler.h>
+
+#include <QAction>
+#include <QHash>
+
+#include <memory>
+#include <vector>
+
+namespace schnapps
+{
+
+/**
+* @brief Plugin computing vertex normals of surface maps
+* Normals are computed in parallel (one task per range of vertices, each vertex gathers its incident faces)
+* in a background job. With automatic update, the normals follow the modifications of the positions:
+* only the vertices around the moved ones are recomputed when few vertices have moved (real-time deformation).
+* A map has at most one update job at a time: the changes made while it runs trigger a single new update.
+*/
+class Plugin_ComputeNormal : public PluginProcessing
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "compute_normal.json")
+	Q_INTERFACES(schnapps::Plugin)
+
+public:
+
+	enum Weighting
+	{
+		AREA = 0,
+		ANGLE
+	};
+
+	inline Plugin_ComputeNormal() {}
+
+	~Plugin_ComputeNormal() {}
+
+	/**
+	 * @brief recompute the normals around some vertices (the vertices of their incident faces) in a job
+	 * The normals must have been computed once with compute_normal.
+	 * @return false if the normals of the map are not computed by the plugin
+	 */
+	bool update_normal(MapHandlerGen* map, const std::vector<CMap2::Vertex>& moved);
+
+private:
+
+	bool enable() override;
+	void disable() override;
+
+	// normals computed for a map
+	struct NormalParameters
+	{
+		NormalParameters() :
+			weighting_(ANGLE),
+			auto_update_(false),
+			map_(nullptr),
+			update_running_(false),
+			update_requested_(false),
+			connectivity_changed_(false)
+		{}
+
+		QString position_name_;
+		QString normal_name_;
+		Weighting weighting_;
+		bool auto_update_;
+		// map data of the vertices (changed by the detach of a copy-on-write duplicate)
+		const CMap2* map_;
+		// vertices of the map (rebuilt when the connectivity changes)
+		std::vector<CMap2::Vertex> vertices_;
+		// positions used for the last computation, by vertex embedding
+		std::vector<VEC3> positions_;
+		// update job of the map (GUI thread): running, requested while running, pending connectivity change
+		bool update_running_;
+		bool update_requested_;
+		bool connectivity_changed_;
+	};
+
+	/**
+	 * @brief compute the normals of some vertices in parallel (the map must be locked)
+	 * The tasks stop when the job is canceled.
+	 * @param vertices the vertices to compute
+	 * @param normals the normals of the vertices (same order)
+	 */
+	static void compute(CMap2& map, const NormalParameters& p, const std::vector<CMap2::Vertex>& vertices, std::vector<VEC3>& normals, Job& job);
+
+	// write the computed normals in the attribute (the map must be locked for writing)
+	static void store(CMap2& map, const NormalParameters& p, const std::vector<CMap2::Vertex>& vertices, const std::vector<VEC3>& normals);
+
+	// recompute the normals of all the vertices (the map must be locked for writing), false if the job has been canceled
+	static bool compute_all(CMap2& map, NormalParameters& p, Job& job);
+
+	// recompute the normals around moved vertices (the map must be locked for writing), false if the job has been canceled
+	static bool compute_around(CMap2& map, NormalParameters& p, const std::vector<CMap2::Vertex>& moved, Job& job);
+
+	// save the positions used for the computation (the map must be locked)
+	static void save_positions(CMap2& map, NormalParameters& p);
+
+public slots:
+
+	/**
+	 * @brief compute the vertex normals of a surface map
+	 * @param map_name name of the map
+	 * @param position_name name of the VEC3 position vertex attribute
+	 * @param normal_name name of the VEC3 normal vertex attribute (created if needed)
+	 * @param weighting 0: face area / 1: angle of the face at the vertex
+	 * @param create_vbo create (or refresh) the VBO of the normals
+	 * @param auto_update recompute the normals when the positions or the connectivity change
+	 * @return false if the map is not a surface map
+	 */
+	bool compute_normal(
+		const QString& map_name,
+		const QString& position_name,
+		const QString& normal_name,
+		int weighting,
+		bool create_vbo,
+		bool auto_update
+	);
+
+	/**
+	 * @brief compute the angle-weighted "normal" attribute of the selected map from its "position" attribute
+	 */
+	void compute_normal_of_selected_map();
+
+	/**
+	 * @brief stop following the modifications of the positions of a map
+	 */
+	void stop_auto_update(const QString& map_name);
+
+private slots:
+
+	void map_removed(MapHandlerGen* map);
+	void attribute_changed(const QString& name);
+	void connectivity_changed();
+
+private:
+
+	// recompute the normals of a map whose positions have been modified (in a job)
+	// return false if the attributes have been removed
+	// a canceled job leaves the normals and the saved positions untouched
+	static bool update(MapHandler<CMap2>* mh, NormalParameters& p, bool connectivity, Job& job);
+	static bool update_around(MapHandler<CMap2>* mh, NormalParameters& p, const std::vector<CMap2::Vertex>& moved, Job& job);
+
+	// start an update job, or request a new one at the end of the running one (GUI thread)
+	void request_update(MapHandler<CMap2>* mh, const std::shared_ptr<NormalParameters>& p, bool connectivity);
+	void submit_update(MapHandler<CMap2>* mh, const std::shared_ptr<NormalParameters>& p, const std::vector<CMap2::Vertex>& moved);
+
+	QAction* compute_normal_action_;
+	// the parameters are shared with the jobs of the map
+	QHash<MapHandlerGen*, std::shared_ptr<NormalParameters>> parameters_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_COMPUTE_NORMAL_H_
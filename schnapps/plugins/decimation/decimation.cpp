@@ -0,0 +1,449 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <decimation.h>
+
+#include <schnapps/core/schnapps.h>
+#include <schnapps/core/map_handler.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <QPointer>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace schnapps
+{
+
+using Vertex = CMap2::Vertex;
+using Edge = CMap2::Edge;
+using Face = CMap2::Face;
+
+namespace
+{
+
+const uint32 INVALID_INDEX = std::numeric_limits<uint32>::max();
+
+/**
+ * @brief quadric error: weighted sum of the squared distances to a set of planes
+ * The symmetric 4x4 matrix is stored as its 10 upper coefficients.
+ */
+struct Quadric
+{
+	Quadric() { std::fill(q_, q_ + 10, SCALAR(0)); }
+
+	// plane n.x + d = 0 (n unit) weighted by w
+	void add_plane(const VEC3& n, SCALAR d, SCALAR w)
+	{
+		q_[0] += w * n[0] * n[0]; q_[1] += w * n[0] * n[1]; q_[2] += w * n[0] * n[2]; q_[3] += w * n[0] * d;
+		q_[4] += w * n[1] * n[1]; q_[5] += w * n[1] * n[2]; q_[6] += w * n[1] * d;
+		q_[7] += w * n[2] * n[2]; q_[8] += w * n[2] * d;
+		q_[9] += w * d * d;
+	}
+
+	Quadric operator+(const Quadric& q) const
+	{
+		Quadric res;
+		for (uint32 i = 0u; i < 10u; ++i)
+			res.q_[i] = q_[i] + q.q_[i];
+		return res;
+	}
+
+	SCALAR eval(const VEC3& p) const
+	{
+		const SCALAR x = p[0], y = p[1], z = p[2];
+		return q_[0] * x * x + q_[4] * y * y + q_[7] * z * z +
+			SCALAR(2) * (q_[1] * x * y + q_[2] * x * z + q_[5] * y * z + q_[3] * x + q_[6] * y + q_[8] * z) +
+			q_[9];
+	}
+
+	// position minimizing the error (false if the system is singular: flat or linear neighborhood)
+	bool optimal(VEC3& p) const
+	{
+		Eigen::Matrix<SCALAR, 3, 3> a;
+		a << q_[0], q_[1], q_[2],
+			q_[1], q_[4], q_[5],
+			q_[2], q_[5], q_[7];
+		const SCALAR trace = a.trace();
+		if (trace <= SCALAR(0) || std::abs(a.determinant()) < SCALAR(1e-6) * trace * trace * trace)
+			return false;
+		p = a.inverse() * VEC3(-q_[3], -q_[6], -q_[8]);
+		return true;
+	}
+
+	SCALAR q_[10];
+};
+
+/**
+ * @brief test if moving the vertex v to p flips one of its faces (the faces incident to the vertex other vanish)
+ */
+bool flips(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Vertex v, uint32 other, const VEC3& p)
+{
+	const VEC3& pv = position[v];
+	bool res = false;
+	map.foreach_dart_of_orbit(v, [&] (cgogn::Dart d)
+	{
+		if (res || map.is_boundary(d))
+			return;
+		const Vertex x(map.phi1(d));
+		const Vertex y(map.phi_1(d));
+		if (map.embedding(x) == other || map.embedding(y) == other)
+			return;
+		const VEC3 before = (position[x] - pv).cross(position[y] - pv);
+		const VEC3 after = (position[x] - p).cross(position[y] - p);
+		res = before.dot(after) <= SCALAR(0);
+	});
+	return res;
+}
+
+/**
+ * @brief compute the cost and the position of the collapse of an edge
+ * @return false if the edge cannot be collapsed (boundary, link condition, face flip)
+ */
+bool evaluate(
+	const CMap2& map,
+	const CMap2::VertexAttribute<VEC3>& position,
+	const std::vector<Quadric>& quadrics,
+	const std::vector<uint8>& boundary,
+	Edge e,
+	SCALAR& cost,
+	VEC3& p)
+{
+	const cgogn::Dart d = e.dart;
+	const cgogn::Dart dd = map.phi2(d);
+	if (map.is_boundary(d) || map.is_boundary(dd))
+		return false;
+
+	const Vertex a(d);
+	const Vertex b(dd);
+	const uint32 la = map.embedding(a);
+	const uint32 lb = map.embedding(b);
+	if (boundary[la] || boundary[lb])
+		return false;
+
+	// link condition: the only common neighbors of a and b are the opposite vertices of the two triangles
+	std::vector<uint32> neighbors;
+	map.foreach_adjacent_vertex_through_edge(a, [&] (Vertex u) { neighbors.push_back(map.embedding(u)); });
+	uint32 nb_common = 0u;
+	map.foreach_adjacent_vertex_through_edge(b, [&] (Vertex u)
+	{
+		if (std::find(neighbors.begin(), neighbors.end(), map.embedding(u)) != neighbors.end())
+			++nb_common;
+	});
+	if (nb_common != 2u)
+		return false;
+
+	const Quadric q = quadrics[la] + quadrics[lb];
+	if (!q.optimal(p))
+	{
+		// singular quadric: best of the end points and the midpoint
+		const VEC3 candidates[3] = { position[a], position[b], VEC3((position[a] + position[b]) / SCALAR(2)) };
+		p = candidates[0];
+		for (uint32 i = 1u; i < 3u; ++i)
+		{
+			if (q.eval(candidates[i]) < q.eval(p))
+				p = candidates[i];
+		}
+	}
+	cost = std::max(q.eval(p), SCALAR(0));
+
+	return !flips(map, position, a, lb, p) && !flips(map, position, b, la, p);
+}
+
+struct DecimationResult
+{
+	DecimationResult() : status_(NO_POSITION), nb_faces_before_(0u), nb_faces_after_(0u), nb_rounds_(0u) {}
+
+	enum Status
+	{
+		NO_POSITION = 0,
+		NOT_TRIANGULATED,
+		DONE
+	};
+
+	Status status_;
+	uint32 nb_faces_before_;
+	uint32 nb_faces_after_;
+	uint32 nb_rounds_;
+};
+
+} // namespace
+
+bool Plugin_Decimation::enable()
+{
+	decimate_action_ = new QAction("decimate (10%)", this);
+	schnapps_->add_menu_action(this, "Surface;Decimate (10%)", decimate_action_);
+	connect(decimate_action_, SIGNAL(triggered()), this, SLOT(decimate_selected_map()));
+
+	return true;
+}
+
+bool Plugin_Decimation::decimate(
+	const QString& map_name,
+	const QString& position_name,
+	int target_nb_faces,
+	double max_error,
+	bool in_place)
+{
+	if (!dynamic_cast<MapHandler<CMap2>*>(schnapps_->get_map(map_name)))
+	{
+		std::cerr << "Plugin_Decimation::decimate: " << map_name.toStdString() << " is not a surface map" << std::endl;
+		return false;
+	}
+	if (target_nb_faces <= 0 && max_error <= 0.0)
+	{
+		std::cerr << "Plugin_Decimation::decimate: no target number of faces nor maximal error" << std::endl;
+		return false;
+	}
+
+	// the duplicate shares the data of the map until the decimation writes it
+	MapHandler<CMap2>* mh = static_cast<MapHandler<CMap2>*>(in_place ? schnapps_->get_map(map_name) : schnapps_->duplicate_map(map_name, true));
+	if (!mh)
+		return false;
+
+	// attributes stored out of the map are put back first (the connectivity changes)
+	mh->restore_stored_attributes();
+
+	QPointer<MapHandlerGen> guard(mh);
+	SCHNApps* schnapps = schnapps_;
+	std::shared_ptr<DecimationResult> result = std::make_shared<DecimationResult>();
+
+	submit_job(
+		QString("decimation of %1").arg(mh->get_name()),
+		[mh, position_name, target_nb_faces, max_error, result] (Job& job)
+		{
+			{
+				MapHandlerGen::Writer writer(mh);
+				CMap2* map = mh->get_map();
+				const CMap2& cmap = *map;
+				CMap2::VertexAttribute<VEC3> position = map->get_attribute<VEC3, Vertex::ORBIT>(position_name.toStdString());
+				if (!position.is_valid())
+					return;
+
+				uint32 nb_faces = 0u;
+				bool triangles = true;
+				cmap.foreach_cell([&] (Face f)
+				{
+					++nb_faces;
+					triangles &= cmap.codegree(f) == 3u;
+				});
+				if (!triangles)
+				{
+					result->status_ = DecimationResult::NOT_TRIANGULATED;
+					return;
+				}
+				result->status_ = DecimationResult::DONE;
+				result->nb_faces_before_ = nb_faces;
+
+				ThreadPool& pool = ThreadPool::instance();
+				const uint32 target = target_nb_faces > 0 ? uint32(target_nb_faces) : 0u;
+				const SCALAR error = max_error > 0.0 ? SCALAR(max_error) : std::numeric_limits<SCALAR>::max();
+
+				// initial quadrics: planes of the incident faces weighted by their area
+				std::vector<Vertex> vertices;
+				cmap.foreach_cell([&] (Vertex v) { vertices.push_back(v); });
+				std::vector<Quadric> quadrics(cmap.get_attribute_container<Vertex::ORBIT>().end());
+				std::vector<uint8> boundary(quadrics.size(), 0u);
+				pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+				{
+					for (std::size_t i = first; i < last; ++i)
+					{
+						Quadric q;
+						bool b = false;
+						cmap.foreach_dart_of_orbit(vertices[i], [&] (cgogn::Dart d)
+						{
+							if (cmap.is_boundary(d))
+							{
+								b = true;
+								return;
+							}
+							const VEC3& p = position[Vertex(d)];
+							VEC3 n = (position[Vertex(cmap.phi1(d))] - p).cross(position[Vertex(cmap.phi_1(d))] - p);
+							const SCALAR double_area = n.norm();
+							if (double_area <= SCALAR(0))
+								return;
+							n /= double_area;
+							q.add_plane(n, -n.dot(p), double_area / SCALAR(2));
+						});
+						const uint32 line = cmap.embedding(vertices[i]);
+						quadrics[line] = q;
+						boundary[line] = b;
+					}
+				});
+
+				while (!job.is_canceled() && nb_faces > std::max(target, 4u))
+				{
+					// edges numbered in traversal order, found from both of their darts
+					std::vector<Edge> edges;
+					std::vector<uint32> edge_index(cmap.get_topology_container().end(), INVALID_INDEX);
+					cmap.foreach_cell([&] (Edge e)
+					{
+						edge_index[e.dart.index] = edge_index[cmap.phi2(e.dart).index] = uint32(edges.size());
+						edges.push_back(e);
+					});
+					vertices.clear();
+					cmap.foreach_cell([&] (Vertex v) { vertices.push_back(v); });
+
+					std::vector<SCALAR> costs(edges.size());
+					std::vector<VEC3> targets(edges.size());
+					std::vector<uint8> valid(edges.size());
+					pool.parallel_for(0, edges.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							valid[i] = evaluate(cmap, position, quadrics, boundary, edges[i], costs[i], targets[i]) && costs[i] <= error;
+					});
+
+					// strict order on the valid edges (invalid edges come last)
+					auto less = [&] (uint32 i, uint32 j) -> bool
+					{
+						if (j == INVALID_INDEX)
+							return i != INVALID_INDEX;
+						if (i == INVALID_INDEX)
+							return false;
+						return costs[i] < costs[j] || (costs[i] == costs[j] && i < j);
+					};
+
+					// best incident edge of each vertex, then best edge of the 1-ring of each vertex:
+					// an edge that is the best of the 1-rings of both its vertices has no selected edge
+					// within one edge of its vertices, so that the selected collapses are independent
+					std::vector<uint32> best(quadrics.size(), INVALID_INDEX);
+					pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+						{
+							uint32 b = INVALID_INDEX;
+							cmap.foreach_dart_of_orbit(vertices[i], [&] (cgogn::Dart d)
+							{
+								const uint32 e = edge_index[d.index];
+								if (valid[e] && less(e, b))
+									b = e;
+							});
+							best[cmap.embedding(vertices[i])] = b;
+						}
+					});
+					std::vector<uint32> best_around(quadrics.size(), INVALID_INDEX);
+					pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+						{
+							const uint32 line = cmap.embedding(vertices[i]);
+							uint32 b = best[line];
+							cmap.foreach_dart_of_orbit(vertices[i], [&] (cgogn::Dart d)
+							{
+								const uint32 e = best[cmap.embedding(Vertex(cmap.phi1(d)))];
+								if (less(e, b))
+									b = e;
+							});
+							best_around[line] = b;
+						}
+					});
+
+					std::vector<uint32> selected;
+					for (uint32 i = 0u; i < uint32(edges.size()); ++i)
+					{
+						if (valid[i] &&
+							best_around[cmap.embedding(Vertex(edges[i].dart))] == i &&
+							best_around[cmap.embedding(Vertex(cmap.phi2(edges[i].dart)))] == i)
+							selected.push_back(i);
+					}
+					if (selected.empty())
+						break;
+
+					// each collapse removes 2 faces: the cheapest collapses reach the target
+					std::sort(selected.begin(), selected.end(), less);
+					if (target > 0u)
+						selected.resize(std::min(std::size_t((nb_faces - target + 1u) / 2u), selected.size()));
+
+					for (uint32 i : selected)
+					{
+						const Quadric q =
+							quadrics[cmap.embedding(Vertex(edges[i].dart))] +
+							quadrics[cmap.embedding(Vertex(cmap.phi2(edges[i].dart)))];
+						const Vertex v = map->collapse_edge(edges[i]);
+						const uint32 line = cmap.embedding(v);
+						if (line >= quadrics.size())
+						{
+							quadrics.resize(line + 1u);
+							boundary.resize(line + 1u, 0u);
+						}
+						position[v] = targets[i];
+						quadrics[line] = q;
+						boundary[line] = 0u;
+					}
+					nb_faces -= 2u * uint32(selected.size());
+					++result->nb_rounds_;
+
+					if (target > 0u)
+						job.set_progress(double(result->nb_faces_before_ - nb_faces) / double(result->nb_faces_before_ - std::min(target, result->nb_faces_before_)));
+				}
+
+				result->nb_faces_after_ = nb_faces;
+				writer.attribute_changed(position_name);
+				writer.connectivity_changed();
+			}
+
+			// most of the cells have been removed: the holes of the containers are removed
+			if (result->status_ == DecimationResult::DONE)
+				mh->compact_now();
+		},
+		[schnapps, guard, position_name, in_place, result] (Job&)
+		{
+			if (!guard)
+				return;
+			switch (result->status_)
+			{
+				case DecimationResult::NO_POSITION:
+					std::cerr << "Plugin_Decimation: map " << guard->get_name().toStdString() << " has no VEC3 attribute " << position_name.toStdString() << std::endl;
+					break;
+				case DecimationResult::NOT_TRIANGULATED:
+					std::cerr << "Plugin_Decimation: map " << guard->get_name().toStdString() << " is not triangulated" << std::endl;
+					break;
+				case DecimationResult::DONE:
+					schnapps->status_bar_message(QString("%1: %2 -> %3 faces in %4 rounds")
+						.arg(guard->get_name()).arg(result->nb_faces_before_).arg(result->nb_faces_after_).arg(result->nb_rounds_), 5000);
+					break;
+			}
+			// the checks are done by the task (the map is locked): a duplicate that could not be decimated is removed
+			if (result->status_ != DecimationResult::DONE && !in_place)
+				schnapps->remove_map(guard->get_name());
+		},
+		mh
+	);
+
+	return true;
+}
+
+void Plugin_Decimation::decimate_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		decimate(map->get_name(), "position", int(map->nb_faces() / 10u), 0.0, false);
+}
+
+Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+
+} // namespace schnapps
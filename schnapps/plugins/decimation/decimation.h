@@ -0,0 +1,92 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_DECIMATION_H_
+#define SCHNAPPS_PLUGIN_DECIMATION_H_
+
+#include <schnapps/core/plugin_processing.h>
+
+#include <QAction>
+
+namespace schnapps
+{
+
+/**
+* @brief Plugin decimating triangulated surface maps by quadric error edge collapses
+* Instead of a global priority queue, the decimation runs by rounds: the costs and the validity
+* (link condition, no face flip) of all the edges are evaluated in parallel, then a set of
+* independent edges is selected in parallel (each edge has the smallest cost in the 2-ring of its
+* vertices, so that the selected collapses do not overlap), and these edges are collapsed.
+* The edges incident to boundary vertices are not collapsed.
+*/
+class Plugin_Decimation : public PluginProcessing
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "decimation.json")
+	Q_INTERFACES(schnapps::Plugin)
+
+public:
+
+	inline Plugin_Decimation() {}
+
+	~Plugin_Decimation() {}
+
+private:
+
+	bool enable() override;
+	inline void disable() override {}
+
+public slots:
+
+	/**
+	 * @brief decimate a triangulated surface map in a background job
+	 * The decimation stops when the number of faces reaches the target or when the cost of all the
+	 * remaining collapses exceeds the maximal error. The map is compacted at the end.
+	 * @param map_name name of the map
+	 * @param position_name name of the VEC3 position vertex attribute
+	 * @param target_nb_faces number of faces to reach (no target if 0)
+	 * @param max_error maximal quadric error of a collapse (no limit if <= 0)
+	 * @param in_place decimate the map itself, or a duplicate of it (see SCHNApps::duplicate_map)
+	 * @return false if the map is not a surface map or no stop criterion is given
+	 */
+	bool decimate(
+		const QString& map_name,
+		const QString& position_name,
+		int target_nb_faces,
+		double max_error,
+		bool in_place
+	);
+
+	/**
+	 * @brief decimate a duplicate of the selected map to 10% of its faces
+	 */
+	void decimate_selected_map();
+
+private:
+
+	QAction* decimate_action_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_DECIMATION_H_
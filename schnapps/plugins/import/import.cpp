@@ -61,18 +61,29 @@ MapHandlerGen* Plugin_Import::import_surface_mesh_from_file(const QString& filen
 			MapHandler<CMap2>* mh = static_cast<MapHandler<CMap2>*>(mhg);
 			CMap2* map = mh->get_map();
 
+			// all the attributes created by the import are committed at once
+			mh->begin_changes();
+
 			cgogn::io::import_surface<VEC3>(*map, filename.toStdString());
 
-//			for (unsigned int orbit = VERTEX; orbit <= VOLUME; orbit++)
-//			{
-//				AttributeContainer& cont = map->getAttributeContainer(orbit);
-//				std::vector<std::string> names;
-//				std::vector<std::string> types;
-//				cont.getAttributesNames(names);
-//				cont.getAttributesTypes(types);
-//				for(unsigned int i = 0; i < names.size(); ++i)
-//					mhg->registerAttribute(orbit, QString::fromStdString(names[i]), QString::fromStdString(types[i]));
-//			}
+			const CMap2* cmap = map;
+			if (cmap->is_embedded<CMap2::Vertex::ORBIT>())
+			{
+				for (const std::string& name : cmap->get_attribute_container<CMap2::Vertex::ORBIT>().get_names())
+					mh->notify_attribute_added(CMap2::Vertex::ORBIT, QString::fromStdString(name));
+			}
+			if (cmap->is_embedded<CMap2::Edge::ORBIT>())
+			{
+				for (const std::string& name : cmap->get_attribute_container<CMap2::Edge::ORBIT>().get_names())
+					mh->notify_attribute_added(CMap2::Edge::ORBIT, QString::fromStdString(name));
+			}
+			if (cmap->is_embedded<CMap2::Face::ORBIT>())
+			{
+				for (const std::string& name : cmap->get_attribute_container<CMap2::Face::ORBIT>().get_names())
+					mh->notify_attribute_added(CMap2::Face::ORBIT, QString::fromStdString(name));
+			}
+
+			mh->end_changes();
 		}
 		return mhg;
 	}
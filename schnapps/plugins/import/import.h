@@ -39,7 +39,7 @@ class MapHandlerGen;
 class Plugin_Import : public PluginProcessing
 {
 	Q_OBJECT
-	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "import.json")
 	Q_INTERFACES(schnapps::Plugin)
 
 public:
@@ -0,0 +1,322 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <smoothing.h>
+
+#include <schnapps/core/schnapps.h>
+#include <schnapps/core/map_handler.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <QPointer>
+#include <QSet>
+
+#include <iostream>
+#include <memory>
+#include <vector>
+
+namespace schnapps
+{
+
+using Vertex = CMap2::Vertex;
+
+namespace
+{
+
+/**
+ * @brief explicit step: y = x + lambda * (barycenter of the neighbors - x)
+ */
+void explicit_step(const CSRRelation& adj, const std::vector<uint8>& fixed, const std::vector<VEC3>& x, std::vector<VEC3>& y, SCALAR lambda)
+{
+	ThreadPool::instance().parallel_for(0, adj.nb_sources(), [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+		{
+			if (fixed[i])
+			{
+				y[i] = x[i];
+				continue;
+			}
+			VEC3 barycenter = VEC3::Zero();
+			for (const uint32* it = adj.begin(uint32(i)); it != adj.end(uint32(i)); ++it)
+				barycenter += x[*it];
+			barycenter /= SCALAR(adj.degree(uint32(i)));
+			y[i] = x[i] + lambda * (barycenter - x[i]);
+		}
+	});
+}
+
+/**
+ * @brief implicit step: solve (D + lambda * (D - A)) y = D x
+ * D is the diagonal matrix of the degrees and A the adjacency matrix: the symmetric form of
+ * (I - lambda * L) y = x with the umbrella operator L. The system is solved for the 3 coordinates
+ * at once by a Jacobi preconditioned conjugate gradient, the fixed vertices being kept out of it.
+ */
+void implicit_step(const CSRRelation& adj, const std::vector<uint8>& fixed, const std::vector<VEC3>& x, std::vector<VEC3>& y, SCALAR lambda, const Job& job)
+{
+	const uint32 max_iterations = 100u;
+	const SCALAR tolerance = SCALAR(1e-6);
+
+	ThreadPool& pool = ThreadPool::instance();
+	const std::size_t n = adj.nb_sources();
+	std::vector<VEC3> r(n), z(n), p(n), q(n);
+
+	auto diagonal = [&] (std::size_t i) -> SCALAR { return (SCALAR(1) + lambda) * SCALAR(adj.degree(uint32(i))); };
+
+	// v = M u on the free vertices
+	auto multiply = [&] (const std::vector<VEC3>& u, std::vector<VEC3>& v)
+	{
+		pool.parallel_for(0, n, [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				if (fixed[i])
+				{
+					v[i] = VEC3::Zero();
+					continue;
+				}
+				VEC3 sum = VEC3::Zero();
+				for (const uint32* it = adj.begin(uint32(i)); it != adj.end(uint32(i)); ++it)
+					sum += u[*it];
+				v[i] = diagonal(i) * u[i] - lambda * sum;
+			}
+		});
+	};
+
+	// per-coordinate dot product
+	auto dot = [&] (const std::vector<VEC3>& a, const std::vector<VEC3>& b) -> VEC3
+	{
+		return pool.parallel_reduce(std::size_t(0), n, VEC3(VEC3::Zero()),
+			[&] (std::size_t first, std::size_t last) -> VEC3
+			{
+				VEC3 sum = VEC3::Zero();
+				for (std::size_t i = first; i < last; ++i)
+					sum += a[i].cwiseProduct(b[i]);
+				return sum;
+			},
+			[] (const VEC3& a, const VEC3& b) -> VEC3 { return a + b; }
+		);
+	};
+
+	// the fixed vertices keep their position, the free ones start from it
+	y = x;
+	multiply(y, q);
+	pool.parallel_for(0, n, [&] (std::size_t first, std::size_t last)
+	{
+		for (std::size_t i = first; i < last; ++i)
+		{
+			r[i] = fixed[i] ? VEC3(VEC3::Zero()) : VEC3(SCALAR(adj.degree(uint32(i))) * x[i] - q[i]);
+			z[i] = fixed[i] ? VEC3(VEC3::Zero()) : VEC3(r[i] / diagonal(i));
+			p[i] = z[i];
+		}
+	});
+
+	VEC3 rz = dot(r, z);
+	const SCALAR threshold = tolerance * tolerance * rz.maxCoeff();
+	for (uint32 it = 0u; it < max_iterations && rz.maxCoeff() > threshold && !job.is_canceled(); ++it)
+	{
+		multiply(p, q);
+		const VEC3 pq = dot(p, q);
+		VEC3 alpha;
+		for (uint32 c = 0u; c < 3u; ++c)
+			alpha[c] = pq[c] > SCALAR(0) ? rz[c] / pq[c] : SCALAR(0);
+
+		pool.parallel_for(0, n, [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+			{
+				if (fixed[i])
+					continue;
+				y[i] += alpha.cwiseProduct(p[i]);
+				r[i] -= alpha.cwiseProduct(q[i]);
+				z[i] = r[i] / diagonal(i);
+			}
+		});
+
+		const VEC3 rz_next = dot(r, z);
+		VEC3 beta;
+		for (uint32 c = 0u; c < 3u; ++c)
+			beta[c] = rz[c] > SCALAR(0) ? rz_next[c] / rz[c] : SCALAR(0);
+		rz = rz_next;
+
+		pool.parallel_for(0, n, [&] (std::size_t first, std::size_t last)
+		{
+			for (std::size_t i = first; i < last; ++i)
+				p[i] = z[i] + beta.cwiseProduct(p[i]);
+		});
+	}
+}
+
+} // namespace
+
+bool Plugin_Smoothing::enable()
+{
+	smooth_action_ = new QAction("smooth (Taubin)", this);
+	schnapps_->add_menu_action(this, "Surface;Smooth (Taubin)", smooth_action_);
+	connect(smooth_action_, SIGNAL(triggered()), this, SLOT(smooth_selected_map()));
+
+	return true;
+}
+
+bool Plugin_Smoothing::smooth(
+	const QString& map_name,
+	const QString& position_name,
+	int method,
+	int nb_iterations,
+	double lambda,
+	bool fixed_boundary)
+{
+	MapHandler<CMap2>* mh = dynamic_cast<MapHandler<CMap2>*>(schnapps_->get_map(map_name));
+	if (!mh)
+	{
+		std::cerr << "Plugin_Smoothing::smooth: " << map_name.toStdString() << " is not a surface map" << std::endl;
+		return false;
+	}
+	if (method < LAPLACIAN || method > IMPLICIT)
+	{
+		std::cerr << "Plugin_Smoothing::smooth: unknown method " << method << std::endl;
+		return false;
+	}
+	if (nb_iterations <= 0 || lambda <= 0.0 || (method != IMPLICIT && lambda > 1.0))
+	{
+		std::cerr << "Plugin_Smoothing::smooth: invalid number of iterations or step size" << std::endl;
+		return false;
+	}
+
+	// attributes stored out of the map are put back first
+	mh->ensure_attribute(position_name);
+
+	QPointer<MapHandlerGen> guard(mh);
+	std::shared_ptr<bool> result = std::make_shared<bool>(false);
+
+	submit_job(
+		QString("smoothing of %1").arg(map_name),
+		[mh, position_name, method, nb_iterations, lambda, fixed_boundary, result] (Job& job)
+		{
+			const std::string back_name = MapHandlerGen::back_buffer_name(position_name).toStdString();
+			if (!mh->add_back_buffer<VEC3>(position_name).is_valid())
+				return;
+			*result = true;
+
+			// the positions are saved once, before the first swap of the buffers
+			{
+				MapHandlerGen::Writer writer(mh);
+				mh->begin_undoable(job.get_name(), QStringList() << position_name);
+				mh->undoable_write(position_name);
+			}
+
+			// the neighborhoods are read from the CSR adjacency cached by the map handler
+			std::shared_ptr<const MapAdjacency> adjacency;
+			std::vector<VEC3> x;
+			mh->begin_read();
+			{
+				adjacency = mh->get_adjacency();
+				const CMap2::VertexAttribute<VEC3> position = mh->get_map()->get_attribute<VEC3, Vertex::ORBIT>(position_name.toStdString());
+				x.resize(adjacency->nb_vertices());
+				for (uint32 i = 0u; i < adjacency->nb_vertices(); ++i)
+					x[i] = position[adjacency->vertex_lines_[i]];
+			}
+			mh->end_read();
+
+			const CSRRelation& adj = adjacency->vertex_vertex_;
+			const std::vector<uint32>& lines = adjacency->vertex_lines_;
+			// the boundary (if asked) and the isolated vertices do not move
+			std::vector<uint8> fixed(adjacency->nb_vertices());
+			for (uint32 i = 0u; i < adjacency->nb_vertices(); ++i)
+				fixed[i] = (fixed_boundary && adjacency->boundary_vertex_[i]) || adj.degree(i) == 0u;
+
+			// the buffers only differ on the chunks of the moving vertices: only they are uploaded at each swap
+			QSet<uint32> moving_chunks;
+			for (uint32 i = 0u; i < adjacency->nb_vertices(); ++i)
+			{
+				if (!fixed[i])
+					moving_chunks.insert(MapHandlerGen::chunk_index(lines[i]));
+			}
+
+			// Taubin: the mu step inflates back what the lambda step shrinks (pass-band frequency 0.1)
+			const SCALAR l = SCALAR(lambda);
+			const SCALAR mu = SCALAR(1) / (SCALAR(0.1) - SCALAR(1) / l);
+
+			std::vector<VEC3> y(x.size());
+			for (int it = 0; it < nb_iterations && !job.is_canceled(); ++it)
+			{
+				switch (method)
+				{
+					case LAPLACIAN:
+						explicit_step(adj, fixed, x, y, l);
+						break;
+					case TAUBIN:
+						explicit_step(adj, fixed, x, y, l);
+						x.swap(y);
+						explicit_step(adj, fixed, x, y, mu);
+						break;
+					case IMPLICIT:
+						implicit_step(adj, fixed, x, y, l, job);
+						break;
+				}
+				x.swap(y);
+
+				// the back buffer is only accessed by this job: it is written under the read lock
+				// while the views keep drawing the front buffer
+				mh->begin_read();
+				{
+					// the handle is fetched at each iteration: the map data may have been copied (copy-on-write)
+					CMap2::VertexAttribute<VEC3> back = mh->get_map()->get_attribute<VEC3, Vertex::ORBIT>(back_name);
+					ThreadPool::instance().parallel_for(0, x.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							back[lines[i]] = x[i];
+					});
+				}
+				mh->end_read();
+				mh->swap_buffers<VEC3>(position_name, moving_chunks);
+
+				job.set_progress(double(it + 1) / double(nb_iterations));
+			}
+
+			{
+				MapHandlerGen::Writer writer(mh);
+				mh->end_undoable();
+			}
+			mh->remove_back_buffer<VEC3>(position_name);
+		},
+		[guard, position_name, result] (Job&)
+		{
+			if (guard && !*result)
+				std::cerr << "Plugin_Smoothing: map " << guard->get_name().toStdString() << " has no VEC3 attribute " << position_name.toStdString() << std::endl;
+		},
+		mh
+	);
+
+	return true;
+}
+
+void Plugin_Smoothing::smooth_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		smooth(map->get_name(), "position", TAUBIN, 10, 0.5, true);
+}
+
+Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+
+} // namespace schnapps
@@ -0,0 +1,101 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_SMOOTHING_H_
+#define SCHNAPPS_PLUGIN_SMOOTHING_H_
+
+#include <schnapps/core/plugin_processing.h>
+
+#include <QAction>
+
+namespace schnapps
+{
+
+/**
+* @brief Plugin smoothing the positions of surface maps
+* The one-ring neighborhoods are read from the CSR adjacency cached by the map (see MapHandlerGen::get_adjacency)
+* and the positions are copied in a contiguous array: the iterations only read contiguous memory and run in parallel.
+* Each iteration is written in the back buffer of the position attribute, which is then swapped
+* (see MapHandler::swap_buffers): the views show the convergence while the next iteration is computed.
+* Only the chunks of the moving vertices are uploaded to the position VBO at each swap, and the positions
+* are saved once for undo, before the first swap.
+* The connectivity of the map must not change while it is smoothed.
+*/
+class Plugin_Smoothing : public PluginProcessing
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "smoothing.json")
+	Q_INTERFACES(schnapps::Plugin)
+
+public:
+
+	enum Method
+	{
+		LAPLACIAN = 0, // explicit umbrella operator: p += lambda * (barycenter of the neighbors - p)
+		TAUBIN,        // explicit lambda / mu steps, without shrinkage
+		IMPLICIT       // implicit fairing: (I - lambda * L) p' = p, solved by a preconditioned conjugate gradient
+	};
+
+	inline Plugin_Smoothing() {}
+
+	~Plugin_Smoothing() {}
+
+private:
+
+	bool enable() override;
+	inline void disable() override {}
+
+public slots:
+
+	/**
+	 * @brief smooth the positions of a surface map in a background job
+	 * @param map_name name of the map
+	 * @param position_name name of the VEC3 position vertex attribute
+	 * @param method 0: Laplacian / 1: Taubin / 2: implicit
+	 * @param nb_iterations number of iterations (implicit: number of time steps)
+	 * @param lambda step size in ]0,1] (implicit: time step)
+	 * @param fixed_boundary the boundary vertices do not move
+	 * @return false if the map is not a surface map or a parameter is invalid
+	 */
+	bool smooth(
+		const QString& map_name,
+		const QString& position_name,
+		int method,
+		int nb_iterations,
+		double lambda,
+		bool fixed_boundary
+	);
+
+	/**
+	 * @brief smooth the "position" attribute of the selected map (10 Taubin iterations)
+	 */
+	void smooth_selected_map();
+
+private:
+
+	QAction* smooth_action_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_SMOOTHING_H_
@@ -0,0 +1,417 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <subdivision.h>
+
+#include <schnapps/core/schnapps.h>
+#include <schnapps/core/map_handler.h>
+#include <schnapps/core/map_adjacency.h>
+#include <schnapps/core/thread_pool.h>
+
+#include <QElapsedTimer>
+#include <QPointer>
+#include <QStringList>
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace schnapps
+{
+
+using Vertex = CMap2::Vertex;
+using Edge = CMap2::Edge;
+using Face = CMap2::Face;
+
+namespace
+{
+
+struct LevelReport
+{
+	float64 geometry_ms_;
+	float64 topology_ms_;
+	uint32 nb_vertices_;
+	uint32 nb_faces_;
+};
+
+struct SubdivisionResult
+{
+	SubdivisionResult() : status_(NO_POSITION) {}
+
+	enum Status
+	{
+		NO_POSITION = 0,
+		NOT_TRIANGULATED,
+		DONE
+	};
+
+	Status status_;
+	std::vector<LevelReport> levels_;
+};
+
+inline bool is_boundary_edge(const CMap2& map, cgogn::Dart d)
+{
+	return map.is_boundary(d) || map.is_boundary(map.phi2(d));
+}
+
+/**
+ * @brief position of an old vertex on a boundary: 3/4 of the vertex, 1/8 of its two boundary neighbors
+ * @return false if the vertex is not on a boundary
+ */
+bool boundary_vertex_point(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Vertex v, VEC3& p)
+{
+	VEC3 sum = VEC3::Zero();
+	uint32 nb = 0u;
+	map.foreach_dart_of_orbit(v, [&] (cgogn::Dart d)
+	{
+		if (is_boundary_edge(map, d))
+		{
+			sum += position[Vertex(map.phi1(d))];
+			++nb;
+		}
+	});
+	if (nb == 0u)
+		return false;
+	p = nb == 2u ? VEC3(SCALAR(0.75) * position[v] + SCALAR(0.125) * sum) : position[v];
+	return true;
+}
+
+/**
+ * @brief Loop: new position of an old vertex
+ */
+VEC3 loop_vertex_point(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Vertex v)
+{
+	VEC3 p;
+	if (boundary_vertex_point(map, position, v, p))
+		return p;
+
+	VEC3 sum = VEC3::Zero();
+	uint32 n = 0u;
+	map.foreach_adjacent_vertex_through_edge(v, [&] (Vertex u)
+	{
+		sum += position[u];
+		++n;
+	});
+	const SCALAR c = SCALAR(0.375) + SCALAR(0.25) * std::cos(SCALAR(2 * M_PI) / SCALAR(n));
+	const SCALAR beta = (SCALAR(0.625) - c * c) / SCALAR(n);
+	return (SCALAR(1) - SCALAR(n) * beta) * position[v] + beta * sum;
+}
+
+/**
+ * @brief Loop: position of the new vertex of an edge
+ */
+VEC3 loop_edge_point(const CMap2& map, const CMap2::VertexAttribute<VEC3>& position, Edge e)
+{
+	const cgogn::Dart d = e.dart;
+	const cgogn::Dart dd = map.phi2(d);
+	const VEC3& a = position[Vertex(d)];
+	const VEC3& b = position[Vertex(dd)];
+	if (is_boundary_edge(map, d))
+		return (a + b) / SCALAR(2);
+	// opposite vertices of the two triangles
+	const VEC3& c = position[Vertex(map.phi_1(d))];
+	const VEC3& f = position[Vertex(map.phi_1(dd))];
+	return SCALAR(0.375) * (a + b) + SCALAR(0.125) * (c + f);
+}
+
+/**
+ * @brief Catmull-Clark: new position of an old vertex
+ * @param face_points face point of each face, by face number
+ * @param face_index face number of each dart (INVALID on boundary darts)
+ */
+VEC3 catmull_clark_vertex_point(
+	const CMap2& map,
+	const CMap2::VertexAttribute<VEC3>& position,
+	const std::vector<VEC3>& face_points,
+	const std::vector<uint32>& face_index,
+	Vertex v)
+{
+	VEC3 p;
+	if (boundary_vertex_point(map, position, v, p))
+		return p;
+
+	VEC3 faces = VEC3::Zero();
+	VEC3 neighbors = VEC3::Zero();
+	uint32 n = 0u;
+	map.foreach_dart_of_orbit(v, [&] (cgogn::Dart d)
+	{
+		faces += face_points[face_index[d.index]];
+		neighbors += position[Vertex(map.phi1(d))];
+		++n;
+	});
+	const VEC3& pv = position[v];
+	// average of the face points, average of the edge midpoints
+	const VEC3 f = faces / SCALAR(n);
+	const VEC3 r = (pv + neighbors / SCALAR(n)) / SCALAR(2);
+	return (f + SCALAR(2) * r + SCALAR(n - 3) * pv) / SCALAR(n);
+}
+
+/**
+ * @brief Catmull-Clark: position of the new vertex of an edge
+ */
+VEC3 catmull_clark_edge_point(
+	const CMap2& map,
+	const CMap2::VertexAttribute<VEC3>& position,
+	const std::vector<VEC3>& face_points,
+	const std::vector<uint32>& face_index,
+	Edge e)
+{
+	const cgogn::Dart d = e.dart;
+	const cgogn::Dart dd = map.phi2(d);
+	const VEC3& a = position[Vertex(d)];
+	const VEC3& b = position[Vertex(dd)];
+	if (is_boundary_edge(map, d))
+		return (a + b) / SCALAR(2);
+	return (a + b + face_points[face_index[d.index]] + face_points[face_index[dd.index]]) / SCALAR(4);
+}
+
+} // namespace
+
+bool Plugin_Subdivision::enable()
+{
+	loop_action_ = new QAction("subdivide (Loop)", this);
+	schnapps_->add_menu_action(this, "Surface;Subdivide (Loop)", loop_action_);
+	connect(loop_action_, SIGNAL(triggered()), this, SLOT(loop_selected_map()));
+
+	catmull_clark_action_ = new QAction("subdivide (Catmull-Clark)", this);
+	schnapps_->add_menu_action(this, "Surface;Subdivide (Catmull-Clark)", catmull_clark_action_);
+	connect(catmull_clark_action_, SIGNAL(triggered()), this, SLOT(catmull_clark_selected_map()));
+
+	return true;
+}
+
+bool Plugin_Subdivision::subdivide(
+	const QString& map_name,
+	const QString& position_name,
+	int scheme,
+	int nb_levels)
+{
+	MapHandler<CMap2>* mh = dynamic_cast<MapHandler<CMap2>*>(schnapps_->get_map(map_name));
+	if (!mh)
+	{
+		std::cerr << "Plugin_Subdivision::subdivide: " << map_name.toStdString() << " is not a surface map" << std::endl;
+		return false;
+	}
+	if (scheme < LOOP || scheme > CATMULL_CLARK || nb_levels <= 0)
+	{
+		std::cerr << "Plugin_Subdivision::subdivide: unknown scheme " << scheme << " or invalid number of levels" << std::endl;
+		return false;
+	}
+
+	// attributes stored out of the map are put back first (the connectivity changes)
+	mh->restore_stored_attributes();
+
+	QPointer<MapHandlerGen> guard(mh);
+	SCHNApps* schnapps = schnapps_;
+	std::shared_ptr<SubdivisionResult> result = std::make_shared<SubdivisionResult>();
+
+	submit_job(
+		QString("subdivision of %1").arg(map_name),
+		[mh, position_name, scheme, nb_levels, result] (Job& job)
+		{
+			ThreadPool& pool = ThreadPool::instance();
+			const uint32 invalid = std::numeric_limits<uint32>::max();
+
+			for (int level = 0; level < nb_levels && !job.is_canceled(); ++level)
+			{
+				QElapsedTimer timer;
+				timer.start();
+
+				// each level is published: the views show the successive levels
+				MapHandlerGen::Writer writer(mh);
+				CMap2* map = mh->get_map();
+				const CMap2& cmap = *map;
+				CMap2::VertexAttribute<VEC3> position = map->get_attribute<VEC3, Vertex::ORBIT>(position_name.toStdString());
+				if (!position.is_valid())
+					return;
+
+				std::vector<Vertex> vertices;
+				cmap.foreach_cell([&] (Vertex v) { vertices.push_back(v); });
+				std::vector<Edge> edges;
+				cmap.foreach_cell([&] (Edge e) { edges.push_back(e); });
+				std::vector<Face> faces;
+				cmap.foreach_cell([&] (Face f) { faces.push_back(f); });
+
+				// darts of each face, in the order of its boundary
+				CSRRelation face_darts;
+				face_darts.build(uint32(faces.size()), [&] (uint32 i, const std::function<void(uint32)>& f)
+				{
+					cmap.foreach_dart_of_orbit(faces[i], [&] (cgogn::Dart d) { f(d.index); });
+				});
+
+				if (scheme == LOOP && face_darts.indices_.size() != 3u * faces.size())
+				{
+					result->status_ = SubdivisionResult::NOT_TRIANGULATED;
+					return;
+				}
+				result->status_ = SubdivisionResult::DONE;
+
+				// all the new points of the level are computed in parallel before the connectivity changes
+				std::vector<VEC3> vertex_points(vertices.size());
+				std::vector<VEC3> edge_points(edges.size());
+				std::vector<VEC3> face_points;
+				if (scheme == LOOP)
+				{
+					pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							vertex_points[i] = loop_vertex_point(cmap, position, vertices[i]);
+					});
+					pool.parallel_for(0, edges.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							edge_points[i] = loop_edge_point(cmap, position, edges[i]);
+					});
+				}
+				else
+				{
+					face_points.resize(faces.size());
+					std::vector<uint32> face_index(cmap.get_topology_container().end(), invalid);
+					pool.parallel_for(0, faces.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+						{
+							VEC3 sum = VEC3::Zero();
+							for (const uint32* it = face_darts.begin(uint32(i)); it != face_darts.end(uint32(i)); ++it)
+							{
+								sum += position[Vertex(cgogn::Dart(*it))];
+								face_index[*it] = uint32(i);
+							}
+							face_points[i] = sum / SCALAR(face_darts.degree(uint32(i)));
+						}
+					});
+					pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							vertex_points[i] = catmull_clark_vertex_point(cmap, position, face_points, face_index, vertices[i]);
+					});
+					pool.parallel_for(0, edges.size(), [&] (std::size_t first, std::size_t last)
+					{
+						for (std::size_t i = first; i < last; ++i)
+							edge_points[i] = catmull_clark_edge_point(cmap, position, face_points, face_index, edges[i]);
+					});
+				}
+
+				LevelReport report;
+				report.geometry_ms_ = float64(timer.nsecsElapsed()) / 1.0e6;
+				timer.restart();
+
+				// refine the connectivity: cutting the edge of the dart d inserts the edge point after d,
+				// so that phi1(d) starts at the edge point of the edge of d
+				for (std::size_t i = 0; i < edges.size(); ++i)
+					position[map->cut_edge(edges[i])] = edge_points[i];
+
+				std::vector<cgogn::Dart> e;
+				for (uint32 i = 0u; i < uint32(faces.size()); ++i)
+				{
+					e.clear();
+					for (const uint32* it = face_darts.begin(i); it != face_darts.end(i); ++it)
+						e.push_back(map->phi1(cgogn::Dart(*it)));
+
+					if (scheme == LOOP)
+					{
+						// cut the 3 corners: the middle triangle remains
+						map->cut_face(e[0], e[1]);
+						map->cut_face(e[1], e[2]);
+						map->cut_face(e[2], map->phi1(map->phi1(e[2])));
+					}
+					else
+					{
+						// the edge between the first two edge points is cut by the face point,
+						// then the face point is linked to the other edge points
+						const Vertex center = map->cut_edge(map->cut_face(e[0], e[1]));
+						position[center] = face_points[i];
+						for (std::size_t k = 2; k < e.size(); ++k)
+							map->cut_face(map->phi_1(e[k - 1]), e[k]);
+					}
+				}
+
+				pool.parallel_for(0, vertices.size(), [&] (std::size_t first, std::size_t last)
+				{
+					for (std::size_t i = first; i < last; ++i)
+						position[vertices[i]] = vertex_points[i];
+				});
+
+				report.topology_ms_ = float64(timer.nsecsElapsed()) / 1.0e6;
+				report.nb_vertices_ = uint32(vertices.size() + edges.size() + face_points.size());
+				report.nb_faces_ = scheme == LOOP ? uint32(4u * faces.size()) : uint32(face_darts.indices_.size());
+				result->levels_.push_back(report);
+
+				writer.attribute_changed(position_name);
+				writer.connectivity_changed();
+
+				job.set_progress(double(level + 1) / double(nb_levels));
+			}
+		},
+		[schnapps, guard, position_name, result] (Job&)
+		{
+			if (!guard)
+				return;
+			switch (result->status_)
+			{
+				case SubdivisionResult::NO_POSITION:
+					std::cerr << "Plugin_Subdivision: map " << guard->get_name().toStdString() << " has no VEC3 attribute " << position_name.toStdString() << std::endl;
+					break;
+				case SubdivisionResult::NOT_TRIANGULATED:
+					std::cerr << "Plugin_Subdivision: map " << guard->get_name().toStdString() << " is not triangulated (Loop)" << std::endl;
+					break;
+				case SubdivisionResult::DONE:
+				{
+					QStringList levels;
+					for (std::size_t i = 0; i < result->levels_.size(); ++i)
+					{
+						const LevelReport& l = result->levels_[i];
+						levels << QString("level %1: %2 vertices, %3 faces - %4 ms geometry, %5 ms connectivity")
+							.arg(uint32(i + 1)).arg(l.nb_vertices_).arg(l.nb_faces_).arg(l.geometry_ms_).arg(l.topology_ms_);
+					}
+					schnapps->status_bar_message(QString("%1: %2").arg(guard->get_name()).arg(levels.join(" | ")), 5000);
+					break;
+				}
+			}
+		},
+		mh
+	);
+
+	return true;
+}
+
+void Plugin_Subdivision::loop_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		subdivide(map->get_name(), "position", LOOP, 1);
+}
+
+void Plugin_Subdivision::catmull_clark_selected_map()
+{
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (map)
+		subdivide(map->get_name(), "position", CATMULL_CLARK, 1);
+}
+
+Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+
+} // namespace schnapps
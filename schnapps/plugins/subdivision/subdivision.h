@@ -0,0 +1,95 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_SUBDIVISION_H_
+#define SCHNAPPS_PLUGIN_SUBDIVISION_H_
+
+#include <schnapps/core/plugin_processing.h>
+
+#include <QAction>
+
+namespace schnapps
+{
+
+/**
+* @brief Plugin subdividing surface maps (Loop for triangle meshes, Catmull-Clark for any polygon mesh)
+* The numbers of new vertices, edges and faces of a level are known from the current ones: the
+* new positions of all the vertex, edge and face points are computed in parallel in arrays
+* allocated once per level, then the connectivity is refined (edges cut, faces split) and the
+* positions are written. The duration of each level is printed at the end.
+*/
+class Plugin_Subdivision : public PluginProcessing
+{
+	Q_OBJECT
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "subdivision.json")
+	Q_INTERFACES(schnapps::Plugin)
+
+public:
+
+	enum Scheme
+	{
+		LOOP = 0,
+		CATMULL_CLARK
+	};
+
+	inline Plugin_Subdivision() {}
+
+	~Plugin_Subdivision() {}
+
+private:
+
+	bool enable() override;
+	inline void disable() override {}
+
+public slots:
+
+	/**
+	 * @brief subdivide a surface map in a background job
+	 * @param map_name name of the map
+	 * @param position_name name of the VEC3 position vertex attribute
+	 * @param scheme 0: Loop (triangle meshes) / 1: Catmull-Clark
+	 * @param nb_levels number of subdivision levels
+	 * @return false if the map is not a surface map or a parameter is invalid
+	 */
+	bool subdivide(
+		const QString& map_name,
+		const QString& position_name,
+		int scheme,
+		int nb_levels
+	);
+
+	/**
+	 * @brief subdivide the "position" attribute of the selected map once
+	 */
+	void loop_selected_map();
+	void catmull_clark_selected_map();
+
+private:
+
+	QAction* loop_action_;
+	QAction* catmull_clark_action_;
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_SUBDIVISION_H_
@@ -0,0 +1,350 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#include <shader_packed.h>
+
+#include <schnapps/core/packed_vbo.h>
+
+#include <QOpenGLContext>
+#include <QVector3D>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+
+namespace schnapps
+{
+
+static const char* vertex_shader_source =
+	"#version 150\n"
+	"in vec3 vertex_pos;\n"
+	"in vec3 vertex_normal;\n"
+	"in vec2 vertex_oct_normal;\n"
+	"in vec3 vertex_color;\n"
+	"in float vertex_scalar;\n"
+	"uniform mat4 projection_matrix;\n"
+	"uniform mat4 model_view_matrix;\n"
+	"uniform mat3 normal_matrix;\n"
+	"uniform vec3 position_offset;\n"
+	"uniform vec3 position_scale;\n"
+	"uniform bool oct_normal;\n"
+	"uniform float point_size;\n"
+	"uniform float viewport_height;\n"
+	"uniform float scalar_min;\n"
+	"uniform float scalar_max;\n"
+	"out vec3 pos;\n"
+	"out vec3 normal;\n"
+	"out vec3 color;\n"
+	"out float scalar;\n"
+	"vec3 decode_octahedral(vec2 e)\n"
+	"{\n"
+	"	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+	"	if (n.z < 0.0)\n"
+	"		n.xy = (1.0 - abs(e.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);\n"
+	"	return normalize(n);\n"
+	"}\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 p = model_view_matrix * vec4(position_offset + position_scale * vertex_pos, 1.0);\n"
+	"	pos = p.xyz;\n"
+	"	normal = normal_matrix * (oct_normal ? decode_octahedral(vertex_oct_normal) : vertex_normal);\n"
+	"	color = vertex_color;\n"
+	"	scalar = (vertex_scalar - scalar_min) / max(scalar_max - scalar_min, 1e-20);\n"
+	"	gl_Position = projection_matrix * p;\n"
+	"	gl_PointSize = max(1.0, point_size * projection_matrix[1][1] * viewport_height / max(-p.z, 1e-6));\n"
+	"}\n";
+
+static const char* fragment_shader_source =
+	"#version 150\n"
+	"in vec3 pos;\n"
+	"in vec3 normal;\n"
+	"in vec3 color;\n"
+	"in float scalar;\n"
+	"uniform int shading;\n"
+	"uniform bool use_color;\n"
+	"uniform bool use_scalar;\n"
+	"uniform bool double_side;\n"
+	"uniform vec4 front_color;\n"
+	"uniform vec4 back_color;\n"
+	"uniform sampler1D palette;\n"
+	"out vec4 frag_color;\n"
+	"void main()\n"
+	"{\n"
+	"	if (shading == 0)\n"
+	"	{\n"
+	"		frag_color = front_color;\n"
+	"		return;\n"
+	"	}\n"
+	"	if (shading == 3)\n"
+	"	{\n"
+	"		if (length(gl_PointCoord - vec2(0.5)) > 0.5)\n"
+	"			discard;\n"
+	"		frag_color = front_color;\n"
+	"		return;\n"
+	"	}\n"
+	"	vec4 base = use_scalar ? vec4(texture(palette, clamp(scalar, 0.0, 1.0)).rgb, 1.0) : use_color ? vec4(color, 1.0) : (gl_FrontFacing ? front_color : back_color);\n"
+	"	vec3 N = shading == 1 ? normalize(cross(dFdx(pos), dFdy(pos))) : normalize(normal);\n"
+	"	if (shading == 2 && !gl_FrontFacing)\n"
+	"	{\n"
+	"		if (!double_side)\n"
+	"			discard;\n"
+	"		N = -N;\n"
+	"	}\n"
+	"	// light at the camera position\n"
+	"	float lambert = clamp(dot(N, normalize(-pos)), 0.0, 1.0);\n"
+	"	frag_color = vec4(base.rgb * (0.25 + 0.75 * lambert), base.a);\n"
+	"}\n";
+
+namespace
+{
+
+// control points of the palettes, evenly spaced in [0,1]
+const std::vector<QVector3D>& palette_control_points(ShaderPacked::Palette palette)
+{
+	static const std::vector<QVector3D> cool_warm = {
+		QVector3D(0.23f, 0.30f, 0.75f), QVector3D(0.87f, 0.87f, 0.87f), QVector3D(0.71f, 0.02f, 0.15f)
+	};
+	static const std::vector<QVector3D> viridis = {
+		QVector3D(0.267f, 0.005f, 0.329f), QVector3D(0.283f, 0.141f, 0.458f), QVector3D(0.254f, 0.265f, 0.530f),
+		QVector3D(0.207f, 0.372f, 0.553f), QVector3D(0.164f, 0.471f, 0.558f), QVector3D(0.128f, 0.567f, 0.551f),
+		QVector3D(0.135f, 0.659f, 0.518f), QVector3D(0.267f, 0.749f, 0.441f), QVector3D(0.478f, 0.821f, 0.318f),
+		QVector3D(0.741f, 0.873f, 0.150f), QVector3D(0.993f, 0.906f, 0.144f)
+	};
+	static const std::vector<QVector3D> grayscale = {
+		QVector3D(0.0f, 0.0f, 0.0f), QVector3D(1.0f, 1.0f, 1.0f)
+	};
+	static const std::vector<QVector3D> rainbow = {
+		QVector3D(0.0f, 0.0f, 1.0f), QVector3D(0.0f, 1.0f, 1.0f), QVector3D(0.0f, 1.0f, 0.0f),
+		QVector3D(1.0f, 1.0f, 0.0f), QVector3D(1.0f, 0.0f, 0.0f)
+	};
+	switch (palette)
+	{
+		case ShaderPacked::VIRIDIS: return viridis;
+		case ShaderPacked::GRAYSCALE: return grayscale;
+		case ShaderPacked::RAINBOW: return rainbow;
+		default: return cool_warm;
+	}
+}
+
+} // namespace
+
+ShaderPacked::ShaderPacked()
+{
+	for (QOpenGLTexture*& texture : palettes_)
+		texture = nullptr;
+	program_.addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader_source);
+	program_.addShaderFromSourceCode(QOpenGLShader::Fragment, fragment_shader_source);
+	program_.bindAttributeLocation("vertex_pos", ATTRIB_POSITION);
+	program_.bindAttributeLocation("vertex_normal", ATTRIB_NORMAL);
+	program_.bindAttributeLocation("vertex_oct_normal", ATTRIB_OCT_NORMAL);
+	program_.bindAttributeLocation("vertex_color", ATTRIB_COLOR);
+	program_.bindAttributeLocation("vertex_scalar", ATTRIB_SCALAR);
+	if (!program_.link())
+		std::cerr << "ShaderPacked: " << program_.log().toStdString() << std::endl;
+}
+
+ShaderPacked* ShaderPacked::instance()
+{
+	static ShaderPacked* shader = nullptr;
+	if (!shader)
+		shader = new ShaderPacked();
+	return shader;
+}
+
+QOpenGLTexture* ShaderPacked::palette_texture(Palette palette)
+{
+	if (palette < 0 || palette >= NB_PALETTES)
+		palette = COOL_WARM;
+	if (palettes_[palette])
+		return palettes_[palette];
+
+	const uint32 size = 256u;
+	const std::vector<QVector3D>& points = palette_control_points(palette);
+	std::vector<uint8> texels(3u * size);
+	for (uint32 i = 0u; i < size; ++i)
+	{
+		const float32 x = float32(i) / float32(size - 1u) * float32(points.size() - 1u);
+		const std::size_t k = std::min(std::size_t(x), points.size() - 2u);
+		const QVector3D c = points[k] + (x - float32(k)) * (points[k + 1u] - points[k]);
+		for (uint32 j = 0u; j < 3u; ++j)
+			texels[3u * i + j] = uint8(std::round(255.0f * std::min(std::max(c[int(j)], 0.0f), 1.0f)));
+	}
+
+	QOpenGLTexture* texture = new QOpenGLTexture(QOpenGLTexture::Target1D);
+	texture->setSize(int(size));
+	texture->setFormat(QOpenGLTexture::RGB8_UNorm);
+	texture->allocateStorage();
+	texture->setData(QOpenGLTexture::RGB, QOpenGLTexture::UInt8, texels.data());
+	texture->setMinificationFilter(QOpenGLTexture::Linear);
+	texture->setMagnificationFilter(QOpenGLTexture::Linear);
+	texture->setWrapMode(QOpenGLTexture::ClampToEdge);
+	palettes_[palette] = texture;
+	return texture;
+}
+
+ShaderPacked::Param* ShaderPacked::generate_param()
+{
+	return new Param();
+}
+
+ShaderPacked::Param::Param() :
+	front_color_(85, 168, 190),
+	back_color_(85, 168, 190),
+	edge_color_(0, 0, 0),
+	vertex_color_(190, 85, 168),
+	double_side_(true),
+	point_size_(1.0f),
+	scalar_min_(0.0f),
+	scalar_max_(1.0f),
+	palette_(COOL_WARM),
+	gl_(QOpenGLContext::currentContext()->functions()),
+	position_vbo_(nullptr),
+	packed_position_vbo_(nullptr),
+	normal_vbo_(nullptr),
+	packed_normal_vbo_(nullptr),
+	color_vbo_(nullptr),
+	scalar_vbo_(nullptr)
+{
+	ShaderPacked::instance();
+	vao_.create();
+}
+
+ShaderPacked::Param::~Param()
+{
+	vao_.destroy();
+}
+
+void ShaderPacked::Param::set_position_vbo(cgogn::rendering::VBO* vbo, PackedVBO* packed)
+{
+	position_vbo_ = packed ? nullptr : vbo;
+	packed_position_vbo_ = packed;
+}
+
+void ShaderPacked::Param::set_normal_vbo(cgogn::rendering::VBO* vbo, PackedVBO* packed)
+{
+	normal_vbo_ = packed ? nullptr : vbo;
+	packed_normal_vbo_ = packed;
+}
+
+void ShaderPacked::Param::set_color_vbo(cgogn::rendering::VBO* vbo)
+{
+	color_vbo_ = vbo;
+}
+
+void ShaderPacked::Param::set_scalar_vbo(cgogn::rendering::VBO* vbo)
+{
+	scalar_vbo_ = vbo;
+}
+
+void ShaderPacked::Param::set_float_attribute(int location, cgogn::rendering::VBO* vbo)
+{
+	vbo->bind();
+	gl_->glEnableVertexAttribArray(GLuint(location));
+	gl_->glVertexAttribPointer(GLuint(location), GLint(vbo->vector_dimension()), GL_FLOAT, GL_FALSE, 0, nullptr);
+	vbo->release();
+}
+
+void ShaderPacked::Param::bind(const QMatrix4x4& proj, const QMatrix4x4& mv, Shading shading)
+{
+	QOpenGLShaderProgram& prg = ShaderPacked::instance()->program_;
+	prg.bind();
+	vao_.bind();
+
+	// unused attributes keep a constant value
+	for (int location = ATTRIB_POSITION; location <= ATTRIB_SCALAR; ++location)
+		gl_->glDisableVertexAttribArray(GLuint(location));
+
+	QVector3D offset(0.0f, 0.0f, 0.0f);
+	QVector3D scale(1.0f, 1.0f, 1.0f);
+	if (packed_position_vbo_)
+	{
+		packed_position_vbo_->bind_attribute(gl_, ATTRIB_POSITION);
+		offset = packed_position_vbo_->get_offset();
+		scale = packed_position_vbo_->get_scale();
+	}
+	else if (position_vbo_)
+		set_float_attribute(ATTRIB_POSITION, position_vbo_);
+
+	const bool phong = shading == PHONG;
+	if (phong && packed_normal_vbo_)
+		packed_normal_vbo_->bind_attribute(gl_, ATTRIB_OCT_NORMAL);
+	else if (phong && normal_vbo_)
+		set_float_attribute(ATTRIB_NORMAL, normal_vbo_);
+
+	// the scalar field has priority over the colors
+	const bool use_scalar = scalar_vbo_ && (shading == FLAT || shading == PHONG);
+	const bool use_color = !use_scalar && color_vbo_ && (shading == FLAT || shading == PHONG);
+	if (use_scalar)
+	{
+		set_float_attribute(ATTRIB_SCALAR, scalar_vbo_);
+		ShaderPacked::instance()->palette_texture(palette_)->bind(0u);
+	}
+	else if (use_color)
+		set_float_attribute(ATTRIB_COLOR, color_vbo_);
+
+	GLint viewport[4];
+	gl_->glGetIntegerv(GL_VIEWPORT, viewport);
+
+	prg.setUniformValue("projection_matrix", proj);
+	prg.setUniformValue("model_view_matrix", mv);
+	prg.setUniformValue("normal_matrix", mv.normalMatrix());
+	prg.setUniformValue("position_offset", offset);
+	prg.setUniformValue("position_scale", scale);
+	prg.setUniformValue("oct_normal", packed_normal_vbo_ != nullptr);
+	prg.setUniformValue("point_size", point_size_);
+	prg.setUniformValue("viewport_height", float32(viewport[3]));
+	prg.setUniformValue("shading", int(shading));
+	prg.setUniformValue("use_color", use_color);
+	prg.setUniformValue("use_scalar", use_scalar);
+	prg.setUniformValue("scalar_min", scalar_min_);
+	prg.setUniformValue("scalar_max", scalar_max_);
+	prg.setUniformValue("palette", 0);
+	prg.setUniformValue("double_side", double_side_);
+	// edges and points are drawn with a uniform color
+	if (shading == UNIFORM)
+		prg.setUniformValue("front_color", edge_color_);
+	else if (shading == POINTS)
+		prg.setUniformValue("front_color", vertex_color_);
+	else
+		prg.setUniformValue("front_color", front_color_);
+	prg.setUniformValue("back_color", back_color_);
+
+	if (shading == POINTS)
+		gl_->glEnable(GL_PROGRAM_POINT_SIZE);
+}
+
+void ShaderPacked::Param::release()
+{
+	gl_->glDisable(GL_PROGRAM_POINT_SIZE);
+	if (scalar_vbo_)
+		ShaderPacked::instance()->palette_texture(palette_)->release(0u);
+	vao_.release();
+	ShaderPacked::instance()->program_.release();
+}
+
+} // namespace schnapps
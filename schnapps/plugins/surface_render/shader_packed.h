@@ -0,0 +1,153 @@
+/*******************************************************************************
+* SCHNApps                                                                     *
+* Copyright (C) 2015, IGG Group, ICube, University of Strasbourg, France       *
+*                                                                              *
+* This library is free software; you can redistribute it and/or modify it      *
+* under the terms of the GNU Lesser General Public License as published by the *
+* Free Software Foundation; either version 2.1 of the License, or (at your     *
+* option) any later version.                                                   *
+*                                                                              *
+* This library is distributed in the hope that it will be useful, but WITHOUT  *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or        *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License  *
+* for more details.                                                            *
+*                                                                              *
+* You should have received a copy of the GNU Lesser General Public License     *
+* along with this library; if not, write to the Free Software Foundation,      *
+* Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301 USA.           *
+*                                                                              *
+* Web site: http://cgogn.unistra.fr/                                           *
+* Contact information: cgogn@unistra.fr                                        *
+*                                                                              *
+*******************************************************************************/
+
+#ifndef SCHNAPPS_PLUGIN_SURFACE_RENDER_SHADER_PACKED_H_
+#define SCHNAPPS_PLUGIN_SURFACE_RENDER_SHADER_PACKED_H_
+
+#include <schnapps/core/types.h>
+
+#include <cgogn/rendering/shaders/vbo.h>
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLFunctions>
+#include <QMatrix4x4>
+#include <QColor>
+
+namespace schnapps
+{
+
+class PackedVBO;
+
+/**
+* @brief Shader drawing surfaces from float VBOs or packed VBOs (see PackedVBO)
+* Positions can be float or 16-bit quantized (dequantized with the offset and scale of the VBO),
+* normals can be float or octahedral-encoded. The same program draws flat or phong shaded faces,
+* edges and vertices (points).
+* Faces can be colored by a 1-component VBO (scalar field) looked up in a palette texture.
+*/
+class ShaderPacked
+{
+public:
+
+	enum Shading
+	{
+		UNIFORM = 0,
+		FLAT,
+		PHONG,
+		POINTS
+	};
+
+	// palettes of the scalar fields (256 colors, linearly interpolated)
+	enum Palette
+	{
+		COOL_WARM = 0,
+		VIRIDIS,
+		GRAYSCALE,
+		RAINBOW,
+		NB_PALETTES
+	};
+
+	class Param
+	{
+	public:
+
+		Param();
+		~Param();
+
+		Param(const Param&) = delete;
+		Param& operator=(const Param&) = delete;
+
+		// one of the two position sources is used (packed if not null)
+		void set_position_vbo(cgogn::rendering::VBO* vbo, PackedVBO* packed);
+		// one of the two normal sources is used (packed if not null)
+		void set_normal_vbo(cgogn::rendering::VBO* vbo, PackedVBO* packed);
+		void set_color_vbo(cgogn::rendering::VBO* vbo);
+		// 1-component VBO mapped to colors between scalar_min_ and scalar_max_ (replaces the colors)
+		void set_scalar_vbo(cgogn::rendering::VBO* vbo);
+
+		/**
+		 * @brief bind the program and the vertex attributes
+		 * @param shading UNIFORM (edges, edge_color_), FLAT, PHONG (needs a normal VBO) or POINTS (vertex_color_)
+		 */
+		void bind(const QMatrix4x4& proj, const QMatrix4x4& mv, Shading shading);
+		void release();
+
+		QColor front_color_;
+		QColor back_color_;
+		QColor edge_color_;
+		QColor vertex_color_;
+		bool double_side_;
+		// radius of the points in world units
+		float32 point_size_;
+		// range of the scalar field mapped to the palette
+		float32 scalar_min_;
+		float32 scalar_max_;
+		Palette palette_;
+
+	private:
+
+		void set_float_attribute(int location, cgogn::rendering::VBO* vbo);
+
+		QOpenGLVertexArrayObject vao_;
+		QOpenGLFunctions* gl_;
+
+		cgogn::rendering::VBO* position_vbo_;
+		PackedVBO* packed_position_vbo_;
+		cgogn::rendering::VBO* normal_vbo_;
+		PackedVBO* packed_normal_vbo_;
+		cgogn::rendering::VBO* color_vbo_;
+		cgogn::rendering::VBO* scalar_vbo_;
+	};
+
+	static Param* generate_param();
+
+private:
+
+	friend class Param;
+
+	enum AttributeLocation
+	{
+		ATTRIB_POSITION = 0,
+		ATTRIB_NORMAL,
+		ATTRIB_OCT_NORMAL,
+		ATTRIB_COLOR,
+		ATTRIB_SCALAR
+	};
+
+	ShaderPacked();
+
+	// the program is shared by the contexts of the views
+	static ShaderPacked* instance();
+
+	// the texture of a palette (created on first use in the current context)
+	QOpenGLTexture* palette_texture(Palette palette);
+
+	QOpenGLShaderProgram program_;
+	QOpenGLTexture* palettes_[NB_PALETTES];
+};
+
+} // namespace schnapps
+
+#endif // SCHNAPPS_PLUGIN_SURFACE_RENDER_SHADER_PACKED_H_
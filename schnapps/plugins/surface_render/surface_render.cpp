@@ -27,10 +27,30 @@
 #include <schnapps/core/view.h>
 #include <schnapps/core/camera.h>
 #include <schnapps/core/map_handler.h>
+#include <schnapps/core/job.h>
+
+#include <QPointer>
+
+#include <iostream>
+#include <memory>
 
 namespace schnapps
 {
 
+namespace
+{
+
+// result of the job of update_scalar_range
+struct ScalarRange
+{
+	ScalarRange() : min_(0.0), max_(0.0), valid_(false) {}
+	float64 min_;
+	float64 max_;
+	bool valid_;
+};
+
+} // namespace
+
 MapParameters& Plugin_SurfaceRender::get_parameters(View* view, MapHandlerGen* map)
 {
 	view->makeCurrent();
@@ -74,6 +94,12 @@ void Plugin_SurfaceRender::draw_map(View* view, MapHandlerGen* map, const QMatri
 {
 	const MapParameters& p = get_parameters(view, map);
 
+	if (p.use_packed_shader())
+	{
+		draw_map_packed(map, p, proj, mv);
+		return;
+	}
+
 	if (p.render_faces_)
 	{
 		glEnable(GL_POLYGON_OFFSET_FILL);
@@ -143,31 +169,70 @@ void Plugin_SurfaceRender::draw_map(View* view, MapHandlerGen* map, const QMatri
 	}
 }
 
+void Plugin_SurfaceRender::draw_map_packed(MapHandlerGen* map, const MapParameters& p, const QMatrix4x4& proj, const QMatrix4x4& mv)
+{
+	if (!p.has_position())
+		return;
+
+	if (p.render_faces_)
+	{
+		const ShaderPacked::Shading shading =
+			p.face_style_ == MapParameters::FaceShadingStyle::PHONG ? ShaderPacked::PHONG : ShaderPacked::FLAT;
+		if (shading == ShaderPacked::FLAT || p.has_normal())
+		{
+			glEnable(GL_POLYGON_OFFSET_FILL);
+			glPolygonOffset(1.0f, 1.0f);
+			p.shader_packed_param_->bind(proj, mv, shading);
+			map->draw(cgogn::rendering::TRIANGLES);
+			p.shader_packed_param_->release();
+			glDisable(GL_POLYGON_OFFSET_FILL);
+		}
+	}
+
+	if (p.render_edges_)
+	{
+		p.shader_packed_param_->bind(proj, mv, ShaderPacked::UNIFORM);
+		map->draw(cgogn::rendering::LINES);
+		p.shader_packed_param_->release();
+	}
+
+	if (p.render_vertices_)
+	{
+		p.shader_packed_param_->bind(proj, mv, ShaderPacked::POINTS);
+		map->draw(cgogn::rendering::POINTS);
+		p.shader_packed_param_->release();
+	}
+}
+
 void Plugin_SurfaceRender::selected_view_changed(View* old, View* cur)
 {
 	MapHandlerGen* map = schnapps_->get_selected_map();
-	const MapParameters& p = get_parameters(cur, map);
-	dock_tab_->update_map_parameters(map, p);
+	if (map && cur)
+	{
+		const MapParameters& p = get_parameters(cur, map);
+		dock_tab_->update_map_parameters(map, p);
+	}
 }
 
 void Plugin_SurfaceRender::selected_map_changed(MapHandlerGen* old, MapHandlerGen* cur)
 {
 	View* view = schnapps_->get_selected_view();
-	const MapParameters& p = get_parameters(view, cur);
-	dock_tab_->update_map_parameters(cur, p);
+	if (view && cur)
+	{
+		const MapParameters& p = get_parameters(view, cur);
+		dock_tab_->update_map_parameters(cur, p);
+	}
 }
 
 void Plugin_SurfaceRender::map_added(MapHandlerGen *map)
 {
-	connect(map, SIGNAL(vbo_added(cgogn::rendering::VBO*)), this, SLOT(vbo_added(cgogn::rendering::VBO*)));
-	connect(map, SIGNAL(vbo_removed(cgogn::rendering::VBO*)), this, SLOT(vbo_removed(cgogn::rendering::VBO*)));
+	connect(map, SIGNAL(changes_committed(const MapChangeSet&)), this, SLOT(changes_committed(const MapChangeSet&)));
 	connect(map, SIGNAL(bb_changed()), this, SLOT(bb_changed()));
 }
 
 void Plugin_SurfaceRender::map_removed(MapHandlerGen *map)
 {
-	disconnect(map, SIGNAL(vbo_added(cgogn::rendering::VBO*)), this, SLOT(vbo_added(cgogn::rendering::VBO*)));
-	disconnect(map, SIGNAL(vbo_removed(cgogn::rendering::VBO*)), this, SLOT(vbo_removed(cgogn::rendering::VBO*)));
+	disconnect(map, SIGNAL(changes_committed(const MapChangeSet&)), this, SLOT(changes_committed(const MapChangeSet&)));
 	disconnect(map, SIGNAL(bb_changed()), this, SLOT(bb_changed()));
 }
 
@@ -176,35 +241,59 @@ void Plugin_SurfaceRender::schnapps_closing()
 
 }
 
-void Plugin_SurfaceRender::vbo_added(cgogn::rendering::VBO* vbo)
+void Plugin_SurfaceRender::changes_committed(const MapChangeSet& changes)
 {
 	MapHandlerGen* map = static_cast<MapHandlerGen*>(QObject::sender());
 
 	if(map == schnapps_->get_selected_map())
 	{
-		if(vbo->vector_dimension() == 3)
+		foreach (cgogn::rendering::VBO* vbo, changes.added_vbos_)
 		{
-			dock_tab_->add_position_vbo(QString::fromStdString(vbo->get_name()));
-			dock_tab_->add_normal_vbo(QString::fromStdString(vbo->get_name()));
-			dock_tab_->add_color_vbo(QString::fromStdString(vbo->get_name()));
+			if(vbo->vector_dimension() == 3)
+			{
+				dock_tab_->add_position_vbo(QString::fromStdString(vbo->get_name()));
+				dock_tab_->add_normal_vbo(QString::fromStdString(vbo->get_name()));
+				dock_tab_->add_color_vbo(QString::fromStdString(vbo->get_name()));
+			}
 		}
-	}
-}
-
-void Plugin_SurfaceRender::vbo_removed(cgogn::rendering::VBO* vbo)
-{
-	MapHandlerGen* map = static_cast<MapHandlerGen*>(QObject::sender());
-
-	if(map == schnapps_->get_selected_map())
-	{
-		if(vbo->vector_dimension() == 3)
+		foreach (cgogn::rendering::VBO* vbo, changes.removed_vbos_)
+		{
+			if(vbo->vector_dimension() == 3)
+			{
+				dock_tab_->remove_position_vbo(QString::fromStdString(vbo->get_name()));
+				dock_tab_->remove_normal_vbo(QString::fromStdString(vbo->get_name()));
+				dock_tab_->remove_color_vbo(QString::fromStdString(vbo->get_name()));
+			}
+		}
+		foreach (cgogn::rendering::VBO* vbo, changes.added_vbos_)
+		{
+			if(vbo->vector_dimension() == 1)
+				dock_tab_->add_scalar_vbo(QString::fromStdString(vbo->get_name()));
+		}
+		foreach (cgogn::rendering::VBO* vbo, changes.removed_vbos_)
 		{
-			dock_tab_->remove_position_vbo(QString::fromStdString(vbo->get_name()));
-			dock_tab_->remove_normal_vbo(QString::fromStdString(vbo->get_name()));
-			dock_tab_->remove_color_vbo(QString::fromStdString(vbo->get_name()));
+			if(vbo->vector_dimension() == 1)
+				dock_tab_->remove_scalar_vbo(QString::fromStdString(vbo->get_name()));
+		}
+		foreach (PackedVBO* vbo, changes.added_packed_vbos_)
+		{
+			if (vbo->is_position())
+				dock_tab_->add_position_vbo(vbo->get_name());
+			else
+				dock_tab_->add_normal_vbo(vbo->get_name());
+		}
+		foreach (PackedVBO* vbo, changes.removed_packed_vbos_)
+		{
+			if (vbo->is_position())
+				dock_tab_->remove_position_vbo(vbo->get_name());
+			else
+				dock_tab_->remove_normal_vbo(vbo->get_name());
 		}
 	}
 
+	if (changes.removed_vbos_.empty() && changes.removed_packed_vbos_.empty())
+		return;
+
 	QSet<View*> views_to_update;
 
 	for (auto i = parameter_set_.begin(); i != parameter_set_.end(); ++i)
@@ -212,21 +301,36 @@ void Plugin_SurfaceRender::vbo_removed(cgogn::rendering::VBO* vbo)
 		View* view = i.key();
 		QHash<MapHandlerGen*, MapParameters>& view_param_set = i.value();
 		MapParameters& map_param = view_param_set[map];
-		if(map_param.get_position_vbo() == vbo)
+		if(changes.removed_vbos_.contains(map_param.get_position_vbo()))
 		{
 			map_param.set_position_vbo(nullptr);
 			if(view->is_linked_to_map(map)) views_to_update.insert(view);
 		}
-		if(map_param.get_normal_vbo() == vbo)
+		if(changes.removed_vbos_.contains(map_param.get_normal_vbo()))
 		{
 			map_param.set_normal_vbo(nullptr);
 			if(view->is_linked_to_map(map)) views_to_update.insert(view);
 		}
-		if(map_param.get_color_vbo() == vbo)
+		if(changes.removed_vbos_.contains(map_param.get_color_vbo()))
 		{
 			map_param.set_color_vbo(nullptr);
 			if(view->is_linked_to_map(map)) views_to_update.insert(view);
 		}
+		if(changes.removed_vbos_.contains(map_param.get_scalar_vbo()))
+		{
+			map_param.set_scalar_vbo(nullptr);
+			if(view->is_linked_to_map(map)) views_to_update.insert(view);
+		}
+		if(changes.removed_packed_vbos_.contains(map_param.get_packed_position_vbo()))
+		{
+			map_param.set_packed_position_vbo(nullptr);
+			if(view->is_linked_to_map(map)) views_to_update.insert(view);
+		}
+		if(changes.removed_packed_vbos_.contains(map_param.get_packed_normal_vbo()))
+		{
+			map_param.set_packed_normal_vbo(nullptr);
+			if(view->is_linked_to_map(map)) views_to_update.insert(view);
+		}
 	}
 
 	foreach(View* v, views_to_update)
@@ -248,6 +352,180 @@ void Plugin_SurfaceRender::bb_changed()
 	}
 }
 
+void Plugin_SurfaceRender::update_scalar_range(View* view, MapHandlerGen* map)
+{
+	cgogn::rendering::VBO* vbo = get_parameters(view, map).get_scalar_vbo();
+	if (!vbo)
+		return;
+
+	// the GUI does not wait for the writers of the map: the range is applied when the job is done
+	const QString name = QString::fromStdString(vbo->get_name());
+	std::shared_ptr<ScalarRange> range = std::make_shared<ScalarRange>();
+	QPointer<View> view_guard(view);
+	QPointer<MapHandlerGen> map_guard(map);
+
+	schnapps_->submit_job(
+		name_ + ": range of " + name,
+		[map, name, range] (Job&)
+		{
+			range->valid_ = map->get_scalar_range(name, range->min_, range->max_);
+		},
+		[this, view_guard, map_guard, name, range] (Job&)
+		{
+			if (!view_guard || !map_guard)
+				return;
+			if (!range->valid_)
+			{
+				std::cerr << "Plugin_SurfaceRender: cannot compute the range of " << name.toStdString() << std::endl;
+				return;
+			}
+			// the scalar field may have been changed meanwhile
+			MapParameters& p = get_parameters(view_guard, map_guard);
+			if (!p.get_scalar_vbo() || p.get_scalar_vbo()->get_name() != name.toStdString())
+				return;
+			p.set_scalar_range(float32(range->min_), float32(range->max_));
+			parameters_changed(view_guard, map_guard);
+		},
+		map
+	);
+}
+
+MapParameters* Plugin_SurfaceRender::get_script_parameters(const QString& view_name, const QString& map_name, View*& view, MapHandlerGen*& map)
+{
+	view = schnapps_->get_view(view_name);
+	map = schnapps_->get_map(map_name);
+	if (view && map)
+		return &get_parameters(view, map);
+	else
+		return nullptr;
+}
+
+void Plugin_SurfaceRender::parameters_changed(View* view, MapHandlerGen* map)
+{
+	if (view->is_selected_view() && map->is_selected_map())
+		dock_tab_->update_map_parameters(map, get_parameters(view, map));
+	view->update();
+}
+
+void Plugin_SurfaceRender::set_position_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->set_vertex_base_size(map->get_bb_diagonal_size() / (2 * std::sqrt(map->nb_edges())));
+		PackedVBO* packed = map->get_packed_vbo(vbo_name);
+		if (packed && packed->is_position())
+			p->set_packed_position_vbo(packed);
+		else
+			p->set_position_vbo(map->get_vbo(vbo_name));
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_normal_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		PackedVBO* packed = map->get_packed_vbo(vbo_name);
+		if (packed && packed->is_normal())
+			p->set_packed_normal_vbo(packed);
+		else
+			p->set_normal_vbo(map->get_vbo(vbo_name));
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_color_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->set_color_vbo(map->get_vbo(vbo_name));
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_scalar_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name, double min, double max)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->set_scalar_vbo(map->get_vbo(vbo_name));
+		p->set_scalar_range(float32(min), float32(max));
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_scalar_auto_range(const QString& view_name, const QString& map_name)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+		update_scalar_range(view, map);
+}
+
+void Plugin_SurfaceRender::set_palette(const QString& view_name, const QString& map_name, int palette)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->set_palette(ShaderPacked::Palette(palette));
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_render_vertices(const QString& view_name, const QString& map_name, bool b)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		if (b)
+			p->set_vertex_base_size(map->get_bb_diagonal_size() / (2 * std::sqrt(map->nb_edges())));
+		p->render_vertices_ = b;
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_render_edges(const QString& view_name, const QString& map_name, bool b)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->render_edges_ = b;
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_render_faces(const QString& view_name, const QString& map_name, bool b)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->render_faces_ = b;
+		parameters_changed(view, map);
+	}
+}
+
+void Plugin_SurfaceRender::set_face_style(const QString& view_name, const QString& map_name, int style)
+{
+	View* view; MapHandlerGen* map;
+	MapParameters* p = get_script_parameters(view_name, map_name, view, map);
+	if (p)
+	{
+		p->face_style_ = MapParameters::FaceShadingStyle(style);
+		parameters_changed(view, map);
+	}
+}
+
 Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
 
 } // namespace schnapps
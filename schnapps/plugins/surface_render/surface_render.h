@@ -28,6 +28,7 @@
 #include <schnapps/core/types.h>
 
 #include <surface_render_dock_tab.h>
+#include <shader_packed.h>
 
 #include <cgogn/rendering/shaders/shader_flat.h>
 #include <cgogn/rendering/shaders/shader_simple_color.h>
@@ -40,6 +41,7 @@ namespace schnapps
 {
 
 class MapHandlerGen;
+class PackedVBO;
 
 struct MapParameters
 {
@@ -55,6 +57,9 @@ struct MapParameters
 		position_vbo_(nullptr),
 		normal_vbo_(nullptr),
 		color_vbo_(nullptr),
+		packed_position_vbo_(nullptr),
+		packed_normal_vbo_(nullptr),
+		scalar_vbo_(nullptr),
 		vertex_scale_factor_(1.0f),
 		vertex_base_size_(1.0f),
 		render_vertices_(false),
@@ -88,12 +93,22 @@ struct MapParameters
 		shader_point_sprite_param_ = cgogn::rendering::ShaderPointSprite::generate_param();
 		shader_point_sprite_param_->color_ = vertex_color_;
 		shader_point_sprite_param_->size_ = vertex_base_size_ * vertex_scale_factor_;
+
+		shader_packed_param_ = ShaderPacked::generate_param();
+		shader_packed_param_->front_color_ = front_color_;
+		shader_packed_param_->back_color_ = back_color_;
+		shader_packed_param_->edge_color_ = edge_color_;
+		shader_packed_param_->vertex_color_ = vertex_color_;
+		shader_packed_param_->double_side_ = render_back_faces_;
+		shader_packed_param_->point_size_ = vertex_base_size_ * vertex_scale_factor_;
 	}
 
 	cgogn::rendering::VBO* get_position_vbo() const { return position_vbo_; }
 	void set_position_vbo(cgogn::rendering::VBO* v)
 	{
 		position_vbo_ = v;
+		packed_position_vbo_ = nullptr;
+		shader_packed_param_->set_position_vbo(position_vbo_, nullptr);
 		if (position_vbo_)
 		{
 			shader_flat_param_->set_position_vbo(position_vbo_);
@@ -105,10 +120,23 @@ struct MapParameters
 		}
 	}
 
+	// positions quantized on 16 bits (see PackedVBO)
+	PackedVBO* get_packed_position_vbo() const { return packed_position_vbo_; }
+	void set_packed_position_vbo(PackedVBO* v)
+	{
+		position_vbo_ = nullptr;
+		packed_position_vbo_ = v;
+		shader_packed_param_->set_position_vbo(nullptr, packed_position_vbo_);
+	}
+
+	bool has_position() const { return position_vbo_ || packed_position_vbo_; }
+
 	cgogn::rendering::VBO* get_normal_vbo() const { return normal_vbo_; }
 	void set_normal_vbo(cgogn::rendering::VBO* v)
 	{
 		normal_vbo_ = v;
+		packed_normal_vbo_ = nullptr;
+		shader_packed_param_->set_normal_vbo(normal_vbo_, nullptr);
 		if (normal_vbo_)
 		{
 			shader_phong_param_->set_normal_vbo(normal_vbo_);
@@ -116,10 +144,25 @@ struct MapParameters
 		}
 	}
 
+	// octahedral-encoded normals (see PackedVBO)
+	PackedVBO* get_packed_normal_vbo() const { return packed_normal_vbo_; }
+	void set_packed_normal_vbo(PackedVBO* v)
+	{
+		normal_vbo_ = nullptr;
+		packed_normal_vbo_ = v;
+		shader_packed_param_->set_normal_vbo(nullptr, packed_normal_vbo_);
+	}
+
+	bool has_normal() const { return normal_vbo_ || packed_normal_vbo_; }
+
+	// packed VBOs and scalar fields are drawn by the packed shader
+	bool use_packed_shader() const { return packed_position_vbo_ || packed_normal_vbo_ || scalar_vbo_; }
+
 	cgogn::rendering::VBO* get_color_vbo() const { return color_vbo_; }
 	void set_color_vbo(cgogn::rendering::VBO* v)
 	{
 		color_vbo_ = v;
+		shader_packed_param_->set_color_vbo(color_vbo_);
 		if (color_vbo_)
 		{
 			shader_flat_color_param_->set_color_vbo(color_vbo_);
@@ -127,11 +170,34 @@ struct MapParameters
 		}
 	}
 
+	// 1-component VBO colored through a palette (see ShaderPacked)
+	cgogn::rendering::VBO* get_scalar_vbo() const { return scalar_vbo_; }
+	void set_scalar_vbo(cgogn::rendering::VBO* v)
+	{
+		scalar_vbo_ = v && v->vector_dimension() == 1 ? v : nullptr;
+		shader_packed_param_->set_scalar_vbo(scalar_vbo_);
+	}
+
+	float32 get_scalar_min() const { return shader_packed_param_->scalar_min_; }
+	float32 get_scalar_max() const { return shader_packed_param_->scalar_max_; }
+	void set_scalar_range(float32 min, float32 max)
+	{
+		shader_packed_param_->scalar_min_ = min;
+		shader_packed_param_->scalar_max_ = max;
+	}
+
+	ShaderPacked::Palette get_palette() const { return shader_packed_param_->palette_; }
+	void set_palette(ShaderPacked::Palette palette)
+	{
+		shader_packed_param_->palette_ = palette >= 0 && palette < ShaderPacked::NB_PALETTES ? palette : ShaderPacked::COOL_WARM;
+	}
+
 	const QColor& get_vertex_color() const { return vertex_color_; }
 	void set_vertex_color(const QColor& c)
 	{
 		vertex_color_ = c;
 		shader_point_sprite_param_->color_ = vertex_color_;
+		shader_packed_param_->vertex_color_ = vertex_color_;
 	}
 
 	const QColor& get_edge_color() const { return edge_color_; }
@@ -139,6 +205,7 @@ struct MapParameters
 	{
 		edge_color_ = c;
 		shader_simple_color_param_->color_ = edge_color_;
+		shader_packed_param_->edge_color_ = edge_color_;
 	}
 
 	const QColor& get_front_color() const { return front_color_; }
@@ -147,6 +214,7 @@ struct MapParameters
 		front_color_ = c;
 		shader_flat_param_->front_color_ = front_color_;
 		shader_phong_param_->front_color_ = front_color_;
+		shader_packed_param_->front_color_ = front_color_;
 	}
 
 	const QColor& get_back_color() const { return back_color_; }
@@ -155,6 +223,7 @@ struct MapParameters
 		back_color_ = c;
 		shader_flat_param_->back_color_ = back_color_;
 		shader_phong_param_->back_color_ = back_color_;
+		shader_packed_param_->back_color_ = back_color_;
 	}
 
 	bool get_render_back_face() const { return render_back_faces_; }
@@ -163,6 +232,7 @@ struct MapParameters
 		render_back_faces_ = b;
 		shader_phong_param_->double_side_ = b;
 		shader_phong_color_param_->double_side_ = b;
+		shader_packed_param_->double_side_ = b;
 	}
 
 	float32 get_vertex_base_size() const { return vertex_base_size_; }
@@ -170,6 +240,7 @@ struct MapParameters
 	{
 		vertex_base_size_ = bs;
 		shader_point_sprite_param_->size_ = vertex_base_size_ * vertex_scale_factor_;
+		shader_packed_param_->point_size_ = vertex_base_size_ * vertex_scale_factor_;
 	}
 
 	float32 get_vertex_scale_factor() const { return vertex_scale_factor_; }
@@ -177,6 +248,7 @@ struct MapParameters
 	{
 		vertex_scale_factor_ = sf;
 		shader_point_sprite_param_->size_ = vertex_base_size_ * vertex_scale_factor_;
+		shader_packed_param_->point_size_ = vertex_base_size_ * vertex_scale_factor_;
 	}
 
 private:
@@ -184,6 +256,9 @@ private:
 	cgogn::rendering::VBO* position_vbo_;
 	cgogn::rendering::VBO* normal_vbo_;
 	cgogn::rendering::VBO* color_vbo_;
+	PackedVBO* packed_position_vbo_;
+	PackedVBO* packed_normal_vbo_;
+	cgogn::rendering::VBO* scalar_vbo_;
 
 	QColor vertex_color_;
 	QColor edge_color_;
@@ -203,6 +278,7 @@ public:
 	cgogn::rendering::ShaderPhong::Param* shader_phong_param_;
 	cgogn::rendering::ShaderPhongColor::Param* shader_phong_color_param_;
 	cgogn::rendering::ShaderPointSprite::Param* shader_point_sprite_param_;
+	ShaderPacked::Param* shader_packed_param_;
 
 	bool render_vertices_;
 	bool render_edges_;
@@ -218,7 +294,7 @@ public:
 class Plugin_SurfaceRender : public PluginInteraction
 {
 	Q_OBJECT
-	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin")
+	Q_PLUGIN_METADATA(IID "SCHNApps.Plugin" FILE "surface_render.json")
 	Q_INTERFACES(schnapps::Plugin)
 
 	friend class SurfaceRender_DockTab;
@@ -238,6 +314,10 @@ private:
 
 	inline void draw(View*, const QMatrix4x4& proj, const QMatrix4x4& mv) override {}
 	void draw_map(View* view, MapHandlerGen* map, const QMatrix4x4& proj, const QMatrix4x4& mv) override;
+	// draw with the packed shader when packed VBOs are used
+	void draw_map_packed(MapHandlerGen* map, const MapParameters& p, const QMatrix4x4& proj, const QMatrix4x4& mv);
+	// set the range of the scalar field to the range of its attribute (reduced in a job)
+	void update_scalar_range(View* view, MapHandlerGen* map);
 
 	inline void keyPress(View* , QKeyEvent*) override {}
 	inline void keyRelease(View* , QKeyEvent*) override {}
@@ -259,13 +339,55 @@ private slots:
 	void schnapps_closing();
 
 	// slots called from MapHandler signals
-	void vbo_added(cgogn::rendering::VBO* vbo);
-	void vbo_removed(cgogn::rendering::VBO* vbo);
+	void changes_committed(const MapChangeSet& changes);
 	void bb_changed();
 
 public slots:
 
+	/**
+	 * @brief set the VBO used as position for rendering a map in a view
+	 * Packed VBOs (see MapHandlerGen::create_packed_vbo) are drawn with the packed shader.
+	 * @param view_name name of the view
+	 * @param map_name name of the map
+	 * @param vbo_name name of the VBO or of the packed VBO
+	 */
+	void set_position_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name);
+	void set_normal_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name);
+	void set_color_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name);
+
+	/**
+	 * @brief color the faces of a map with a scalar field (1-component VBO) through a palette
+	 * @param vbo_name name of the VBO (no scalar field if it does not exist)
+	 * @param min value mapped to the first color of the palette
+	 * @param max value mapped to the last color of the palette
+	 */
+	void set_scalar_vbo(const QString& view_name, const QString& map_name, const QString& vbo_name, double min, double max);
+
+	/**
+	 * @brief set the range of the scalar field of a map to the range of the values of its attribute
+	 */
+	void set_scalar_auto_range(const QString& view_name, const QString& map_name);
+
+	/**
+	 * @brief set the palette of the scalar field
+	 * @param palette 0:cool-warm / 1:viridis / 2:grayscale / 3:rainbow
+	 */
+	void set_palette(const QString& view_name, const QString& map_name, int palette);
+
+	void set_render_vertices(const QString& view_name, const QString& map_name, bool b);
+	void set_render_edges(const QString& view_name, const QString& map_name, bool b);
+	void set_render_faces(const QString& view_name, const QString& map_name, bool b);
+
+	/**
+	 * @brief set the face shading style
+	 * @param style 0:flat / 1:phong
+	 */
+	void set_face_style(const QString& view_name, const QString& map_name, int style);
+
+private:
 
+	MapParameters* get_script_parameters(const QString& view_name, const QString& map_name, View*& view, MapHandlerGen*& map);
+	void parameters_changed(View* view, MapHandlerGen* map);
 
 private:
 
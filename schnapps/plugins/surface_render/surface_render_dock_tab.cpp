@@ -42,6 +42,11 @@ SurfaceRender_DockTab::SurfaceRender_DockTab(SCHNApps* s, Plugin_SurfaceRender*
 	connect(combo_positionVBO, SIGNAL(currentIndexChanged(int)), this, SLOT(position_vbo_changed(int)));
 	connect(combo_normalVBO, SIGNAL(currentIndexChanged(int)), this, SLOT(normal_vbo_changed(int)));
 	connect(combo_colorVBO, SIGNAL(currentIndexChanged(int)), this, SLOT(color_vbo_changed(int)));
+	connect(combo_scalarVBO, SIGNAL(currentIndexChanged(int)), this, SLOT(scalar_vbo_changed(int)));
+	connect(combo_palette, SIGNAL(currentIndexChanged(int)), this, SLOT(palette_changed(int)));
+	connect(spin_scalarMin, SIGNAL(valueChanged(double)), this, SLOT(scalar_range_changed(double)));
+	connect(spin_scalarMax, SIGNAL(valueChanged(double)), this, SLOT(scalar_range_changed(double)));
+	connect(button_autoRange, SIGNAL(clicked()), this, SLOT(auto_range_clicked()));
 	connect(check_renderVertices, SIGNAL(toggled(bool)), this, SLOT(render_vertices_changed(bool)));
 	connect(slider_verticesScaleFactor, SIGNAL(valueChanged(int)), this, SLOT(vertices_scale_factor_changed(int)));
 	connect(slider_verticesScaleFactor, SIGNAL(sliderPressed()), this, SLOT(vertices_scale_factor_pressed()));
@@ -74,7 +79,11 @@ void SurfaceRender_DockTab::position_vbo_changed(int index)
 		{
 			MapParameters& p = plugin_->get_parameters(view, map);
 			p.set_vertex_base_size(map->get_bb_diagonal_size() / (2 * std::sqrt(map->nb_edges())));
-			p.set_position_vbo(map->get_vbo(combo_positionVBO->currentText()));
+			PackedVBO* packed = map->get_packed_vbo(combo_positionVBO->currentText());
+			if (packed)
+				p.set_packed_position_vbo(packed);
+			else
+				p.set_position_vbo(map->get_vbo(combo_positionVBO->currentText()));
 			view->update();
 		}
 	}
@@ -89,7 +98,11 @@ void SurfaceRender_DockTab::normal_vbo_changed(int index)
 		if (view && map)
 		{
 			MapParameters& p = plugin_->get_parameters(view, map);
-			p.set_normal_vbo(map->get_vbo(combo_normalVBO->currentText()));
+			PackedVBO* packed = map->get_packed_vbo(combo_normalVBO->currentText());
+			if (packed)
+				p.set_packed_normal_vbo(packed);
+			else
+				p.set_normal_vbo(map->get_vbo(combo_normalVBO->currentText()));
 			view->update();
 		}
 	}
@@ -110,6 +123,61 @@ void SurfaceRender_DockTab::color_vbo_changed(int index)
 	}
 }
 
+void SurfaceRender_DockTab::scalar_vbo_changed(int index)
+{
+	if (!updating_ui_)
+	{
+		View* view = schnapps_->get_selected_view();
+		MapHandlerGen* map = schnapps_->get_selected_map();
+		if (view && map)
+		{
+			MapParameters& p = plugin_->get_parameters(view, map);
+			p.set_scalar_vbo(map->get_vbo(combo_scalarVBO->currentText()));
+			// a new scalar field is shown with its whole range
+			plugin_->update_scalar_range(view, map);
+			view->update();
+		}
+	}
+}
+
+void SurfaceRender_DockTab::palette_changed(int index)
+{
+	if (!updating_ui_)
+	{
+		View* view = schnapps_->get_selected_view();
+		MapHandlerGen* map = schnapps_->get_selected_map();
+		if (view && map)
+		{
+			MapParameters& p = plugin_->get_parameters(view, map);
+			p.set_palette(ShaderPacked::Palette(index));
+			view->update();
+		}
+	}
+}
+
+void SurfaceRender_DockTab::scalar_range_changed(double d)
+{
+	if (!updating_ui_)
+	{
+		View* view = schnapps_->get_selected_view();
+		MapHandlerGen* map = schnapps_->get_selected_map();
+		if (view && map)
+		{
+			MapParameters& p = plugin_->get_parameters(view, map);
+			p.set_scalar_range(float32(spin_scalarMin->value()), float32(spin_scalarMax->value()));
+			view->update();
+		}
+	}
+}
+
+void SurfaceRender_DockTab::auto_range_clicked()
+{
+	View* view = schnapps_->get_selected_view();
+	MapHandlerGen* map = schnapps_->get_selected_map();
+	if (view && map)
+		plugin_->update_scalar_range(view, map);
+}
+
 void SurfaceRender_DockTab::render_vertices_changed(bool b)
 {
 	if (!updating_ui_)
@@ -402,6 +470,24 @@ void SurfaceRender_DockTab::remove_color_vbo(QString name)
 	updating_ui_ = false;
 }
 
+void SurfaceRender_DockTab::add_scalar_vbo(QString name)
+{
+	updating_ui_ = true;
+	combo_scalarVBO->addItem(name);
+	updating_ui_ = false;
+}
+
+void SurfaceRender_DockTab::remove_scalar_vbo(QString name)
+{
+	updating_ui_ = true;
+	int curIndex = combo_scalarVBO->currentIndex();
+	int index = combo_scalarVBO->findText(name, Qt::MatchExactly);
+	if (curIndex == index)
+		combo_scalarVBO->setCurrentIndex(0);
+	combo_scalarVBO->removeItem(index);
+	updating_ui_ = false;
+}
+
 void SurfaceRender_DockTab::update_map_parameters(MapHandlerGen* map, const MapParameters& p)
 {
 	updating_ui_ = true;
@@ -415,6 +501,9 @@ void SurfaceRender_DockTab::update_map_parameters(MapHandlerGen* map, const MapP
 	combo_colorVBO->clear();
 	combo_colorVBO->addItem("- select VBO -");
 
+	combo_scalarVBO->clear();
+	combo_scalarVBO->addItem("- select VBO -");
+
 	unsigned int i = 1;
 	foreach(cgogn::rendering::VBO* vbo, map->get_vbo_set().values())
 	{
@@ -434,6 +523,20 @@ void SurfaceRender_DockTab::update_map_parameters(MapHandlerGen* map, const MapP
 
 			++i;
 		}
+		else if (vbo->vector_dimension() == 1)
+		{
+			combo_scalarVBO->addItem(QString::fromStdString(vbo->get_name()));
+			if (vbo == p.get_scalar_vbo())
+				combo_scalarVBO->setCurrentIndex(combo_scalarVBO->count() - 1);
+		}
+	}
+
+	foreach (PackedVBO* vbo, map->get_packed_vbo_set().values())
+	{
+		QComboBox* combo = vbo->is_position() ? combo_positionVBO : combo_normalVBO;
+		combo->addItem(vbo->get_name());
+		if (vbo == p.get_packed_position_vbo() || vbo == p.get_packed_normal_vbo())
+			combo->setCurrentIndex(combo->count() - 1);
 	}
 
 	check_renderVertices->setChecked(p.render_vertices_);
@@ -444,6 +547,9 @@ void SurfaceRender_DockTab::update_map_parameters(MapHandlerGen* map, const MapP
 	radio_flatShading->setChecked(p.face_style_ == MapParameters::FLAT);
 	radio_phongShading->setChecked(p.face_style_ == MapParameters::PHONG);
 	check_renderBoundary->setChecked(p.render_boundary_);
+	combo_palette->setCurrentIndex(int(p.get_palette()));
+	spin_scalarMin->setValue(p.get_scalar_min());
+	spin_scalarMax->setValue(p.get_scalar_max());
 
 	vertex_color_ = p.get_vertex_color();
 	vertexColorButton->setStyleSheet("QPushButton { background-color:" + vertex_color_.name() + " }");
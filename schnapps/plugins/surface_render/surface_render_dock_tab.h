@@ -67,6 +67,10 @@ private slots:
 	void position_vbo_changed(int index);
 	void normal_vbo_changed(int index);
 	void color_vbo_changed(int index);
+	void scalar_vbo_changed(int index);
+	void palette_changed(int index);
+	void scalar_range_changed(double d);
+	void auto_range_clicked();
 	void render_vertices_changed(bool b);
 	void vertices_scale_factor_changed(int i);
 	void vertices_scale_factor_pressed();
@@ -91,6 +95,8 @@ private:
 	void remove_normal_vbo(QString name);
 	void add_color_vbo(QString name);
 	void remove_color_vbo(QString name);
+	void add_scalar_vbo(QString name);
+	void remove_scalar_vbo(QString name);
 
 	void update_map_parameters(MapHandlerGen* map, const MapParameters& p);
 };